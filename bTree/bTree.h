@@ -15,8 +15,8 @@ namespace dbImpl {
   class BTree {
 
     private:
-      inline BufferFrame* createNewRoot();
-      BufferFrame* traverseToLeaf(K key, bool exclusiveLeaf);
+      inline PageGuard createNewRoot();
+      PageGuard traverseToLeaf(K key, bool exclusiveLeaf);
 
       uint64_t rootPID;
       uint64_t nextFreePage = 0;
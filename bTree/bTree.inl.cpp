@@ -1,4 +1,5 @@
 #include "bTree.h"
+#include <algorithm>
 #include <deque>
 #include <cstring>
 #include "node.h"
@@ -12,126 +13,157 @@ BTree<K, Comp>::BTree(BufferManager& bm, const Comp& comp, uint64_t _maxNodeSize
   , elements(0)
   , smaller(comp)
 {
+  uint32_t pageSize = bm.getPageSize(BufferManager::getSegmentIdForPageId(nextFreePage));
   this->maxNodeSize = std::min(_maxNodeSize,
-      ((BufferManager::pageSize - sizeof(Node<K, Comp>)) / sizeof(std::pair<K, uint64_t>)));
-  BufferFrame& bf = bufferManager.fixPage(nextFreePage++, true);
-  rootPID = bf.pageId;
-  Node<K, Comp>* root = reinterpret_cast<Node<K, Comp>*>(bf.getData());
+      ((pageSize - sizeof(Node<K, Comp>)) / sizeof(std::pair<K, uint64_t>)));
+  PageGuard rootPage = bufferManager.fixPageGuarded(nextFreePage++, true);
+  rootPage.markDirty();
+  rootPID = rootPage->pageId;
+  Node<K, Comp>* root = reinterpret_cast<Node<K, Comp>*>(rootPage.getData());
   *root = Node<K, Comp>(true);
-  bufferManager.unfixPage(bf, true);
 }
 
 template<typename K, typename Comp>
-BufferFrame* BTree<K, Comp>::createNewRoot() {
-  BufferFrame* newFrame = &bufferManager.fixPage(nextFreePage++, true);
-  rootPID = newFrame->pageId;
-  Node<K, Comp>* newRoot = reinterpret_cast<Node<K, Comp>*>(newFrame->getData());
+PageGuard BTree<K, Comp>::createNewRoot() {
+  PageGuard newPage = bufferManager.fixPageGuarded(nextFreePage++, true);
+  newPage.markDirty();
+  rootPID = newPage->pageId;
+  Node<K, Comp>* newRoot = reinterpret_cast<Node<K, Comp>*>(newPage.getData());
   *newRoot = Node<K, Comp>(false);
-  return newFrame;
+  return newPage;
 }
 
 template<typename K, typename Comp>
-BufferFrame* BTree<K, Comp>::traverseToLeaf(K key, bool exclusiveLeaf) {
-  //latch the root
-  BufferFrame* curFrame = &bufferManager.fixPage(rootPID, exclusiveLeaf);
-  Node<K, Comp>* curNode = reinterpret_cast<Node<K, Comp>*>(curFrame->getData());
-  BufferFrame* parFrame = NULL;
-  while (!curNode->isLeaf()) {
-    //unlatch parent
+PageGuard BTree<K, Comp>::traverseToLeaf(K key, bool exclusiveLeaf) {
+  //Inner nodes are read optimistically: they are pinned, but not latched.
+  //After reading from a node, its version is validated. If somebody modified
+  //the node in the meantime, we restart at the root. Only the leaf is latched.
+  while (true) {
+    uint64_t curVersion;
+    BufferFrame* curFrame = &bufferManager.fixPageOptimistic(rootPID, curVersion);
+    uint64_t parVersion = 0;
+    BufferFrame* parFrame = NULL;
+    //released when the next attempt starts
+    PageGuard leafPage;
+    bool valid = true;
+    while (valid && !leafPage) {
+      Node<K, Comp>* curNode = reinterpret_cast<Node<K, Comp>*>(curFrame->getData());
+      bool isLeaf = curNode->isLeaf();
+      uint64_t nextPID = 0;
+      if (!isLeaf) {
+        //a concurrent writer might be modifying the node. Its count is read
+        //once and clamped, so that the search stays within the page.
+        uint64_t count = std::min<uint64_t>(__atomic_load_n(&curNode->count, __ATOMIC_RELAXED), maxNodeSize);
+        uint64_t pos = curNode->findKeyPos(key, smaller, count);
+        nextPID = (pos == count) ?
+            curNode->next : curNode->keyValuePairs[pos].second;
+      }
+      //nextPID might be garbage, so it is only followed once the node was validated
+      valid = BufferManager::validate(*curFrame, curVersion);
+      if (!valid) {
+        break;
+      }
+      if (isLeaf) {
+        //latch the leaf. If its parent did not change until now, the leaf
+        //was not split and is still responsible for the key.
+        uint64_t leafPID = curFrame->pageId;
+        bufferManager.unfixPageOptimistic(*curFrame);
+        curFrame = NULL;
+        leafPage = bufferManager.fixPageGuarded(leafPID, exclusiveLeaf);
+        valid = (parFrame != NULL) ? BufferManager::validate(*parFrame, parVersion) : leafPID == rootPID;
+      } else {
+        //descend to the next level. The parent is validated again after the
+        //child's version was read, so the child could not be split unnoticed.
+        if (parFrame != NULL) {
+          bufferManager.unfixPageOptimistic(*parFrame);
+        }
+        parFrame = curFrame;
+        parVersion = curVersion;
+        curFrame = &bufferManager.fixPageOptimistic(nextPID, curVersion);
+        valid = BufferManager::validate(*parFrame, parVersion);
+      }
+    }
     if (parFrame != NULL) {
-      bufferManager.unfixPage(*parFrame, false);
+      bufferManager.unfixPageOptimistic(*parFrame);
+    }
+    if (curFrame != NULL) {
+      bufferManager.unfixPageOptimistic(*curFrame);
+    }
+    if (valid) {
+      return leafPage;
     }
-    parFrame = curFrame;
-    uint64_t pos = curNode->findKeyPos(key, smaller);
-    uint64_t nextPID =
-        (pos == curNode->count) ?
-            curNode->next : curNode->keyValuePairs[pos].second;
-    //latch the next level
-    curFrame = &bufferManager.fixPage(nextPID, exclusiveLeaf);
-    curNode = reinterpret_cast<Node<K, Comp>*>(curFrame->getData());
-  }
-  if (parFrame != NULL) {
-    bufferManager.unfixPage(*parFrame, false);
   }
-  return curFrame;
 }
 
 //latch the root, latch the first level, release the root, latch the second level etc,...
 template<typename K, typename Comp>
 bool BTree<K, Comp>::insert(K key, uint64_t tid) {
   //latch the root
-  BufferFrame* curFrame = &bufferManager.fixPage(rootPID, true);
-  Node<K, Comp>* curNode = reinterpret_cast<Node<K, Comp>*>(curFrame->getData());
-  BufferFrame* parFrame = NULL;
+  PageGuard curPage = bufferManager.fixPageGuarded(rootPID, true);
+  curPage.markDirty();
+  Node<K, Comp>* curNode = reinterpret_cast<Node<K, Comp>*>(curPage.getData());
+  PageGuard parPage;
   while (!curNode->isLeaf()) {
     if (curNode->count >= maxNodeSize) {
       // --> split to safe inner pages
-      if (parFrame == NULL) {
+      if (!parPage) {
         //Need to create a new root (parent) first
-        parFrame = createNewRoot();
+        parPage = createNewRoot();
       }
-      BufferFrame* newFrame = &bufferManager.fixPage(nextFreePage++, true);
-      K splitKey = curNode->split(curFrame->pageId, newFrame, parFrame, smaller);
+      PageGuard newPage = bufferManager.fixPageGuarded(nextFreePage++, true);
+      newPage.markDirty();
+      K splitKey = curNode->split(curPage->pageId, newPage.getFrame(), parPage.getFrame(), smaller);
 
-      //determine correct node and release the other one
-      if (smaller(key, splitKey)) {
-        bufferManager.unfixPage(*newFrame, true);
-      } else {
-        curNode = reinterpret_cast<Node<K, Comp>*>(newFrame->getData());
-        bufferManager.unfixPage(*curFrame, true);
-        curFrame = newFrame;
+      //determine correct node. The other one is released.
+      if (!smaller(key, splitKey)) {
+        curNode = reinterpret_cast<Node<K, Comp>*>(newPage.getData());
+        curPage = std::move(newPage);
       }
     }
 
     //release the parent node
-    if (parFrame != NULL) {
-      bufferManager.unfixPage(*parFrame, true); //TODO only set true when parent is really dirty?
-    }
-    parFrame = curFrame;
+    parPage = std::move(curPage); //TODO only mark dirty when parent is really dirty?
 
     //latch the next level
     uint64_t pos = curNode->findKeyPos(key, smaller);
     uint64_t nextPID =
         (pos == curNode->count) ?
             curNode->next : curNode->keyValuePairs[pos].second;
-    curFrame = &bufferManager.fixPage(nextPID, true);
-    curNode = reinterpret_cast<Node<K, Comp>*>(curFrame->getData());
+    curPage = bufferManager.fixPageGuarded(nextPID, true);
+    curPage.markDirty();
+    curNode = reinterpret_cast<Node<K, Comp>*>(curPage.getData());
   }
 
   Node<K, Comp>* leaf = reinterpret_cast<Node<K, Comp>*>(curNode);
   if (leaf->count >= maxNodeSize) {
-    if (parFrame == NULL) {
-      parFrame = createNewRoot();
+    if (!parPage) {
+      parPage = createNewRoot();
     }
 
-    BufferFrame* newFrame = &bufferManager.fixPage(nextFreePage++, true);
-    K splitKey = leaf->split(curFrame->pageId, newFrame, parFrame, smaller);
-    if (smaller(key, splitKey)) {
-      bufferManager.unfixPage(*newFrame, true);
-    } else {
-      leaf = reinterpret_cast<Node<K, Comp>*>(newFrame->getData());
-      bufferManager.unfixPage(*curFrame, true);
-      curFrame = newFrame;
+    PageGuard newPage = bufferManager.fixPageGuarded(nextFreePage++, true);
+    newPage.markDirty();
+    K splitKey = leaf->split(curPage->pageId, newPage.getFrame(), parPage.getFrame(), smaller);
+    if (!smaller(key, splitKey)) {
+      leaf = reinterpret_cast<Node<K, Comp>*>(newPage.getData());
+      curPage = std::move(newPage);
     }
   }
-  if (parFrame != NULL) {
-    bufferManager.unfixPage(*parFrame, true); //TODO: only mark dirty when parent was actually updated
-  }
+  parPage.release(); //TODO: only mark dirty when parent was actually updated
 
   bool insertSuccessful = leaf->insertKey(key, tid, smaller);
   if (insertSuccessful) {
     elements++;
   }
-  bufferManager.unfixPage(*curFrame, true);
   return insertSuccessful;
 }
 
 template<typename K, typename Comp>
 bool BTree<K, Comp>::erase(K key) {
-  BufferFrame* leafFrame = traverseToLeaf(key, true);
-  Node<K, Comp>* leaf = reinterpret_cast<Node<K, Comp>*>(leafFrame->getData());
+  PageGuard leafPage = traverseToLeaf(key, true);
+  leafPage.markDirty();
+  Node<K, Comp>* leaf = reinterpret_cast<Node<K, Comp>*>(leafPage.getData());
   bool deleted = leaf->deleteKey(key, smaller);
-  bufferManager.unfixPage(*leafFrame, true);
+  leafPage.release();
   if (deleted) {
     elements--; //update size of BTree
   }
@@ -140,8 +172,8 @@ bool BTree<K, Comp>::erase(K key) {
 
 template<typename K, typename Comp>
 boost::optional<uint64_t> BTree<K, Comp>::lookup(K key) {
-  BufferFrame* leafFrame = traverseToLeaf(key, false);
-  Node<K, Comp>* leaf = reinterpret_cast<Node<K, Comp>*>(leafFrame->getData());
+  PageGuard leafPage = traverseToLeaf(key, false);
+  Node<K, Comp>* leaf = reinterpret_cast<Node<K, Comp>*>(leafPage.getData());
   uint64_t pos = leaf->findKeyPos(key, smaller);
   uint64_t tid = std::numeric_limits<uint64_t>::max();
 
@@ -150,7 +182,6 @@ boost::optional<uint64_t> BTree<K, Comp>::lookup(K key) {
     found = true;
     tid = leaf->keyValuePairs[pos].second;
   }
-  bufferManager.unfixPage(*leafFrame, false);
   return boost::optional<uint64_t> { found, tid };
 }
 
@@ -169,20 +200,22 @@ std::vector<uint64_t> BTree<K, Comp>::lookupRange(K key1, K key2) {
     rightK = key1;
   }
 
-  BufferFrame* leafFrame = traverseToLeaf(leftK, false);
-  Node<K, Comp>* leaf = reinterpret_cast<Node<K, Comp>*>(leafFrame->getData());
+  PageGuard leafPage = traverseToLeaf(leftK, false);
+  Node<K, Comp>* leaf = reinterpret_cast<Node<K, Comp>*>(leafPage.getData());
 
   uint64_t pos = leaf->findKeyPos(leftK, smaller);
   if (pos >= leaf->count || smaller(leaf->keyValuePairs[pos].first, leftK)) {
     //No matching key was found
-    bufferManager.unfixPage(*leafFrame, false);
     return resultSet;
   }
 
   while (true) {
+    //read the next leaf while this one is being processed
+    if (leaf->next != std::numeric_limits<uint64_t>::max()) {
+      bufferManager.prefetch(leaf->next, 1);
+    }
     while (pos < leaf->count) {
       if (smaller(rightK, leaf->keyValuePairs[pos].first)) {
-        bufferManager.unfixPage(*leafFrame, false);
         return resultSet;
       }
       resultSet.push_back(leaf->keyValuePairs[pos].second);
@@ -190,20 +223,16 @@ std::vector<uint64_t> BTree<K, Comp>::lookupRange(K key1, K key2) {
     }
     if (leaf->next == std::numeric_limits<uint64_t>::max()) {
       //There is no next leaf --> return
-      bufferManager.unfixPage(*leafFrame, false);
       return resultSet;
     } else {
-      //Continue in next Leaf. Get it and unfix current Leaf
+      //Continue in next Leaf. Unfix current Leaf and get the next one
       uint64_t nextLeafPID = leaf->next;
-      bufferManager.unfixPage(*leafFrame, false);
-      leafFrame = &bufferManager.fixPage(nextLeafPID, false);
-      leaf = reinterpret_cast<Node<K, Comp>*>(leafFrame->getData());
+      leafPage.release();
+      leafPage = bufferManager.fixPageGuarded(nextLeafPID, false);
+      leaf = reinterpret_cast<Node<K, Comp>*>(leafPage.getData());
       pos = 0;
     }
   }
-
-  bufferManager.unfixPage(*leafFrame, false);
-  return resultSet;
 }
 
 template<typename K, typename Comp>
@@ -215,8 +244,8 @@ void BTree<K, Comp>::exportAsDot(std::ostream& out) {
     uint64_t pid = pidQueue.back();
     pidQueue.pop_back();
     //fix page
-    BufferFrame& bf = bufferManager.fixPage(pid, false);
-    Node<K, Comp> *currNode = reinterpret_cast<Node<K, Comp>*>(bf.getData());
+    PageGuard page = bufferManager.fixPageGuarded(pid, false);
+    Node<K, Comp> *currNode = reinterpret_cast<Node<K, Comp>*>(page.getData());
     if(currNode->isLeaf()) {
       out << "node" << pid << " [shape=record, label=\"<count> " << (currNode->count) << " | ";
       for(uint64_t i = 0; i < currNode->count; i++) {
@@ -241,8 +270,6 @@ void BTree<K, Comp>::exportAsDot(std::ostream& out) {
       out << "node" << pid << ":ptr" << currNode->count << " -> node" << currNode->next << ";" <<std::endl;
       pidQueue.push_back(currNode->next);
     }
-    //unfix page
-    bufferManager.unfixPage(bf, false);
   }
   out << "}";
 }
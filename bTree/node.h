@@ -17,6 +17,8 @@ namespace dbImpl {
 
     inline bool isLeaf();
     uint64_t findKeyPos(const K key, const Comp& smaller);
+    //searches only the first count entries, e.g. while the node is read optimistically
+    uint64_t findKeyPos(const K key, const Comp& smaller, uint64_t count);
     bool insertKey(K key, uint64_t tid, const Comp& smaller);
     void insertInnerKey(K key, uint64_t leftChildPID, uint64_t rightChildPID, const Comp& smaller);
     bool deleteKey(K key, const Comp& smaller);
@@ -11,6 +11,11 @@ inline bool Node<K, Comp>::isLeaf() {
 
 template<typename K, typename Comp>
 inline uint64_t Node<K, Comp>::findKeyPos(const K key, const Comp& smaller) {
+  return findKeyPos(key, smaller, count);
+}
+
+template<typename K, typename Comp>
+inline uint64_t Node<K, Comp>::findKeyPos(const K key, const Comp& smaller, uint64_t count) {
   uint64_t left = 0;
   uint64_t right = count;
   while (right != left) {
@@ -0,0 +1,65 @@
+#ifndef _ARC_HPP_
+#define _ARC_HPP_
+
+#include <unordered_map>
+#include <list>
+#include <vector>
+#include "buffer/replacementPolicy.h"
+
+namespace dbImpl {
+
+  /*
+   * Manages elements according to the Adaptive Replacement Cache (ARC) strategy.
+   *
+   * Resident pages are kept in T1 (seen once recently) and T2 (seen at least
+   * twice). The ghost lists B1 and B2 remember pages recently evicted from
+   * T1 resp. T2. Hits on ghosts adapt the target size of T1.
+   */
+  template<typename T>
+  class Arc : public ReplacementPolicy<T> {
+    public:
+      // capacity is the number of resident pages. At most as many ghosts are remembered.
+      Arc(size_t capacity);
+
+      T evict() override;
+
+      // Rejected pages are moved to the front of their list.
+      // They are not turned into ghosts.
+      T evictIf(const std::function<bool(T)>& evictable) override;
+
+      void access(T pageId) override;
+
+      bool empty() override;
+
+      void erase(T pageId) override;
+
+      // Ghosts in B1 and B2 are kept.
+      void eraseResident(T pageId) override;
+
+      void peekVictims(size_t count, std::vector<T>& victims) const override;
+
+    private:
+      enum ListId { T1 = 0, T2 = 1, B1 = 2, B2 = 3 };
+      typedef typename std::list<T>::iterator list_iterator;
+      struct Entry {
+        ListId list;
+        list_iterator position;
+      };
+
+      // moves a page to the front (MRU end) of the given list
+      void moveTo(T pageId, ListId list);
+      // forgets the oldest ghosts if the history grew too large
+      void trimHistory();
+
+      size_t capacity;
+      // target size of T1
+      size_t target;
+      std::list<T> lists[4];
+      std::unordered_map<T, Entry> entries;
+  };
+
+}
+
+#include "buffer/arc.inl.cpp"
+
+#endif
@@ -0,0 +1,132 @@
+#include "buffer/arc.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace dbImpl {
+
+  template<typename T>
+  Arc<T>::Arc(size_t capacity) : capacity(capacity), target(0) {}
+
+  template<typename T>
+  T Arc<T>::evict() {
+    if (empty()) {
+      throw std::runtime_error("evict() called on empty ARC");
+    }
+    return evictIf([](T) { return true; });
+  }
+
+  template<typename T>
+  T Arc<T>::evictIf(const std::function<bool(T)>& evictable) {
+    // Rejected pages are moved to the front of their list, so the sizes of
+    // the lists do not change. Every page is checked at most once.
+    size_t t1Checked = 0;
+    size_t t2Checked = 0;
+    while (true) {
+      bool t1Left = t1Checked < lists[T1].size();
+      bool t2Left = t2Checked < lists[T2].size();
+      // evict from T1 if it is larger than its target size
+      ListId from;
+      if (t1Left && (lists[T1].size() > target || !t2Left)) {
+        from = T1;
+      } else if (t2Left) {
+        from = T2;
+      } else {
+        throw std::runtime_error("ARC does not contain an evictable page");
+      }
+      T candidate = lists[from].back();
+      if (evictable(candidate)) {
+        moveTo(candidate, from == T1 ? B1 : B2);
+        trimHistory();
+        return candidate;
+      }
+      moveTo(candidate, from);
+      (from == T1 ? t1Checked : t2Checked)++;
+    }
+  }
+
+  template<typename T>
+  void Arc<T>::access(T pageId) {
+    auto it = entries.find(pageId);
+    if (it == entries.end()) {
+      lists[T1].push_front(pageId);
+      Entry& entry = entries[pageId];
+      entry.list = T1;
+      entry.position = lists[T1].begin();
+      trimHistory();
+      return;
+    }
+    // a ghost hit shows that the corresponding list should have been larger
+    size_t b1Size = lists[B1].size();
+    size_t b2Size = lists[B2].size();
+    if (it->second.list == B1) {
+      target = std::min(capacity, target + std::max<size_t>(b2Size / b1Size, 1));
+    } else if (it->second.list == B2) {
+      size_t delta = std::max<size_t>(b1Size / b2Size, 1);
+      target = target > delta ? target - delta : 0;
+    }
+    moveTo(pageId, T2);
+  }
+
+  template<typename T>
+  bool Arc<T>::empty() {
+    return lists[T1].empty() && lists[T2].empty();
+  }
+
+  template<typename T>
+  void Arc<T>::erase(T pageId) {
+    auto it = entries.find(pageId);
+    if (it != entries.end()) {
+      lists[it->second.list].erase(it->second.position);
+      entries.erase(it);
+    }
+  }
+
+  template<typename T>
+  void Arc<T>::eraseResident(T pageId) {
+    auto it = entries.find(pageId);
+    if (it != entries.end() && (it->second.list == T1 || it->second.list == T2)) {
+      lists[it->second.list].erase(it->second.position);
+      entries.erase(it);
+    }
+  }
+
+  template<typename T>
+  void Arc<T>::peekVictims(size_t count, std::vector<T>& victims) const {
+    // replays evict() without modifying the lists
+    auto t1 = lists[T1].rbegin();
+    auto t2 = lists[T2].rbegin();
+    size_t t1Size = lists[T1].size();
+    size_t t2Size = lists[T2].size();
+    for (; count > 0 && t1Size + t2Size > 0; count--) {
+      if (t1Size > 0 && (t1Size > target || t2Size == 0)) {
+        victims.push_back(*t1++);
+        t1Size--;
+      } else {
+        victims.push_back(*t2++);
+        t2Size--;
+      }
+    }
+  }
+
+  template<typename T>
+  void Arc<T>::moveTo(T pageId, ListId list) {
+    Entry& entry = entries[pageId];
+    lists[list].splice(lists[list].begin(), lists[entry.list], entry.position);
+    entry.list = list;
+  }
+
+  template<typename T>
+  void Arc<T>::trimHistory() {
+    while (lists[T1].size() + lists[B1].size() > capacity && !lists[B1].empty()) {
+      entries.erase(lists[B1].back());
+      lists[B1].pop_back();
+    }
+    while (lists[T1].size() + lists[T2].size() + lists[B1].size() + lists[B2].size() > 2 * capacity
+        && !lists[B2].empty()) {
+      entries.erase(lists[B2].back());
+      lists[B2].pop_back();
+    }
+  }
+
+}
@@ -1,21 +1,29 @@
 #include "buffer/bufferFrame.h"
 
 #include <unistd.h>
-#include <algorithm> //std::min
-#include <stdlib.h>
+#include <limits>
 #include <system_error>
 
 namespace dbImpl {
 
-  BufferFrame::BufferFrame(uint64_t pageId, uint64_t pageSize) : pageId(pageId) {
+  BufferFrame::BufferFrame() : pageId(std::numeric_limits<uint64_t>::max()) {
     pthread_rwlock_init(&latch, nullptr);
-    data = reinterpret_cast<uint8_t*> (malloc(pageSize));
+    data = nullptr;
+    size = 0;
+    trailerSize = 0;
+    pageClass = 0;
+    node = 0;
+    mapped = false;
+    lsn = 0;
+    nextInBucket = nullptr;
     dirty = false;
-    users = 0;
+    fixCount = 0;
+    loading = false;
+    loadFailed = false;
+    version = 0;
   }
 
   BufferFrame::~BufferFrame() {
-    free(data);
     pthread_rwlock_destroy(&latch);
   }
 
@@ -23,8 +31,11 @@ namespace dbImpl {
     return data;
   }
 
+  uint32_t BufferFrame::getSize() {
+    return size - trailerSize;
+  }
+
   void BufferFrame::lock(bool exclusive) {
-    users++;
     int ret;
     if (exclusive) {
       ret = pthread_rwlock_wrlock(&latch);
@@ -34,6 +45,9 @@ namespace dbImpl {
     if(ret != 0) {
       throw std::system_error(std::error_code(ret, std::system_category()), "unable to lock frame");
     }
+    if (exclusive) {
+      version++;
+    }
   }
 
   bool BufferFrame::tryLock(bool exclusive) {
@@ -44,6 +58,9 @@ namespace dbImpl {
       ret = pthread_rwlock_tryrdlock(&latch);
     }
     if(ret == 0) {
+      if (exclusive) {
+        version++;
+      }
       return true;
     } else if(ret == EBUSY) {
       return false;
@@ -53,15 +70,18 @@ namespace dbImpl {
   }
 
   void BufferFrame::unlock() {
+    // only an exclusive latch holder can observe an odd version
+    if (version.load(std::memory_order_relaxed) & 1) {
+      version.fetch_add(1, std::memory_order_release);
+    }
     int ret = pthread_rwlock_unlock(&latch);
     if(ret != 0) {
       throw std::system_error(std::error_code(ret, std::system_category()), "unable to unlock frame");
     }
-    users = std::min((unsigned int)0,users-1);
   }
 
   bool BufferFrame::isUsed() {
-    return users > 0;
+    return fixCount > 0;
   }
 
 }
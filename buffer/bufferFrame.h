@@ -2,6 +2,7 @@
 #define _BUFFER_FRAME_H_
 
 #include <cstdint>
+#include <atomic>
 #include "pthread.h"
 
 namespace dbImpl {
@@ -18,25 +19,59 @@ namespace dbImpl {
       //deleted operator= => non copyable
       const BufferFrame& operator=(const BufferFrame&) = delete;
 
-      const uint64_t pageId;
-      
+      // the page currently stored in this frame.
+      // Frames are reused for different pages, but the pageId never changes
+      // while the frame is fixed. Must only be modified by the BufferManager.
+      uint64_t pageId;
+
       // constructor
-      BufferFrame(uint64_t pageId, uint64_t bufferSize);
+      BufferFrame();
       // destructor
       virtual ~BufferFrame();
       // returns data from page
       uint8_t* getData();
+      // returns the size of the page in bytes
+      uint32_t getSize();
 
 
       bool isUsed();
 
     private:
       bool dirty;
-      unsigned int users;
-      // pointer to the actual data
+      // number of threads which currently have this page fixed.
+      // Pinned frames are never evicted. The counter is only incremented
+      // while holding the mutex of the page table partition containing this frame.
+      std::atomic<unsigned> fixCount;
+      // set while the page is read from disk. Nobody may latch
+      // the frame before the read completed.
+      std::atomic<bool> loading;
+      // set if the read failed. The page must be read again.
+      std::atomic<bool> loadFailed;
+      // pointer to the actual data. Points into the BufferManager's frame pool.
       uint8_t* data;
+      // size of the data. Frames of different page classes store pages of different sizes.
+      uint32_t size;
+      // number of bytes at the end of the data reserved for the page's checksum.
+      // They are not part of the page's usable size.
+      uint32_t trailerSize;
+      // index of the BufferManager's page class this frame belongs to
+      unsigned pageClass;
+      // NUMA node whose memory backs the frame's part of the frame pool
+      unsigned node;
+      // set if data points into the mapping of a read-only segment
+      // instead of the frame pool
+      bool mapped;
+      // LSN of the last logged modification. The page must not be written
+      // before the log is durable up to this LSN. Protected by the latch.
+      uint64_t lsn;
+      // next frame within the same bucket of the page table
+      BufferFrame* nextInBucket;
       // frame's lock
       pthread_rwlock_t latch;
+      // incremented whenever an exclusive latch is acquired or released, i.e. it
+      // is odd while the frame is latched exclusively. Optimistic readers do not
+      // latch the frame, they only check that the version did not change.
+      std::atomic<uint64_t> version;
       // locks this frame with a write or read lock
       void lock(bool exclusive);
       // tries to acquire the lock. does not block.
@@ -4,21 +4,101 @@
 #include <fcntl.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <limits.h>
 #include <cstring>
+#include <limits>
+#include <algorithm>
 #include <stdexcept>
 #include <system_error>
 #include <sstream>
-#include <stack>
+#include <chrono>
 #include "utils/checkedIO.h"
+#include "utils/numa.h"
+#include "utils/lz4.h"
+#include "utils/crc32c.h"
+#include "buffer/twoQ.h"
+#include "buffer/clock.h"
+#include "buffer/lruK.h"
+#include "buffer/arc.h"
 
 namespace dbImpl {
 
-BufferManager::BufferManager(uint64_t size) :
-    size(size) {
-  //by reserving enough space in the map, we can be sure that no
-  //rehash will ever be necessary. Hence, we can store iterators
-  //to this unordered_map safely without any iterator being invalidated.
-  frames.reserve(size);
+const unsigned BufferManager::partitionBits = 6;
+const unsigned BufferManager::partitionCount = 1 << partitionBits;
+const unsigned BufferManager::accessLogBatchSize = 32;
+const unsigned BufferManager::accessLogCapacity = 128;
+const uint64_t BufferManager::segmentExtentPages = 256;
+const uint64_t BufferManager::warmUpRunPages = 256;
+const uint32_t BufferManager::compressionSectorSize = 4096;
+const uint32_t BufferManager::pageTrailerSize = 8;
+
+namespace {
+  // numbers the threads in the order of their first counted event.
+  // The stripes are assigned to them in a round robin fashion.
+  std::atomic<unsigned> nextStatsThread(0);
+}
+
+BufferManager::BufferManager(uint64_t size, const BufferOptions& options) :
+    size(0), partitions(new Partition[partitionCount]),
+    trace(nullptr), writerStopping(false), writerIntervalMs(0),
+    statsStripeCount(std::max(1u, std::thread::hardware_concurrency())),
+    stats(new StatsStripe[statsStripeCount]()) {
+  // the default page class comes first, followed by the configured ones
+  std::vector<std::pair<uint32_t, uint64_t>> classSizes;
+  classSizes.emplace_back(options.pageSize, size);
+  for (const PageClassOptions& pageClass : options.pageClasses) {
+    if (pageClass.frames == 0) {
+      throw std::invalid_argument("page classes need at least one frame");
+    }
+    for (uint64_t segmentId : pageClass.segments) {
+      if (!segmentPageClasses.emplace(segmentId, classSizes.size()).second) {
+        throw std::invalid_argument("segment " + std::to_string(segmentId)
+            + " is assigned to multiple page classes");
+      }
+    }
+    classSizes.emplace_back(pageClass.pageSize, pageClass.frames);
+  }
+  for (uint64_t segmentId : options.compressedSegments) {
+    if (options.mappedSegments.count(segmentId) > 0) {
+      throw std::invalid_argument("segment " + std::to_string(segmentId)
+          + " can not be both memory mapped and compressed");
+    }
+  }
+  // the page sizes keep all frames aligned to the operating system's pages.
+  // Direct I/O requires the buffers, offsets and lengths to be aligned to the
+  // device's logical block size, which does not exceed 4 KiB on common devices.
+  uint64_t poolSize = 0;
+  for (auto& classSize : classSizes) {
+    if (classSize.first == 0 || classSize.first % 4096 != 0) {
+      throw std::invalid_argument("page size " + std::to_string(classSize.first)
+          + " is not a multiple of 4 KiB");
+    }
+    this->size += classSize.second;
+    poolSize += classSize.second * classSize.first;
+  }
+  frames.reset(new BufferFrame[this->size]);
+  mappedSegments = options.mappedSegments;
+  compressedSegments = options.compressedSegments;
+  pageChecksums = options.pageChecksums;
+  recovering = false;
+  checkpointLogSize = options.checkpointLogSize;
+  directIO = options.directIO;
+  numaNodes = options.numaNodes == 0 ? numaNodeCount() : options.numaNodes;
+  warmUpFile = options.warmUpFile;
+  warmUpInterval = std::chrono::milliseconds(options.warmUpIntervalMs);
+  // each partition gets enough buckets for a load factor of about 0.5
+  uint64_t bucketCount = 1;
+  while (bucketCount * partitionCount < 2 * this->size) {
+    bucketCount <<= 1;
+  }
+  for (unsigned i = 0; i < partitionCount; i++) {
+    partitions[i].buckets.reset(new BufferFrame*[bucketCount]());
+    partitions[i].bucketMask = bucketCount - 1;
+    partitions[i].node = i % numaNodes;
+    partitions[i].accessLog.reserve(accessLogCapacity);
+  }
   // create segment directory if it doesn't exist
   if (mkdir("segments", S_IRWXU) == -1 && errno != 17) {
     int occurredErrno = errno;
@@ -35,229 +115,1712 @@ BufferManager::BufferManager(uint64_t size) :
         std::error_code(occurredErrno, std::system_category()),
         "unable to open directory \"segments\"");
   }
+  // allocate the memory for all frames at once.
+  // mmap returns page-aligned memory and the kernel only backs the pages
+  // once they are touched.
+  framePoolSize = poolSize;
+  void* pool = MAP_FAILED;
+  if (options.hugePages) {
+    // the length of a huge page mapping must be a multiple of the huge page size
+    const uint64_t hugePageSize = 2 * 1024 * 1024;
+    uint64_t hugePoolSize = (framePoolSize + hugePageSize - 1) / hugePageSize * hugePageSize;
+    pool = mmap(nullptr, hugePoolSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (pool != MAP_FAILED) {
+      framePoolSize = hugePoolSize;
+    } else {
+      errno = 0; //no huge pages reserved. Fall back to transparent huge pages.
+    }
+  }
+  if (pool == MAP_FAILED) {
+    pool = mmap(nullptr, framePoolSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pool == MAP_FAILED) {
+      int occurredErrno = errno;
+      errno = 0; //reset, so that later calls can succeed
+      close(folderFd);
+      throw std::system_error(
+          std::error_code(occurredErrno, std::system_category()),
+          "unable to allocate the frame pool");
+    }
+    if (options.hugePages) {
+      //only a hint, so errors can be ignored
+      madvise(pool, framePoolSize, MADV_HUGEPAGE);
+      errno = 0;
+    }
+  }
+  framePool = reinterpret_cast<uint8_t*>(pool);
+  if (!options.traceFile.empty()) {
+    trace = fopen(options.traceFile.c_str(), "ab");
+    if (trace == nullptr) {
+      int occurredErrno = errno;
+      errno = 0; //reset, so that later calls can succeed
+      close(folderFd);
+      munmap(framePool, framePoolSize);
+      throw std::system_error(
+          std::error_code(occurredErrno, std::system_category()),
+          "unable to open trace file \"" + options.traceFile + "\"");
+    }
+  }
+  pageClasses.resize(classSizes.size());
+  uint64_t firstFrame = 0;
+  uint8_t* classPool = framePool;
+  for (unsigned c = 0; c < pageClasses.size(); c++) {
+    PageClass& pageClass = pageClasses[c];
+    pageClass.pageSize = classSizes[c].first;
+    pageClass.size = classSizes[c].second;
+    uint64_t classSize = pageClass.size;
+    switch (options.replacementStrategy) {
+      case ReplacementStrategy::TwoQ:
+        pageClass.replacement.reset(new TwoQ<uint64_t>(classSize, options.twoQInRatio, options.twoQOutRatio));
+        break;
+      case ReplacementStrategy::Clock:
+        pageClass.replacement.reset(new Clock<uint64_t>(classSize));
+        break;
+      case ReplacementStrategy::LruK:
+        pageClass.replacement.reset(new LruK<uint64_t>());
+        break;
+      case ReplacementStrategy::Arc:
+        pageClass.replacement.reset(new Arc<uint64_t>(classSize));
+        break;
+    }
+    pageClass.maxPrefetchPages = std::max<uint64_t>(classSize / 4, 1);
+    pageClass.writerLowWatermark = std::max<uint64_t>(classSize * options.writerLowWatermark, 1);
+    pageClass.writerHighWatermark = std::max<uint64_t>(classSize * options.writerHighWatermark,
+        pageClass.writerLowWatermark);
+    pageClass.pool = classPool;
+    pageClass.firstFrame = firstFrame;
+    // all frames are free initially. They are pushed in reverse order,
+    // so that the frames at the beginning of the pool are used first.
+    // The class's frames are split into one consecutive range per NUMA node.
+    pageClass.freeFrames.resize(numaNodes);
+    pageClass.freeFrameCount = 0;
+    for (uint64_t i = classSize; i > 0; i--) {
+      BufferFrame& frame = frames[firstFrame + i - 1];
+      frame.data = classPool + (i - 1) * pageClass.pageSize;
+      frame.size = pageClass.pageSize;
+      frame.trailerSize = pageChecksums != PageChecksums::None ? pageTrailerSize : 0;
+      frame.pageClass = c;
+      frame.node = (i - 1) * numaNodes / classSize;
+      pageClass.addFreeFrame(&frame);
+    }
+    if (numaNodes > 1) {
+      // the pool was not touched yet, so the kernel can still place its pages.
+      // The placement is only a hint, the pool works on any node.
+      for (unsigned node = 0; node < numaNodes; node++) {
+        uint64_t nodeStart = (node * classSize + numaNodes - 1) / numaNodes;
+        uint64_t nodeEnd = ((node + 1) * classSize + numaNodes - 1) / numaNodes;
+        if (nodeEnd > nodeStart) {
+          bindToNumaNode(classPool + nodeStart * pageClass.pageSize,
+              (nodeEnd - nodeStart) * pageClass.pageSize, node);
+        }
+      }
+    }
+    firstFrame += classSize;
+    classPool += classSize * pageClass.pageSize;
+  }
+  if (options.ioThreads > 0) {
+    ioPool.reset(new ThreadPool(options.ioThreads));
+  }
+  try {
+    if (!options.logFile.empty()) {
+      log.reset(new WriteAheadLog(options.logFile));
+      recover();
+    }
+    if (!warmUpFile.empty()) {
+      warmUp();
+    }
+  } catch (...) {
+    ioPool.reset();
+    for (auto& segment : segments) {
+      if (segment.second->mapping != nullptr) {
+        munmap(segment.second->mapping, segment.second->mappingSize);
+      }
+      close(segment.second->fd);
+      if (segment.second->mapFd != -1) {
+        close(segment.second->mapFd);
+      }
+    }
+    close(folderFd);
+    munmap(framePool, framePoolSize);
+    if (trace != nullptr) {
+      fclose(trace);
+    }
+    throw;
+  }
+  // the writer is started last. It must not see a partially constructed BufferManager.
+  if (options.backgroundWriter) {
+    uint64_t maxHighWatermark = 0;
+    for (PageClass& pageClass : pageClasses) {
+      maxHighWatermark = std::max(maxHighWatermark, pageClass.writerHighWatermark);
+    }
+    writerIntervalMs = std::max(options.writerIntervalMs, 1u);
+    writerCandidates.reserve(maxHighWatermark);
+    writerFrames.reserve(maxHighWatermark);
+    writerThread = std::thread(&BufferManager::runWriter, this);
+  }
 }
 
 BufferManager::~BufferManager() {
+  //stop the background writer
+  if (writerThread.joinable()) {
+    {
+      std::lock_guard < std::mutex > writerLock(writerMutex);
+      writerStopping = true;
+    }
+    writerWakeup.notify_all();
+    writerThread.join();
+  }
+  //wait for all asynchronous reads
+  ioPool.reset();
+  //the snapshot is only a hint, so errors are ignored
+  try {
+    saveWarmUpSnapshot();
+  } catch (...) {
+  }
   std::lock_guard < std::mutex > globalLock(globalMutex);
-  //flush all dirty pages
-  for (auto& frameEntry : frames) {
-    BufferFrame& frame = frameEntry.second;
+  //flush all dirty pages. Adjacent pages are written together.
+  std::vector<BufferFrame*> dirtyFrames;
+  for (uint64_t i = 0; i < size; i++) {
+    BufferFrame& frame = frames[i];
     //wait until everyone finished accessing this page
     frame.lock(true);
-    if (frame.dirty) {
-      int segmentId = getSegmentIdForPageId(frame.pageId);
-      int segmentFd = segmentFds.at(segmentId);
-      off_t offset = getPartIdForPageId(frame.pageId) * pageSize; dbImpl::checkedPwrite(segmentFd, frame.getData(), pageSize, offset);
+    if (frame.pageId != invalidPageId && frame.dirty) {
+      dirtyFrames.push_back(&frame);
+    } else {
+      frame.unlock();
+    }
+  }
+  std::sort(dirtyFrames.begin(), dirtyFrames.end(),
+      [](BufferFrame* a, BufferFrame* b) { return a->pageId < b->pageId; });
+  size_t runStart = 0;
+  for (size_t i = 1; i <= dirtyFrames.size(); i++) {
+    if (i == dirtyFrames.size() || dirtyFrames[i]->pageId != dirtyFrames[i - 1]->pageId + 1
+        || getSegmentIdForPageId(dirtyFrames[i]->pageId) != getSegmentIdForPageId(dirtyFrames[runStart]->pageId)) {
+      writeFrames(&dirtyFrames[runStart], i - runStart);
+      runStart = i;
+    }
+  }
+  for (BufferFrame* frame : dirtyFrames) {
+    frame->unlock();
+  }
+  //all pages are on disk, so the log is not needed for recovery anymore
+  if (log) {
+    try {
+      syncSegments();
+      log->discard(log->getEndLsn());
+    } catch (...) {
+      //the log is replayed the next time
     }
-    //nobody will be able to acquire this lock in the meantime
-    //since we are holding the globalLock. We must unlock the frame
-    //before destructing it. So, now is a good moment to unlock it.
-    frame.unlock();
+    log.reset();
   }
   //close all files
-  for (auto segment : segmentFds) {
-    close(segment.second);
+  for (auto& segment : segments) {
+    if (segment.second->mapping != nullptr) {
+      munmap(segment.second->mapping, segment.second->mappingSize);
+    }
+    close(segment.second->fd);
+    if (segment.second->mapFd != -1) {
+      close(segment.second->mapFd);
+    }
+  }
+  close(folderFd);
+  munmap(framePool, framePoolSize);
+  if (trace != nullptr) {
+    fclose(trace);
   }
 }
 
 BufferFrame& BufferManager::fixPage(uint64_t pageId, bool exclusive) {
-  std::unique_lock < std::mutex > globalLock(globalMutex);
+  recordTrace(pageId);
+  BufferFrame* frame = pinResidentPage(pageId);
+  if (frame == nullptr) {
+    frame = &fixMissingPage(pageId, exclusive);
+  } else {
+    count(&StatsStripe::hits);
+    latchFrame(*frame, exclusive);
+  }
+  if (numaNodes > 1 && frame->node != getNumaNode()) {
+    count(&StatsStripe::remoteFixes);
+  }
+  return *frame;
+}
 
-  // page is not in buffer and the buffer is to small?
-  //
-  // a simple `if` is not enough since we need to release the global
-  // lock during flushing the evicted page's content to disk and
-  // another thread might slip in, select the same page for eviction and
-  // occupy the slot which was just freed.
-  // On the other hand the other we recheck if the page was already loaded
-  // in every iteration since another thread might have loaded it in the
-  // mean time.
-  while (frames.count(pageId) == 0 && frames.size() >= size) {
-    // pages which are currently getting flushed to disk are still
-    // in the `frames` map but not in the 2Q anymore. Hence, the
-    // 2Q might be empty while the `frames` map is full.
-    if (twoQ.empty()) {
-      while (twoQ.empty()) {
-        twoQAccessed.wait(globalLock);
-      }
-      continue; //we must recheck the loop condition
-    }
-    BufferFrame* evictedFrame;
-    uint64_t evictedPageId;
-    bool foundPageToEvict = false;
-    std::stack < uint64_t > frameStack; //reinsert used elements in twoQ since they should not be evicted
-    while (!foundPageToEvict) {
-      // get page to be evicted from twoQ
-      if (twoQ.empty()) {
-        throw "Cannot fix a page since there is no evictable frame";
+BufferFrame& BufferManager::fixPageOptimistic(uint64_t pageId, uint64_t& version) {
+  recordTrace(pageId);
+  BufferFrame* frame = pinResidentPage(pageId);
+  if (frame == nullptr) {
+    frame = &fixMissingPage(pageId, false);
+    frame->unlock();
+  } else {
+    count(&StatsStripe::hits);
+  }
+  if (numaNodes > 1 && frame->node != getNumaNode()) {
+    count(&StatsStripe::remoteFixes);
+  }
+  if (frame->loading || frame->loadFailed) {
+    // the page must be read completely before anybody may look at it
+    latchFrame(*frame, false);
+    frame->unlock();
+  }
+  version = frame->version.load(std::memory_order_acquire);
+  if (version & 1) {
+    // somebody is modifying the page. Wait until the writer is done.
+    frame->lock(false);
+    version = frame->version.load(std::memory_order_acquire);
+    frame->unlock();
+  }
+  return *frame;
+}
+
+bool BufferManager::validate(BufferFrame& frame, uint64_t version) {
+  // the reads of the page's data must not be reordered after reading the version
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return frame.version.load(std::memory_order_relaxed) == version;
+}
+
+void BufferManager::unfixPageOptimistic(BufferFrame& frame) {
+  frame.fixCount--;
+}
+
+void BufferManager::recordTrace(uint64_t pageId) {
+  if (trace != nullptr) {
+    std::lock_guard < std::mutex > traceLock(traceMutex);
+    fwrite(&pageId, sizeof(pageId), 1, trace);
+  }
+}
+
+BufferFrame* BufferManager::pinResidentPage(uint64_t pageId) {
+  Partition& partition = getPartition(pageId);
+
+  // Only the partition's mutex is acquired. The replacement policy is informed later on
+  // by draining the partition's access log.
+  std::unique_lock < std::mutex > partitionLock(partition.mutex);
+  BufferFrame* frame = partition.find(pageId);
+  if (frame != nullptr) {
+    // pin the frame, so that it won't be evicted
+    frame->fixCount++;
+    partition.accessLog.push_back(pageId);
+    bool shouldDrain = partition.accessLog.size() >= accessLogBatchSize;
+    bool mustDrain = partition.accessLog.size() >= accessLogCapacity;
+    partitionLock.unlock();
+    if (shouldDrain) {
+      // The hit should not wait for the global mutex. If somebody else
+      // is holding it, we simply drain the log on one of the next hits.
+      // Only if the log is full, we have to wait.
+      std::unique_lock < std::mutex > globalLock(globalMutex, std::defer_lock);
+      if (mustDrain) {
+        globalLock.lock();
+      } else {
+        globalLock.try_lock();
       }
-      evictedPageId = twoQ.evict();
-      auto frameIt = frames.find(evictedPageId);
-#ifdef DEBUG
-      if(frameIt == frames.end()) {
-        throw std::logic_error("trying to evict a page which is not in memory");
+      if (globalLock.owns_lock()) {
+        std::lock_guard < std::mutex > relockedPartition(partition.mutex);
+        if (drainAccessLog(partition)) {
+          pageAccessed.notify_all();
+        }
       }
-#endif
-      evictedFrame = &frameIt->second;
-      if (evictedFrame->isUsed()) {
-        //frame must not be evicted. Push it on stack to reinsert it into twoQ later.
-        frameStack.push(evictedPageId);
+    }
+  }
+  return frame;
+}
+
+BufferFrame& BufferManager::fixMissingPage(uint64_t pageId, bool exclusive, bool read) {
+  Partition& partition = getPartition(pageId);
+  PageClass& pageClass = pageClasses[getPageClass(getSegmentIdForPageId(pageId))];
+  unsigned node = getNumaNode();
+  std::unique_lock < std::mutex > partitionLock(partition.mutex, std::defer_lock);
+  BufferFrame* frame;
+  std::unique_lock < std::mutex > globalLock(globalMutex);
+  while (true) {
+    partitionLock.lock();
+    // another thread might have loaded the page while we were not holding
+    // the partition's lock. Hence, we must recheck in every iteration.
+    frame = partition.find(pageId);
+    if (frame != nullptr) {
+      frame->fixCount++;
+      partitionLock.unlock();
+      pageClass.replacement->access(pageId);
+      pageAccessed.notify_all();
+      globalLock.unlock();
+      count(&StatsStripe::hits);
+      latchFrame(*frame, exclusive);
+      return *frame;
+    }
+    frame = pageClass.takeFreeFrame(node);
+    if (frame != nullptr) {
+      // insert page into the partition
+      frame->pageId = pageId;
+      frame->dirty = false;
+      frame->loadFailed = false;
+      frame->fixCount++;
+      // The frame must be marked as loading before the partition's mutex is released,
+      // otherwise other threads could read the page before it was loaded.
+      // Threads fixing the page in the meantime wait for our read instead of
+      // issuing their own, and the frame is not latched while reading, so that
+      // concurrent readers are not serialized.
+      frame->loading = true;
+      partition.insert(frame);
+      partitionLock.unlock();
+      // DO NOT inform the replacement policy about this access before inserting the BufferFrame
+      // into the partition. Otherwise another thread could try to evict the page
+      // before it was even added to the page table.
+      pageClass.replacement->access(pageId);
+      pageAccessed.notify_all();
+      break;
+    }
+    partitionLock.unlock();
+    // page is not in buffer and the buffer is to small
+    //
+    // A single eviction is not necessarily enough since we need to release the global
+    // lock during flushing the evicted page's content to disk and
+    // another thread might slip in and occupy the frame which was just freed.
+    evictPage(pageClass, globalLock);
+  }
+  globalLock.unlock(); // globalLock should not be held during disk I/O
+  count(&StatsStripe::misses);
+
+  try {
+    if (read) {
+      readPage(*frame);
+    }
+  } catch (...) {
+    //the next thread fixing this page will try again
+    completeLoads(&frame, 1, true);
+    frame->fixCount--;
+    throw;
+  }
+  completeLoads(&frame, 1, false);
+
+  // lock the frame with the actually requested lock level. The frame is pinned,
+  // so it cannot be evicted although somebody else might latch it first.
+  latchFrame(*frame, exclusive);
+  return *frame;
+}
+
+void BufferManager::prefetch(uint64_t firstPageId, uint64_t pageCount) {
+  if (!ioPool) {
+    return;
+  }
+  // only pages which exist on disk are prefetched. A hint must neither
+  // create a segment nor fail, so segments which were not opened are skipped.
+  uint64_t firstPartId = getPartIdForPageId(firstPageId);
+  Segment* openedSegment = findSegment(getSegmentIdForPageId(firstPageId));
+  if (openedSegment == nullptr) {
+    return;
+  }
+  Segment& segment = *openedSegment;
+  uint64_t pagesOnDisk = segment.pageCount;
+  if (firstPartId >= pagesOnDisk) {
+    return;
+  }
+  PageClass& pageClass = pageClasses[getPageClass(getSegmentIdForPageId(firstPageId))];
+  pageCount = std::min(pageCount, pagesOnDisk - firstPartId);
+  if (segment.mapping != nullptr) {
+    // the kernel reads the mapped pages, no frames are needed
+    madvise(segment.mapping + firstPartId * segment.pageSize,
+        pageCount * segment.pageSize, MADV_WILLNEED);
+    errno = 0; //only a hint
+    return;
+  }
+  pageCount = std::min(pageCount, pageClass.maxPrefetchPages);
+  // skip the resident pages at the front without taking the global mutex,
+  // so prefetching resident pages, e.g. for random lookups, is cheap
+  while (pageCount > 0) {
+    Partition& partition = getPartition(firstPageId);
+    std::lock_guard < std::mutex > partitionLock(partition.mutex);
+    if (partition.find(firstPageId) == nullptr) {
+      break;
+    }
+    firstPageId++;
+    pageCount--;
+  }
+  if (pageCount == 0) {
+    return;
+  }
+
+  // consecutive missing pages are collected into runs.
+  // Each run is read by one preadv call.
+  std::vector<BufferFrame*> run;
+  auto submitRun = [this, &run]() {
+    if (!run.empty()) {
+      std::vector<BufferFrame*> submitted;
+      submitted.swap(run);
+      ioPool->submit([this, submitted]() { readPagesAsync(submitted); });
+    }
+  };
+  std::unique_lock < std::mutex > globalLock(globalMutex);
+  for (uint64_t i = 0; i < pageCount; i++) {
+    uint64_t pageId = firstPageId + i;
+    Partition& partition = getPartition(pageId);
+    BufferFrame* frame = nullptr;
+    bool resident = false;
+    while (frame == nullptr && !resident) {
+      std::unique_lock < std::mutex > partitionLock(partition.mutex);
+      if (partition.find(pageId) != nullptr) {
+        resident = true;
+      } else if (pageClass.freeFrameCount > 0) {
+        frame = pageClass.takeFreeFrame(partition.node);
+        frame->pageId = pageId;
+        frame->dirty = false;
+        frame->loadFailed = false;
+        frame->loading = true;
+        // the frame stays pinned until the read completed
+        frame->fixCount++;
+        partition.insert(frame);
+        partitionLock.unlock();
+        pageClass.replacement->access(pageId);
+        pageAccessed.notify_all();
       } else {
-        foundPageToEvict = true;
+        partitionLock.unlock();
+        // prefetching is only a hint. Give up instead of waiting for a frame.
+        bool evicted;
+        try {
+          evicted = evictPage(pageClass, globalLock, false);
+        } catch (std::runtime_error&) {
+          evicted = false;
+        }
+        if (!evicted) {
+          globalLock.unlock();
+          submitRun();
+          return;
+        }
       }
     }
-    //reinsert all used Frames into twoQ since they were not evicted
-    while(!frameStack.empty()){
-      twoQ.access(frameStack.top());
-      frameStack.pop();
-    }
-    // before deleting the frame, we need to get an exclusive lock on it
-    evictedFrame->lock(true); //TODO: exception safe locking...
-    // do we need to flush it?
-    if (!evictedFrame->dirty) {
-      // page is not dirty
-      evictedFrame->unlock();
-      // nobody will be able to acquire this lock in the meantime
-      // since we are holding the globalLock. We must unlock the frame
-      // before destructing it.
-      frames.erase(evictedPageId);
+    if (resident) {
+      submitRun();
     } else {
-      // page IS dirty and needs to be flushed
-      int segmentId = getSegmentIdForPageId(evictedFrame->pageId);
-      int segmentFd = segmentFds.at(segmentId);
-      off_t offset = getPartIdForPageId(evictedFrame->pageId) * pageSize;
-      //release the global lock, write the page
-      globalLock.unlock();
-      dbImpl::checkedPwrite(segmentFd, evictedFrame->getData(), pageSize,
-          offset);
-      //Maybe we actually fail evicting this page (see below), so we
-      //better mark it as pristine to avoid flushing it multiple times
-      evictedFrame->dirty = false;
-      //we can not simply acquire the global lock again, since otherwise
-      //we would acquire the locks in the wrong order. Instead, we first must
-      //unlock the page and then get the global lock.
-      evictedFrame->unlock();
-      //No locks are held here. (1)
-      globalLock.lock();
-      //At point (1) we do not hold any locks. Another thread might have already deleted
-      //the frame or might use the frame which we are currently trying to evict during
-      //this time. If this happens, we simply try to evict another frame.
-      //We MUST retrieve the frame from the map again since another thread might have deleted it already
-      auto frameIt = frames.find(evictedPageId);
-      if (frameIt != frames.end()) {
-        evictedFrame = &frameIt->second;
-        //Only try to lock the frame. If it fails, another thread is already using
-        //this frame again.
-        if (evictedFrame->tryLock(true)) { //point (2)
-          if (!evictedFrame->dirty) {
-            //nobody will be able to acquire this lock in the meantime
-            //since we are holding the globalLock. We must unlock the frame
-            //before destructing it.
-            evictedFrame->unlock();
-            frames.erase(evictedPageId);
-            //we MUST remove the page id from the twoQ again although evict() already
-            //removed it from the twoQ. At point (1) another thread might have slipped in and
-            //accessed the page without modifying it. If it freed its lock before point (2),
-            //this other thread might stay unnoticed. So we better erase this frame from the twoQ again...
-            twoQ.erase(evictedPageId);
-          } else {
-            //frame is dirty again? drop this lock and try again...
-            evictedFrame->unlock();
-          }
+      run.push_back(frame);
+      count(&StatsStripe::prefetchedPages);
+    }
+  }
+  globalLock.unlock();
+  submitRun();
+}
+
+BufferStats BufferManager::getStats() const {
+  BufferStats result = BufferStats();
+  for (unsigned i = 0; i < statsStripeCount; i++) {
+    const StatsStripe& stripe = stats[i];
+    result.hits += stripe.hits.load(std::memory_order_relaxed);
+    result.misses += stripe.misses.load(std::memory_order_relaxed);
+    result.prefetchedPages += stripe.prefetchedPages.load(std::memory_order_relaxed);
+    result.evictions += stripe.evictions.load(std::memory_order_relaxed);
+    result.evictionRetries += stripe.evictionRetries.load(std::memory_order_relaxed);
+    result.foregroundWrites += stripe.foregroundWrites.load(std::memory_order_relaxed);
+    result.backgroundWrites += stripe.backgroundWrites.load(std::memory_order_relaxed);
+    result.backgroundWriteCalls += stripe.backgroundWriteCalls.load(std::memory_order_relaxed);
+    result.evictionWaitNanos += stripe.evictionWaitNanos.load(std::memory_order_relaxed);
+    result.latchWaitNanos += stripe.latchWaitNanos.load(std::memory_order_relaxed);
+    result.commits += stripe.commits.load(std::memory_order_relaxed);
+    result.checkpoints += stripe.checkpoints.load(std::memory_order_relaxed);
+    result.remoteFixes += stripe.remoteFixes.load(std::memory_order_relaxed);
+  }
+  if (log) {
+    result.logSyncs = log->getSyncCount();
+  }
+  return result;
+}
+
+void BufferManager::count(std::atomic<uint64_t> StatsStripe::* counter, uint64_t value) {
+  static thread_local unsigned thread = nextStatsThread++;
+  // there is a stripe per hardware thread, so threads running at the same
+  // time rarely share one and the increment is usually uncontended
+  (stats[thread % statsStripeCount].*counter).fetch_add(value, std::memory_order_relaxed);
+}
+
+void BufferManager::countWait(std::atomic<uint64_t> StatsStripe::* counter,
+    std::chrono::steady_clock::time_point start) {
+  auto waited = std::chrono::steady_clock::now() - start;
+  count(counter, std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count());
+}
+
+std::ostream& operator<<(std::ostream& out, const BufferStats& stats) {
+  out << "hits " << stats.hits
+      << ", misses " << stats.misses
+      << ", prefetched " << stats.prefetchedPages
+      << ", evictions " << stats.evictions
+      << ", eviction retries " << stats.evictionRetries
+      << ", foreground writes " << stats.foregroundWrites
+      << ", background writes " << stats.backgroundWrites
+      << " (" << stats.backgroundWriteCalls << " calls)"
+      << ", eviction wait " << stats.evictionWaitNanos / 1000 << "us"
+      << ", latch wait " << stats.latchWaitNanos / 1000 << "us"
+      << ", commits " << stats.commits
+      << " (" << stats.logSyncs << " log syncs)"
+      << ", checkpoints " << stats.checkpoints
+      << ", remote fixes " << stats.remoteFixes;
+  return out;
+}
+
+uint64_t BufferManager::logUpdate(BufferFrame& frame, uint32_t offset, uint32_t length) {
+  if (!log) {
+    return 0;
+  }
+  // the first modification behind a checkpoint logs the whole page
+  uint64_t lsn = log->appendUpdate(frame.pageId, frame.getData(), frame.getSize(),
+      offset, length, frame.lsn);
+  frame.lsn = lsn;
+  return lsn;
+}
+
+void BufferManager::commit(uint64_t lsn) {
+  if (log) {
+    count(&StatsStripe::commits);
+    log->flush(lsn);
+  }
+}
+
+void BufferManager::checkpoint() {
+  // all records up to here are covered once the currently dirty pages are written
+  uint64_t lsn = log ? log->beginCheckpoint() : 0;
+  count(&StatsStripe::checkpoints);
+  std::vector<uint64_t> residentPages;
+  {
+    std::lock_guard < std::mutex > globalLock(globalMutex);
+    for (uint64_t i = 0; i < size; i++) {
+      if (frames[i].pageId != invalidPageId) {
+        residentPages.push_back(frames[i].pageId);
+      }
+    }
+  }
+  // the pages are written one by one. Blocking on a latch is fine as
+  // long as we do not hold any other latch.
+  for (uint64_t pageId : residentPages) {
+    Partition& partition = getPartition(pageId);
+    BufferFrame* frame;
+    {
+      std::lock_guard < std::mutex > partitionLock(partition.mutex);
+      frame = partition.find(pageId);
+      if (frame == nullptr) {
+        continue; //evicted in the meantime, so it was written already
+      }
+      frame->fixCount++;
+    }
+    latchFrame(*frame, false);
+    if (frame->dirty) {
+      try {
+        writeFrame(*frame);
+      } catch (...) {
+        frame->unlock();
+        frame->fixCount--;
+        throw;
+      }
+      frame->dirty = false;
+    }
+    frame->unlock();
+    frame->fixCount--;
+  }
+  // the pages must be durable before their log records are discarded
+  syncSegments();
+  if (log) {
+    log->discard(lsn);
+  }
+}
+
+void BufferManager::writePages(uint64_t firstPageId, uint64_t pageCount) {
+  std::vector<BufferFrame*> run;
+  for (uint64_t pageId = firstPageId; pageId <= firstPageId + pageCount; pageId++) {
+    BufferFrame* frame = nullptr;
+    if (pageId < firstPageId + pageCount) {
+      Partition& partition = getPartition(pageId);
+      std::lock_guard < std::mutex > partitionLock(partition.mutex);
+      frame = partition.find(pageId);
+      if (frame != nullptr) {
+        frame->fixCount++;
+      }
+    }
+    // we must not block on a latch while holding the latches of the run
+    if (frame != nullptr) {
+      if (frame->tryLock(false)) {
+        if (frame->dirty) {
+          run.push_back(frame);
+          continue;
         }
+        frame->unlock();
+      }
+      frame->fixCount--;
+    }
+    // the run ends at pages which are missing, clean or latched
+    if (!run.empty()) {
+      try {
+        writeFrames(run.data(), run.size());
+      } catch (...) {
+        for (BufferFrame* written : run) {
+          written->unlock();
+          written->fixCount--;
+        }
+        throw;
+      }
+      for (BufferFrame* written : run) {
+        written->dirty = false;
+        written->unlock();
+        written->fixCount--;
+      }
+      run.clear();
+    }
+  }
+}
+
+void BufferManager::recover() {
+  // a page torn by a crash fails its checksum, but the log's records restore it
+  recovering = true;
+  log->replay([this](uint64_t pageId, uint32_t offset, const uint8_t* data, uint32_t length) {
+    if (static_cast<uint64_t>(offset) + length > getPageSize(getSegmentIdForPageId(pageId))) {
+      throw std::runtime_error("invalid record in the write-ahead log");
+    }
+    // replay starts from the page's full image. The page is not read,
+    // it might be torn on disk.
+    BufferFrame* frame = pinResidentPage(pageId);
+    if (frame == nullptr) {
+      bool fullPage = offset == 0 && length == getPageSize(getSegmentIdForPageId(pageId));
+      frame = &fixMissingPage(pageId, true, !fullPage);
+    } else {
+      latchFrame(*frame, true);
+    }
+    std::memcpy(frame->getData() + offset, data, length);
+    unfixPage(*frame, true);
+  });
+  recovering = false;
+  // writing the recovered pages right away keeps the log short
+  checkpoint();
+}
+
+namespace {
+  // layout of the warm-up file: a header followed by one entry per page
+  struct WarmUpHeader {
+    uint64_t magic;
+    uint64_t pageCount;
+  };
+  struct WarmUpEntry {
+    uint64_t pageId;
+    uint64_t frequent;
+  };
+  const uint64_t warmUpMagic = 0x70756d726177ull;
+}
+
+void BufferManager::saveWarmUpSnapshot() {
+  if (warmUpFile.empty()) {
+    return;
+  }
+  // the pages are listed in the order of eviction, so that restoring them
+  // one after the other reproduces the replacement policy's state
+  std::vector<WarmUpEntry> entries;
+  {
+    std::lock_guard < std::mutex > globalLock(globalMutex);
+    drainAccessLogs();
+    std::vector<uint64_t> victims;
+    for (PageClass& pageClass : pageClasses) {
+      victims.clear();
+      pageClass.replacement->peekVictims(pageClass.size, victims);
+      for (uint64_t pageId : victims) {
+        entries.push_back(WarmUpEntry{pageId, pageClass.replacement->isFrequent(pageId)});
       }
     }
   }
+  // the snapshot is written to a temporary file first, so that a crash
+  // does not leave a partially written snapshot behind
+  std::string tmpFile = warmUpFile + ".tmp";
+  int fd = open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd == -1) {
+    int occurredErrno = errno;
+    errno = 0; //reset, so that later calls can succeed
+    throw std::system_error(
+        std::error_code(occurredErrno, std::system_category()),
+        "unable to create warm-up file \"" + tmpFile + "\"");
+  }
+  try {
+    WarmUpHeader header{warmUpMagic, entries.size()};
+    dbImpl::checkedPwrite(fd, &header, sizeof(header), 0);
+    dbImpl::checkedPwrite(fd, entries.data(), entries.size() * sizeof(WarmUpEntry), sizeof(header));
+    if (fdatasync(fd) != 0 || rename(tmpFile.c_str(), warmUpFile.c_str()) != 0) {
+      int occurredErrno = errno;
+      errno = 0; //reset, so that later calls can succeed
+      throw std::system_error(
+          std::error_code(occurredErrno, std::system_category()),
+          "unable to write warm-up file \"" + warmUpFile + "\"");
+    }
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  close(fd);
+}
 
-  //we need to recheck if the page is in the buffer since the global lock
-  //was abandoned at point (1)
-  if (frames.count(pageId) == 0) {
-    // insert page into unordered_map
-    frames.emplace(std::piecewise_construct, std::forward_as_tuple(pageId),
-        std::forward_as_tuple(pageId, pageSize));
-    BufferFrame& frame = frames.at(pageId);
-    // inform twoQ about this access
-    // DO NOT inform the twoQ about this access before inserting the BufferFrame
-    // into the `frames` map. Otherwise another thread could try to evict the page
-    // before it was even added to the `frames` map and this would result in
-    // a SIGSEGV.
-    twoQ.access(pageId);
-    twoQAccessed.notify_one();
-    // lock the frame and unlock the global lock while data is being loaded
-    //TODO: use an exception safe lock mechanism here...
-    frame.lock(true); // while loading we need a write lock
-    globalLock.unlock(); // globalLock should not be held during disk I/O
-
-    //get the segment file's file descriptor
-    //opened file descriptors are cached for performance reasons
-    uint64_t segmentId = getSegmentIdForPageId(pageId);
-    int segmentFd;
-    if (segmentFds.count(segmentId) == 1) { // segment file exists
-      segmentFd = segmentFds.at(segmentId);
-    } else { // segment file does not exist
-      segmentFd = openat(folderFd, std::to_string(segmentId).c_str(),
-          O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
-      if (segmentFd == -1) {
-        int occurredErrno = errno;
-        errno = 0; //reset, so that later calls can succeed
-        std::ostringstream msg;
-        msg << "unable to open segment " << segmentId;
-        throw std::system_error(
-            std::error_code(occurredErrno, std::system_category()), msg.str());
+void BufferManager::warmUp() {
+  // the snapshot is only a hint. A missing or damaged file means starting cold.
+  std::vector<WarmUpEntry> entries;
+  int fd = open(warmUpFile.c_str(), O_RDONLY);
+  if (fd == -1) {
+    errno = 0;
+    return;
+  }
+  try {
+    WarmUpHeader header;
+    dbImpl::checkedPread(fd, &header, sizeof(header), 0);
+    if (header.magic == warmUpMagic) {
+      entries.resize(header.pageCount);
+      dbImpl::checkedPread(fd, entries.data(), entries.size() * sizeof(WarmUpEntry), sizeof(header));
+    }
+  } catch (std::exception&) {
+    entries.clear();
+  }
+  close(fd);
+  // only pages which exist on disk are loaded. If a page class shrunk,
+  // its hottest pages, i.e. the last ones, are preferred.
+  std::vector<std::vector<WarmUpEntry>> classEntries(pageClasses.size());
+  for (auto it = entries.rbegin(); it != entries.rend(); it++) {
+    uint64_t segmentId = getSegmentIdForPageId(it->pageId);
+    std::vector<WarmUpEntry>& restored = classEntries[getPageClass(segmentId)];
+    if (restored.size() == pageClasses[getPageClass(segmentId)].size) {
+      continue;
+    }
+    try {
+      Segment& segment = getSegment(segmentId);
+      if (segment.mapping == nullptr && getPartIdForPageId(it->pageId) < segment.pageCount) {
+        restored.push_back(*it);
       }
-      segmentFds[segmentId] = segmentFd;
+    } catch (std::exception&) {
+      errno = 0;
     }
+  }
+  std::vector<BufferFrame*> loading;
+  {
+    std::lock_guard < std::mutex > globalLock(globalMutex);
+    for (unsigned c = 0; c < pageClasses.size(); c++) {
+      PageClass& pageClass = pageClasses[c];
+      for (auto it = classEntries[c].rbegin(); it != classEntries[c].rend(); it++) {
+        Partition& partition = getPartition(it->pageId);
+        std::lock_guard < std::mutex > partitionLock(partition.mutex);
+        if (pageClass.freeFrameCount == 0 || partition.find(it->pageId) != nullptr) {
+          continue;
+        }
+        BufferFrame* frame = pageClass.takeFreeFrame(partition.node);
+        frame->pageId = it->pageId;
+        frame->dirty = false;
+        frame->loadFailed = false;
+        frame->loading = true;
+        // the frame stays pinned until the read completed
+        frame->fixCount++;
+        partition.insert(frame);
+        pageClass.replacement->restore(it->pageId, it->frequent != 0);
+        loading.push_back(frame);
+      }
+    }
+  }
+  count(&StatsStripe::prefetchedPages, loading.size());
+  // read the pages in sorted order, consecutive pages using a single request
+  std::sort(loading.begin(), loading.end(),
+      [](BufferFrame* a, BufferFrame* b) { return a->pageId < b->pageId; });
+  size_t runStart = 0;
+  for (size_t i = 1; i <= loading.size(); i++) {
+    if (i == loading.size() || loading[i]->pageId != loading[i - 1]->pageId + 1
+        || getSegmentIdForPageId(loading[i]->pageId) != getSegmentIdForPageId(loading[runStart]->pageId)
+        || i - runStart == warmUpRunPages) {
+      std::vector<BufferFrame*> run(loading.begin() + runStart, loading.begin() + i);
+      if (ioPool) {
+        ioPool->submit([this, run]() { readPagesAsync(run); });
+      } else {
+        readPagesAsync(run);
+      }
+      runStart = i;
+    }
+  }
+}
 
-    off_t offset = getPartIdForPageId(pageId) * pageSize;
-    // does this page already exist on the disk?
-    struct stat segmentStat;
-    if (fstat(segmentFd, &segmentStat) != 0) {
+void BufferManager::syncSegments() {
+  std::lock_guard < std::mutex > segmentLock(segmentMutex);
+  for (auto& segment : segments) {
+    // extents released while syncing are not covered by this sync
+    std::vector<PageExtent> released;
+    if (segment.second->compressed) {
+      std::lock_guard < std::mutex > extentLock(segment.second->extentMutex);
+      released.swap(segment.second->releasedExtents);
+    }
+    if (segment.second->mapping == nullptr && (fdatasync(segment.second->fd) != 0
+        || (segment.second->mapFd != -1 && fdatasync(segment.second->mapFd) != 0))) {
       int occurredErrno = errno;
       errno = 0; //reset, so that later calls can succeed
+      if (!released.empty()) {
+        std::lock_guard < std::mutex > extentLock(segment.second->extentMutex);
+        segment.second->releasedExtents.insert(segment.second->releasedExtents.end(),
+            released.begin(), released.end());
+      }
       std::ostringstream msg;
-      msg << "unable to stat segment " << segmentId;
+      msg << "unable to sync segment " << segment.first;
       throw std::system_error(
           std::error_code(occurredErrno, std::system_category()), msg.str());
     }
-    if (segmentStat.st_size > offset) {
-      // load page from disk
-      dbImpl::checkedPread(segmentFd, frame.getData(), pageSize, offset);
-    } else {
-      // initialize the memory
-      std::memset(frame.getData(), 0, pageSize);
+    if (!released.empty()) {
+      std::lock_guard < std::mutex > extentLock(segment.second->extentMutex);
+      for (const PageExtent& extent : released) {
+        segment.second->freeExtents.emplace(extent.sectors, extent.offset);
+      }
     }
+  }
+}
 
-    // lock the frame with the actually requested lock level
-    if (!exclusive) {
-      //we need to downgrade the lock
-      //TODO: the downgrade mechanism
-      //        frame.unlock();
-      //        frame.lock(exclusive);
-      //      would not be thread safe since another thread might
-      //      kick in and evict the page in the meantime.
-      //      Nobody (except for performance) gets harmed if we hand out an
-      //      exclusive lock instead of a reader lock, so we simply skip the
-      //      downgrade
-    }
-    return frame;
+PageGuard BufferManager::fixPageGuarded(uint64_t pageId, bool exclusive) {
+  return PageGuard(*this, fixPage(pageId, exclusive), exclusive);
+}
+
+void BufferManager::unfixPage(BufferFrame& frame, bool isDirty) {
+  if (isDirty) {
+    frame.dirty = true;
+  }
+  frame.unlock();
+  // unpin only after unlocking. An unpinned frame might get evicted immediately.
+  frame.fixCount--;
+}
+
+bool BufferManager::evictPage(PageClass& pageClass, std::unique_lock<std::mutex>& globalLock, bool mayWait) {
+  ReplacementPolicy<uint64_t>& replacement = *pageClass.replacement;
+  // the replacement policy should know about all recent hits before we select a victim
+  drainAccessLogs();
+  // pages which are currently getting flushed to disk are still
+  // in the page table but not in the replacement policy anymore. Hence, the
+  // policy might be empty while the buffer is full.
+  if (replacement.empty()) {
+    if (!mayWait) {
+      return false;
+    }
+    auto waitStart = std::chrono::steady_clock::now();
+    pageAccessed.wait(globalLock);
+    countWait(&StatsStripe::evictionWaitNanos, waitStart);
+    return true; //the caller must recheck if the page is still missing
+  }
+  // Pinned pages are skipped by the replacement policy. They stay in the policy,
+  // which moves them out of the way of the next searches, so that many
+  // pinned frames do not make every eviction scan the whole pool.
+  std::unique_lock < std::mutex > partitionLock;
+  BufferFrame* frame = nullptr;
+  uint64_t pinnedPages = 0;
+  auto isUnpinned = [&](uint64_t pageId) {
+    Partition& candidatePartition = getPartition(pageId);
+    std::unique_lock < std::mutex > candidateLock(candidatePartition.mutex);
+    BufferFrame* candidate = candidatePartition.find(pageId);
+#ifdef DEBUG
+    if(candidate == nullptr) {
+      throw std::logic_error("trying to evict a page which is not in memory");
+    }
+#endif
+    if (candidate->fixCount > 0) {
+      pinnedPages++;
+      return false;
+    }
+    // keep holding the partition's lock, so that nobody pins the victim
+    partitionLock = std::move(candidateLock);
+    frame = candidate;
+    return true;
+  };
+  uint64_t evictedPageId;
+  try {
+    evictedPageId = replacement.evictIf(isUnpinned);
+  } catch (std::runtime_error&) {
+    count(&StatsStripe::evictionRetries, pinnedPages);
+    throw std::runtime_error("Cannot fix a page since there is no evictable frame");
+  }
+  count(&StatsStripe::evictionRetries, pinnedPages);
+  Partition& partition = getPartition(evictedPageId);
+  BufferFrame& evictedFrame = *frame;
+  // The frame is not pinned. Since we are holding the partition's lock,
+  // nobody is able to pin it in the meantime.
+  if (!evictedFrame.dirty) {
+    partition.erase(&evictedFrame);
+    releaseFrame(evictedFrame);
+    count(&StatsStripe::evictions);
+    pageAccessed.notify_all();
+    return true;
+  }
+  // page IS dirty and needs to be flushed.
+  // The background writer apparently could not keep up, so we wake it up.
+  count(&StatsStripe::foregroundWrites);
+  writerWakeup.notify_one();
+  // We pin the frame ourself. This way, the frame stays in the page table and
+  // other threads will not load the outdated version from disk while we are writing.
+  evictedFrame.fixCount++;
+  partitionLock.unlock();
+  //release the global lock, write the page
+  globalLock.unlock();
+  //a shared latch is sufficient, we only need to exclude writers
+  evictedFrame.lock(false);
+  try {
+    writeFrame(evictedFrame);
+  } catch (...) {
+    evictedFrame.unlock();
+    evictedFrame.fixCount--;
+    globalLock.lock();
+    replacement.access(evictedPageId);
+    throw;
+  }
+  //Maybe we actually fail evicting this page (see below), so we
+  //better mark it as pristine to avoid flushing it multiple times
+  evictedFrame.dirty = false;
+  //we can not simply acquire the global lock again, since otherwise
+  //we would acquire the locks in the wrong order. Instead, we first must
+  //unlock the page and then get the global lock.
+  evictedFrame.unlock();
+  globalLock.lock();
+  partitionLock.lock();
+  evictedFrame.fixCount--;
+  //Other threads might have used the frame while we were writing it. Since
+  //they pinned the frame, it is still in the replacement policy or in an access log.
+  //In this case, we simply return and our caller tries to evict another frame.
+  if (evictedFrame.fixCount == 0 && !evictedFrame.dirty) {
+    partition.erase(&evictedFrame);
+    releaseFrame(evictedFrame);
+    count(&StatsStripe::evictions);
+    //we MUST remove the page id from the policy again although evictIf() already
+    //removed it from the policy. While we were not holding the global lock,
+    //another thread might have accessed the page and the access log might
+    //have been drained. The history of the eviction, e.g. 2Q's ghost entry,
+    //must be kept, so that the next access is recognized.
+    replacement.eraseResident(evictedPageId);
+    pageAccessed.notify_all();
   } else {
-    // page is in buffer
-    BufferFrame& frame = frames.at(pageId);
-    frame.lock(exclusive);
-    twoQ.access(pageId);
-    twoQAccessed.notify_one();
-    return frame;
+    count(&StatsStripe::evictionRetries);
   }
+  return true;
 }
 
-void BufferManager::unfixPage(BufferFrame& frame, bool isDirty) {
+bool BufferManager::drainAccessLog(Partition& partition) {
+  bool accessed = false;
+  for (uint64_t pageId : partition.accessLog) {
+    // the page might have been evicted since it was accessed
+    BufferFrame* frame = partition.find(pageId);
+    if (frame != nullptr) {
+      pageClasses[frame->pageClass].replacement->access(pageId);
+      accessed = true;
+    }
+  }
+  partition.accessLog.clear();
+  return accessed;
+}
+
+void BufferManager::drainAccessLogs() {
+  for (unsigned i = 0; i < partitionCount; i++) {
+    std::lock_guard < std::mutex > partitionLock(partitions[i].mutex);
+    drainAccessLog(partitions[i]);
+  }
+}
+
+void BufferManager::relatchFrame(BufferFrame& frame, bool exclusive, bool isDirty) {
+  if (exclusive && frame.mapped) {
+    throw std::logic_error("pages of memory mapped segments are read-only");
+  }
   if (isDirty) {
     frame.dirty = true;
   }
+  // The latch cannot be converted atomically. The frame stays pinned though,
+  // so it is not evicted while it is not latched.
   frame.unlock();
+  if (!frame.tryLock(exclusive)) {
+    auto waitStart = std::chrono::steady_clock::now();
+    frame.lock(exclusive);
+    countWait(&StatsStripe::latchWaitNanos, waitStart);
+  }
+}
+
+void BufferManager::latchFrame(BufferFrame& frame, bool exclusive) {
+  if (frame.loading) {
+    auto waitStart = std::chrono::steady_clock::now();
+    std::unique_lock < std::mutex > loadLock(loadMutex);
+    loadCompleted.wait(loadLock, [&frame] { return !frame.loading; });
+    countWait(&StatsStripe::latchWaitNanos, waitStart);
+  }
+  if (exclusive && frame.mapped) {
+    frame.fixCount--;
+    throw std::logic_error("pages of memory mapped segments are read-only");
+  }
+  // the clock is only read if we actually have to wait
+  if (!frame.tryLock(exclusive)) {
+    auto waitStart = std::chrono::steady_clock::now();
+    frame.lock(exclusive);
+    countWait(&StatsStripe::latchWaitNanos, waitStart);
+  }
+  if (frame.loadFailed) {
+    // the asynchronous read failed, so we try it again synchronously.
+    // This way, the I/O error is reported to the thread which actually needs the page.
+    if (!exclusive) {
+      frame.unlock();
+      frame.lock(true);
+    }
+    if (frame.loadFailed) {
+      try {
+        readPage(frame);
+      } catch (...) {
+        frame.unlock();
+        frame.fixCount--;
+        throw;
+      }
+      frame.loadFailed = false;
+    }
+    if (!exclusive) {
+      frame.unlock();
+      frame.lock(false);
+    }
+  }
+}
+
+void BufferManager::readPage(BufferFrame& frame) {
+  Segment& segment = getSegment(getSegmentIdForPageId(frame.pageId));
+  uint64_t partId = getPartIdForPageId(frame.pageId);
+  if (segment.mapping != nullptr) {
+    // no need to copy anything, the frame simply points into the mapping
+    if (partId >= segment.pageCount) {
+      std::ostringstream msg;
+      msg << "page " << partId << " does not exist in the read-only segment "
+          << getSegmentIdForPageId(frame.pageId);
+      throw std::out_of_range(msg.str());
+    }
+    frame.data = segment.mapping + partId * segment.pageSize;
+    frame.mapped = true;
+    verifyChecksum(segment, frame);
+    return;
+  }
+  if (segment.compressed) {
+    BufferFrame* loaded = &frame;
+    readCompressedPages(segment, &loaded, 1);
+    verifyChecksum(segment, frame);
+    return;
+  }
+  // does this page already exist on the disk?
+  if (partId < segment.pageCount) {
+    // load page from disk
+    dbImpl::checkedPread(segment.fd, frame.getData(), frame.size, partId * frame.size);
+    verifyChecksum(segment, frame);
+  } else {
+    // initialize the memory
+    std::memset(frame.getData(), 0, frame.size);
+  }
+}
+
+void BufferManager::readPagesAsync(const std::vector<BufferFrame*>& run) {
+  bool failed = false;
+  try {
+    uint64_t firstPageId = run.front()->pageId;
+    Segment& segment = getSegment(getSegmentIdForPageId(firstPageId));
+    if (segment.compressed) {
+      readCompressedPages(segment, run.data(), run.size());
+    } else {
+      uint32_t pageSize = run.front()->size;
+      off_t offset = getPartIdForPageId(firstPageId) * pageSize;
+      std::vector<struct iovec> iov(run.size());
+      for (size_t i = 0; i < run.size(); i++) {
+        iov[i].iov_base = run[i]->getData();
+        iov[i].iov_len = pageSize;
+      }
+      // a single preadv call only accepts a limited number of buffers
+      for (size_t i = 0; i < iov.size(); i += IOV_MAX) {
+        int iovcnt = std::min<size_t>(IOV_MAX, iov.size() - i);
+        dbImpl::checkedPreadv(segment.fd, &iov[i], iovcnt, offset + i * pageSize);
+      }
+    }
+    for (BufferFrame* frame : run) {
+      verifyChecksum(segment, *frame);
+    }
+  } catch (...) {
+    //there is nobody we could report the error to.
+    //Whoever fixes one of these pages, will read it again.
+    failed = true;
+  }
+  completeLoads(run.data(), run.size(), failed);
+  for (BufferFrame* frame : run) {
+    frame->fixCount--;
+  }
+}
+
+void BufferManager::completeLoads(BufferFrame* const* loaded, size_t count, bool failed) {
+  {
+    std::lock_guard < std::mutex > loadLock(loadMutex);
+    for (size_t i = 0; i < count; i++) {
+      loaded[i]->loadFailed = failed;
+      loaded[i]->loading = false;
+    }
+  }
+  loadCompleted.notify_all();
+}
+
+void BufferManager::writeFrame(BufferFrame& frame) {
+  Segment& segment = getSegment(getSegmentIdForPageId(frame.pageId));
+  uint64_t partId = getPartIdForPageId(frame.pageId);
+  BufferFrame* written = &frame;
+  flushLog(&written, 1);
+  setChecksum(segment, frame);
+  if (segment.compressed) {
+    writeCompressedPage(segment, frame);
+    return;
+  }
+  allocatePages(segment, partId + 1);
+  dbImpl::checkedPwrite(segment.fd, frame.getData(), frame.size, partId * frame.size);
+  // raise the high-water mark. Concurrent writers might raise it as well.
+  uint64_t pageCount = segment.pageCount;
+  while (pageCount <= partId && !segment.pageCount.compare_exchange_weak(pageCount, partId + 1)) {
+  }
+}
+
+void BufferManager::writeFrames(BufferFrame* const* run, size_t count) {
+  uint64_t firstPageId = run[0]->pageId;
+  Segment& segment = getSegment(getSegmentIdForPageId(firstPageId));
+  uint64_t firstPartId = getPartIdForPageId(firstPageId);
+  flushLog(run, count);
+  for (size_t i = 0; i < count; i++) {
+    setChecksum(segment, *run[i]);
+  }
+  if (segment.compressed) {
+    for (size_t i = 0; i < count; i++) {
+      writeCompressedPage(segment, *run[i]);
+    }
+    return;
+  }
+  allocatePages(segment, firstPartId + count);
+  int segmentFd = segment.fd;
+  uint32_t pageSize = segment.pageSize;
+  off_t offset = firstPartId * pageSize;
+  std::vector<struct iovec> iov(count);
+  for (size_t i = 0; i < count; i++) {
+    iov[i].iov_base = run[i]->getData();
+    iov[i].iov_len = pageSize;
+  }
+  // a single pwritev call only accepts a limited number of buffers
+  for (size_t i = 0; i < count; i += IOV_MAX) {
+    int iovcnt = std::min<size_t>(IOV_MAX, count - i);
+    dbImpl::checkedPwritev(segmentFd, &iov[i], iovcnt, offset + i * pageSize);
+  }
+  uint64_t pageCount = segment.pageCount;
+  while (pageCount < firstPartId + count
+      && !segment.pageCount.compare_exchange_weak(pageCount, firstPartId + count)) {
+  }
+}
+
+void BufferManager::readCompressedPages(Segment& segment, BufferFrame* const* run, size_t count) {
+  std::vector<PageExtent> extents(count);
+  {
+    std::lock_guard < std::mutex > extentLock(segment.extentMutex);
+    for (size_t i = 0; i < count; i++) {
+      uint64_t partId = getPartIdForPageId(run[i]->pageId);
+      extents[i] = partId < segment.pageMap.size() ? segment.pageMap[partId] : PageExtent();
+    }
+  }
+  static thread_local std::vector<uint8_t> compressed;
+  size_t first = 0;
+  while (first < count) {
+    if (extents[first].length == 0) {
+      // the page was never written
+      std::memset(run[first]->getData(), 0, segment.pageSize);
+      first++;
+      continue;
+    }
+    size_t end = first + 1;
+    while (end < count && extents[end].length != 0 && extents[end].offset
+        == extents[end - 1].offset + extents[end - 1].sectors * compressionSectorSize) {
+      end++;
+    }
+    uint64_t offset = extents[first].offset;
+    compressed.resize(extents[end - 1].offset + extents[end - 1].sectors * compressionSectorSize - offset);
+    dbImpl::checkedPread(segment.fd, compressed.data(), compressed.size(), offset);
+    for (size_t i = first; i < end; i++) {
+      const uint8_t* data = compressed.data() + (extents[i].offset - offset);
+      if (extents[i].length == segment.pageSize) {
+        std::memcpy(run[i]->getData(), data, segment.pageSize);
+      } else {
+        lz4Decompress(data, extents[i].length, run[i]->getData(), segment.pageSize);
+      }
+    }
+    first = end;
+  }
+}
+
+void BufferManager::writeCompressedPage(Segment& segment, BufferFrame& frame) {
+  uint64_t partId = getPartIdForPageId(frame.pageId);
+  uint32_t pageSize = segment.pageSize;
+  // pages are only compressed if this saves at least one sector
+  static thread_local std::vector<uint8_t> compressed;
+  compressed.resize(pageSize);
+  uint32_t length = lz4Compress(frame.getData(), pageSize, compressed.data(), pageSize - compressionSectorSize);
+  if (length == 0) {
+    length = pageSize;
+    std::memcpy(compressed.data(), frame.getData(), pageSize);
+  }
+  uint32_t sectors = (length + compressionSectorSize - 1) / compressionSectorSize;
+  std::memset(compressed.data() + length, 0, sectors * compressionSectorSize - length);
+  // a page is rewritten in place if it still fits into its extent, otherwise
+  // it is moved to a free extent or to the end of the file. Several threads
+  // might write the same page concurrently, e.g. the background writer and an
+  // eviction. They hold a shared latch, so they write the same data, but each
+  // of them might move the page to an extent of its own. The page map updates
+  // are serialized below: the last one wins and releases the extent written by
+  // the other thread, which is complete, since it was written before its update.
+  PageExtent extent;
+  {
+    std::lock_guard < std::mutex > extentLock(segment.extentMutex);
+    PageExtent current = partId < segment.pageMap.size() ? segment.pageMap[partId] : PageExtent();
+    if (current.length != 0 && current.sectors >= sectors) {
+      extent = current;
+    } else {
+      auto freeExtent = segment.freeExtents.lower_bound(sectors);
+      if (freeExtent != segment.freeExtents.end()) {
+        extent.offset = freeExtent->second;
+        // the rest of a larger extent stays free
+        if (freeExtent->first > sectors) {
+          segment.freeExtents.emplace(freeExtent->first - sectors,
+              extent.offset + sectors * compressionSectorSize);
+        }
+        segment.freeExtents.erase(freeExtent);
+      } else {
+        extent.offset = segment.fileSectors * compressionSectorSize;
+        segment.fileSectors += sectors;
+      }
+      extent.sectors = sectors;
+    }
+    extent.length = length;
+  }
+  dbImpl::checkedPwrite(segment.fd, compressed.data(), sectors * compressionSectorSize, extent.offset);
+  {
+    // the old extent is only reused once the page map does not point to it
+    // anymore, and not before the next sync (see releasedExtents)
+    std::lock_guard < std::mutex > extentLock(segment.extentMutex);
+    if (partId >= segment.pageMap.size()) {
+      segment.pageMap.resize(partId + 1);
+    }
+    PageExtent replaced = segment.pageMap[partId];
+    dbImpl::checkedPwrite(segment.mapFd, &extent, sizeof(extent), partId * sizeof(extent));
+    segment.pageMap[partId] = extent;
+    if (replaced.length != 0 && replaced.offset != extent.offset) {
+      segment.releasedExtents.push_back(replaced);
+    }
+  }
+  uint64_t pageCount = segment.pageCount;
+  while (pageCount <= partId && !segment.pageCount.compare_exchange_weak(pageCount, partId + 1)) {
+  }
+}
+
+void BufferManager::setChecksum(Segment& segment, BufferFrame& frame) {
+  if (pageChecksums == PageChecksums::None) {
+    return;
+  }
+  // several threads might write the same page concurrently, e.g. the background
+  // writer and an eviction. They hold shared latches and store the same value,
+  // but the store must be atomic nevertheless.
+  uint32_t* trailer = reinterpret_cast<uint32_t*>(frame.data + frame.size - pageTrailerSize);
+  __atomic_store_n(trailer, computeChecksum(frame), __ATOMIC_RELAXED);
+  if (pageChecksums == PageChecksums::FirstLoad) {
+    uint64_t partId = getPartIdForPageId(frame.pageId);
+    std::lock_guard < std::mutex > extentLock(segment.extentMutex);
+    if (partId >= segment.trustedPages.size()) {
+      segment.trustedPages.resize(partId + 1);
+    }
+    segment.trustedPages[partId] = true;
+  }
+}
+
+void BufferManager::verifyChecksum(Segment& segment, BufferFrame& frame) {
+  if (pageChecksums == PageChecksums::None || recovering) {
+    return;
+  }
+  uint64_t partId = getPartIdForPageId(frame.pageId);
+  if (pageChecksums == PageChecksums::FirstLoad) {
+    std::lock_guard < std::mutex > extentLock(segment.extentMutex);
+    if (partId < segment.trustedPages.size() && segment.trustedPages[partId]) {
+      return;
+    }
+  }
+  uint32_t stored;
+  std::memcpy(&stored, frame.data + frame.size - pageTrailerSize, sizeof(stored));
+  if (stored != computeChecksum(frame)) {
+    // pages which were preallocated but never written consist of zeros only
+    bool zeroed = std::all_of(frame.data, frame.data + frame.size, [](uint8_t byte) { return byte == 0; });
+    if (!zeroed) {
+      throw CorruptPageError(frame.pageId);
+    }
+  }
+  if (pageChecksums == PageChecksums::FirstLoad) {
+    std::lock_guard < std::mutex > extentLock(segment.extentMutex);
+    if (partId >= segment.trustedPages.size()) {
+      segment.trustedPages.resize(partId + 1);
+    }
+    segment.trustedPages[partId] = true;
+  }
+}
+
+uint32_t BufferManager::computeChecksum(BufferFrame& frame) {
+  uint32_t checksum = crc32c(frame.data, frame.size - pageTrailerSize);
+  return crc32c(&frame.pageId, sizeof(frame.pageId), checksum);
+}
+
+void BufferManager::flushLog(BufferFrame* const* written, size_t count) {
+  if (log) {
+    // write-ahead: the page's modifications must be in the log before the page
+    uint64_t lsn = 0;
+    for (size_t i = 0; i < count; i++) {
+      lsn = std::max(lsn, written[i]->lsn);
+    }
+    log->flush(lsn);
+  }
+}
+
+void BufferManager::runWriter() {
+  auto nextWarmUpSnapshot = std::chrono::steady_clock::now() + warmUpInterval;
+  std::unique_lock < std::mutex > writerLock(writerMutex);
+  while (!writerStopping) {
+    writerLock.unlock();
+    for (PageClass& pageClass : pageClasses) {
+      cleanEvictionCandidates(pageClass);
+    }
+    if (log && checkpointLogSize > 0 && log->getSize() >= checkpointLogSize) {
+      try {
+        checkpoint();
+      } catch (std::exception&) {
+        //retried as long as the log is too long
+      }
+    }
+    if (warmUpInterval.count() > 0 && std::chrono::steady_clock::now() >= nextWarmUpSnapshot) {
+      nextWarmUpSnapshot = std::chrono::steady_clock::now() + warmUpInterval;
+      try {
+        saveWarmUpSnapshot();
+      } catch (std::exception&) {
+        //the snapshot is recorded again next time
+      }
+    }
+    writerLock.lock();
+    if (!writerStopping) {
+      writerWakeup.wait_for(writerLock, std::chrono::milliseconds(writerIntervalMs));
+    }
+  }
+}
+
+void BufferManager::cleanEvictionCandidates(PageClass& pageClass) {
+  writerCandidates.clear();
+  writerFrames.clear();
+  {
+    std::lock_guard < std::mutex > globalLock(globalMutex);
+    drainAccessLogs();
+    pageClass.replacement->peekVictims(pageClass.writerHighWatermark, writerCandidates);
+    uint64_t cleanFrames = pageClass.freeFrameCount;
+    for (uint64_t pageId : writerCandidates) {
+      Partition& partition = getPartition(pageId);
+      std::lock_guard < std::mutex > partitionLock(partition.mutex);
+      BufferFrame* frame = partition.find(pageId);
+      // pinned frames are skipped. They are not evictable anyway and
+      // their dirty flag might be modified concurrently.
+      if (frame == nullptr || frame->fixCount > 0) {
+        continue;
+      }
+      if (frame->dirty) {
+        // pin the frame, so that it stays in the page table while we are writing
+        frame->fixCount++;
+        writerFrames.push_back(frame);
+      } else {
+        cleanFrames++;
+      }
+    }
+    if (cleanFrames >= pageClass.writerLowWatermark) {
+      for (BufferFrame* frame : writerFrames) {
+        frame->fixCount--;
+      }
+      return;
+    }
+  }
+
+  // We must not block on a latch while holding the latches of other frames:
+  // other threads might acquire them in a different order (e.g. lock coupling
+  // in the BTree). Frames which are latched exclusively are skipped, they are
+  // being modified anyway.
+  size_t latchedCount = 0;
+  for (BufferFrame* frame : writerFrames) {
+    if (frame->tryLock(false)) {
+      writerFrames[latchedCount++] = frame;
+    } else {
+      frame->fixCount--;
+    }
+  }
+  writerFrames.resize(latchedCount);
+  std::sort(writerFrames.begin(), writerFrames.end(),
+      [](BufferFrame* a, BufferFrame* b) { return a->pageId < b->pageId; });
+
+  // adjacent pages are written by one pwritev call
+  size_t runStart = 0;
+  for (size_t i = 1; i <= writerFrames.size(); i++) {
+    if (i < writerFrames.size() && writerFrames[i]->pageId == writerFrames[i - 1]->pageId + 1
+        && getSegmentIdForPageId(writerFrames[i]->pageId) == getSegmentIdForPageId(writerFrames[runStart]->pageId)) {
+      continue;
+    }
+    bool written = true;
+    try {
+      writeFrames(&writerFrames[runStart], i - runStart);
+    } catch (...) {
+      //the pages stay dirty. The error is reported once an eviction tries to write them.
+      written = false;
+    }
+    for (size_t j = runStart; j < i; j++) {
+      if (written) {
+        writerFrames[j]->dirty = false;
+      }
+      writerFrames[j]->unlock();
+      writerFrames[j]->fixCount--;
+    }
+    if (written) {
+      count(&StatsStripe::backgroundWrites, i - runStart);
+      count(&StatsStripe::backgroundWriteCalls);
+    }
+    runStart = i;
+  }
+}
+
+BufferManager::Segment* BufferManager::findSegment(uint64_t segmentId) {
+  std::lock_guard < std::mutex > segmentLock(segmentMutex);
+  auto segmentIt = segments.find(segmentId);
+  return segmentIt != segments.end() ? segmentIt->second.get() : nullptr;
+}
+
+BufferManager::Segment& BufferManager::getSegment(uint64_t segmentId) {
+  //opened segments are cached for performance reasons
+  std::lock_guard < std::mutex > segmentLock(segmentMutex);
+  auto segmentIt = segments.find(segmentId);
+  if (segmentIt != segments.end()) { // segment file was opened before
+    return *segmentIt->second;
+  }
+  auto mapped = mappedSegments.find(segmentId);
+  std::string fileName = std::to_string(segmentId);
+  bool compressed = compressedSegments.count(segmentId) > 0;
+  int flags = mapped != mappedSegments.end() ? O_RDONLY : O_RDWR | O_CREAT;
+  int segmentFd = -1;
+  // compressed pages are read through a buffer which is not aligned
+  bool useDirectIO = directIO && mapped == mappedSegments.end() && !compressed;
+  if (useDirectIO) {
+    segmentFd = openat(folderFd, fileName.c_str(), flags | O_DIRECT, S_IRUSR | S_IWUSR);
+    if (segmentFd == -1 && errno == EINVAL) {
+      errno = 0; //the file system does not support direct I/O, e.g. tmpfs
+      useDirectIO = false;
+    }
+  }
+  if (!useDirectIO) {
+    segmentFd = openat(folderFd, fileName.c_str(), flags, S_IRUSR | S_IWUSR);
+  }
+  if (segmentFd == -1) {
+    int occurredErrno = errno;
+    errno = 0; //reset, so that later calls can succeed
+    std::ostringstream msg;
+    msg << "unable to open segment " << segmentId;
+    throw std::system_error(
+        std::error_code(occurredErrno, std::system_category()), msg.str());
+  }
+  // the file size is only determined once. Afterwards, all writes go through
+  // the BufferManager, so we know the high-water mark ourself.
+  struct stat segmentStat;
+  if (fstat(segmentFd, &segmentStat) != 0) {
+    int occurredErrno = errno;
+    errno = 0; //reset, so that later calls can succeed
+    close(segmentFd);
+    std::ostringstream msg;
+    msg << "unable to stat segment " << segmentId;
+    throw std::system_error(
+        std::error_code(occurredErrno, std::system_category()), msg.str());
+  }
+  std::unique_ptr<Segment> segment(new Segment());
+  segment->fd = segmentFd;
+  segment->pageSize = pageClasses[getPageClass(segmentId)].pageSize;
+  segment->pageCount = (segmentStat.st_size + segment->pageSize - 1) / segment->pageSize;
+  segment->allocatedPages = segment->pageCount;
+  segment->mapping = nullptr;
+  segment->mappingSize = 0;
+  segment->compressed = compressed;
+  segment->mapFd = -1;
+  segment->fileSectors = 0;
+  if (compressed) {
+    openPageMap(*segment, segmentId);
+  }
+  if (mapped != mappedSegments.end()) {
+    // a partial page at the end of the file can not be mapped completely
+    segment->pageCount = segmentStat.st_size / segment->pageSize;
+    mapSegment(*segment, segmentId, mapped->second);
+  }
+  Segment& result = *segment;
+  segments[segmentId] = std::move(segment);
+  return result;
+}
+
+void BufferManager::openPageMap(Segment& segment, uint64_t segmentId) {
+  std::string fileName = std::to_string(segmentId) + ".map";
+  segment.mapFd = openat(folderFd, fileName.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  struct stat mapStat;
+  if (segment.mapFd == -1 || fstat(segment.mapFd, &mapStat) != 0) {
+    int occurredErrno = errno;
+    errno = 0; //reset, so that later calls can succeed
+    if (segment.mapFd != -1) {
+      close(segment.mapFd);
+    }
+    close(segment.fd);
+    std::ostringstream msg;
+    msg << "unable to open the page map of segment " << segmentId;
+    throw std::system_error(
+        std::error_code(occurredErrno, std::system_category()), msg.str());
+  }
+  try {
+    segment.pageMap.resize(mapStat.st_size / sizeof(PageExtent));
+    dbImpl::checkedPread(segment.mapFd, segment.pageMap.data(),
+        segment.pageMap.size() * sizeof(PageExtent), 0);
+  } catch (...) {
+    close(segment.mapFd);
+    close(segment.fd);
+    throw;
+  }
+  segment.pageCount = segment.pageMap.size();
+  // the gaps between the used extents are free
+  std::vector<PageExtent> used;
+  for (const PageExtent& extent : segment.pageMap) {
+    if (extent.length != 0) {
+      used.push_back(extent);
+    }
+  }
+  std::sort(used.begin(), used.end(),
+      [](const PageExtent& a, const PageExtent& b) { return a.offset < b.offset; });
+  for (const PageExtent& extent : used) {
+    uint64_t firstSector = extent.offset / compressionSectorSize;
+    if (firstSector > segment.fileSectors) {
+      segment.freeExtents.emplace(firstSector - segment.fileSectors,
+          segment.fileSectors * compressionSectorSize);
+    }
+    segment.fileSectors = std::max(segment.fileSectors, firstSector + extent.sectors);
+  }
+}
+
+void BufferManager::mapSegment(Segment& segment, uint64_t segmentId, AccessPattern accessPattern) {
+  segment.mappingSize = segment.pageCount * segment.pageSize;
+  if (segment.mappingSize == 0) {
+    //empty files can not be mapped. There are no pages to be read anyway.
+    segment.mapping = nullptr;
+    return;
+  }
+  void* mapping = mmap(nullptr, segment.mappingSize, PROT_READ, MAP_SHARED, segment.fd, 0);
+  if (mapping == MAP_FAILED) {
+    int occurredErrno = errno;
+    errno = 0; //reset, so that later calls can succeed
+    close(segment.fd);
+    std::ostringstream msg;
+    msg << "unable to map segment " << segmentId;
+    throw std::system_error(
+        std::error_code(occurredErrno, std::system_category()), msg.str());
+  }
+  segment.mapping = reinterpret_cast<uint8_t*>(mapping);
+  //only a hint, so errors can be ignored
+  if (accessPattern == AccessPattern::Sequential) {
+    madvise(mapping, segment.mappingSize, MADV_SEQUENTIAL);
+  } else if (accessPattern == AccessPattern::Random) {
+    madvise(mapping, segment.mappingSize, MADV_RANDOM);
+  }
+  errno = 0;
+}
+
+void BufferManager::allocatePages(Segment& segment, uint64_t pageCount) {
+  std::lock_guard < std::mutex > extentLock(segment.extentMutex);
+  if (pageCount <= segment.allocatedPages) {
+    return;
+  }
+  // grow by whole extents, so that the file is not fragmented by many small
+  // appends. FALLOC_FL_KEEP_SIZE leaves the file size untouched, it still
+  // marks the high-water mark when the file is opened the next time.
+  uint64_t allocatedPages = (pageCount + segmentExtentPages - 1) / segmentExtentPages * segmentExtentPages;
+  if (fallocate(segment.fd, FALLOC_FL_KEEP_SIZE, segment.allocatedPages * segment.pageSize,
+        (allocatedPages - segment.allocatedPages) * segment.pageSize) != 0) {
+    //only an optimization, e.g. not supported by all file systems.
+    //The following write will report real errors such as a full disk.
+    errno = 0;
+  }
+  segment.allocatedPages = allocatedPages;
+}
+
+void BufferManager::releaseFrame(BufferFrame& frame) {
+  PageClass& pageClass = pageClasses[frame.pageClass];
+  frame.pageId = invalidPageId;
+  frame.lsn = 0;
+  if (frame.mapped) {
+    //the frame's memory in the pool was not used while the page was mapped
+    frame.data = pageClass.pool + (&frame - &frames[pageClass.firstFrame]) * pageClass.pageSize;
+    frame.mapped = false;
+  }
+  pageClass.addFreeFrame(&frame);
+}
+
+unsigned BufferManager::getPageClass(uint64_t segmentId) const {
+  auto pageClass = segmentPageClasses.find(segmentId);
+  return pageClass != segmentPageClasses.end() ? pageClass->second : 0;
+}
+
+uint32_t BufferManager::getPageSize(uint64_t segmentId) const {
+  uint32_t pageSize = pageClasses[getPageClass(segmentId)].pageSize;
+  return pageChecksums != PageChecksums::None ? pageSize - pageTrailerSize : pageSize;
+}
+
+CorruptPageError::CorruptPageError(uint64_t pageId)
+  : std::runtime_error(buildErrorMsg(pageId)) {}
+
+std::string CorruptPageError::buildErrorMsg(uint64_t pageId) {
+  std::ostringstream msg;
+  msg << "page " << BufferManager::getPartIdForPageId(pageId) << " of segment "
+      << BufferManager::getSegmentIdForPageId(pageId) << " does not match its checksum";
+  return msg.str();
+}
+
+unsigned BufferManager::getNumaNode() const {
+  return numaNodes > 1 ? currentNumaNode() % numaNodes : 0;
+}
+
+BufferFrame* BufferManager::PageClass::takeFreeFrame(unsigned node) {
+  // fall back to the other nodes' frames. A remote frame is still
+  // better than evicting a page.
+  for (unsigned i = 0; i < freeFrames.size(); i++) {
+    std::vector<BufferFrame*>& nodeFrames = freeFrames[(node + i) % freeFrames.size()];
+    if (!nodeFrames.empty()) {
+      BufferFrame* frame = nodeFrames.back();
+      nodeFrames.pop_back();
+      freeFrameCount--;
+      return frame;
+    }
+  }
+  return nullptr;
+}
+
+void BufferManager::PageClass::addFreeFrame(BufferFrame* frame) {
+  freeFrames[frame->node].push_back(frame);
+  freeFrameCount++;
+}
+
+uint64_t BufferManager::hashPageId(uint64_t pageId) {
+  // consecutive pages should end up in different partitions.
+  // Fibonacci hashing takes all bits of the pageId into account
+  // for the upper bits of the hash value.
+  return pageId * 0x9e3779b97f4a7c15ull;
+}
+
+BufferManager::Partition& BufferManager::getPartition(uint64_t pageId) {
+  return partitions[hashPageId(pageId) >> (64 - partitionBits)];
+}
+
+BufferFrame* BufferManager::Partition::find(uint64_t pageId) {
+  BufferFrame* frame = buckets[(hashPageId(pageId) >> (32 - partitionBits)) & bucketMask];
+  while (frame != nullptr && frame->pageId != pageId) {
+    frame = frame->nextInBucket;
+  }
+  return frame;
+}
+
+void BufferManager::Partition::insert(BufferFrame* frame) {
+  BufferFrame*& bucket = buckets[(hashPageId(frame->pageId) >> (32 - partitionBits)) & bucketMask];
+  frame->nextInBucket = bucket;
+  bucket = frame;
+}
+
+void BufferManager::Partition::erase(BufferFrame* frame) {
+  BufferFrame** link = &buckets[(hashPageId(frame->pageId) >> (32 - partitionBits)) & bucketMask];
+  while (*link != frame) {
+    link = &(*link)->nextInBucket;
+  }
+  *link = frame->nextInBucket;
+  frame->nextInBucket = nullptr;
 }
 
-const uint32_t BufferManager::pageSize = 16 * 1024;
+const uint64_t BufferManager::invalidPageId = std::numeric_limits<uint64_t>::max();
 
 uint64_t BufferManager::getSegmentIdForPageId(uint64_t pageId) {
   return pageId >> 32;
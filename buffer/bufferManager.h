@@ -3,48 +3,534 @@
 
 #include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <vector>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <atomic>
 #include <condition_variable>
+#include <string>
+#include <cstdio>
+#include <chrono>
+#include <ostream>
+#include <stdexcept>
 #include "buffer/bufferFrame.h"
-#include "buffer/twoQ.h"
+#include "buffer/pageGuard.h"
+#include "buffer/replacementPolicy.h"
+#include "buffer/writeAheadLog.h"
+#include "utils/threadPool.h"
 
 
 namespace dbImpl {
+  // segments whose pages have a size different from the BufferManager's default
+  struct PageClassOptions {
+    // size of the pages in bytes. Must be a multiple of 4 KiB.
+    uint32_t pageSize;
+    // number of frames reserved for this page class
+    uint64_t frames;
+    // the segments using this page size
+    std::vector<uint64_t> segments;
+  };
+
+  // how the pages of a memory mapped segment are accessed.
+  // Passed on to the kernel using madvise.
+  enum class AccessPattern { Normal, Sequential, Random };
+
+  // when the checksums of pages read from disk are verified
+  enum class PageChecksums {
+    // pages do not store a checksum
+    None,
+    // every page read from disk is verified
+    Always,
+    // a page is only verified the first time it is read. Pages which were
+    // verified or written by this BufferManager are trusted when they are
+    // read again after being evicted.
+    FirstLoad
+  };
+
+  // configuration options for a BufferManager
+  struct BufferOptions {
+    // size of the pages of all segments which are not part of a page class.
+    // Must be a multiple of 4 KiB.
+    uint32_t pageSize = 16 * 1024;
+    // additional page classes. The BufferManager's size only covers the frames
+    // of the default page size, the frames of each page class are added to it.
+    // Pages of a segment must always be accessed using the same page size.
+    std::vector<PageClassOptions> pageClasses;
+    // read-only segments which are memory mapped instead of being read into
+    // the frame pool. Their frames point directly into the mapping, so pages are
+    // not copied. Such pages cannot be fixed exclusively and pages beyond the
+    // end of the file do not exist.
+    std::unordered_map<uint64_t, AccessPattern> mappedSegments;
+    // open segment files with O_DIRECT, so that pages are not cached by the
+    // kernel in addition to the frame pool. Falls back to buffered I/O on file
+    // systems without support for direct I/O. Mapped segments always use the
+    // kernel's page cache.
+    bool directIO = false;
+    // segments whose pages are stored LZ4 compressed. Saves disk space and I/O
+    // bandwidth for cold segments at the cost of CPU time. A page map stored
+    // next to the segment file translates the pages into their compressed
+    // extents. Compressed segments can not be memory mapped and always use
+    // the kernel's page cache.
+    std::unordered_set<uint64_t> compressedSegments;
+    // protects each page by a CRC32C checksum, so that torn writes and other
+    // corruptions are detected when the page is loaded. The checksum is stored
+    // in the last bytes of each page, which reduces the usable page size
+    // reported by getPageSize and BufferFrame::getSize. Segments must always
+    // be accessed with checksums enabled or always with them disabled.
+    PageChecksums pageChecksums = PageChecksums::None;
+    // if set, modifications reported using logUpdate are written to this
+    // write-ahead log. Pages are only written after their log records are
+    // durable, and the log is replayed when the BufferManager is created.
+    std::string logFile;
+    // the background writer runs a checkpoint whenever the write-ahead log's
+    // records needed for recovery exceed this size, which bounds the recovery
+    // time. 0 disables automatic checkpoints.
+    uint64_t checkpointLogSize = 64 * 1024 * 1024;
+    // if set, the resident pages are recorded in this file when the
+    // BufferManager is destroyed and they are read again when it is created,
+    // so that a restarted BufferManager does not start cold. Whether the
+    // replacement policy considered a page frequently used is restored as well.
+    std::string warmUpFile;
+    // the background writer additionally records the resident pages this
+    // often, so that a crash does not lose the snapshot. 0 disables it.
+    unsigned warmUpIntervalMs = 0;
+    // number of NUMA nodes the frame pool is split across. Each page class's
+    // frames are divided evenly between the nodes, and missing pages are loaded
+    // into a frame on the node of the requesting thread if one is free.
+    // 1 disables NUMA awareness, 0 uses all nodes of the machine.
+    unsigned numaNodes = 1;
+    // back the frame pool by huge pages. If no huge pages are reserved,
+    // transparent huge pages are requested instead.
+    bool hugePages = false;
+    // number of threads reading pages asynchronously for prefetch().
+    // 0 disables prefetching.
+    unsigned ioThreads = 4;
+    // flush dirty pages in the background, so that evictions find clean victims
+    // and fixPage rarely has to write somebody else's page.
+    bool backgroundWriter = true;
+    // the background writer becomes active if less than this fraction of the
+    // buffer's frames is free or clean and evictable ...
+    double writerLowWatermark = 0.05;
+    // ... and then flushes the dirty pages among the next candidates for eviction.
+    // This fraction of the buffer is considered.
+    double writerHighWatermark = 0.1;
+    // the background writer checks the watermarks at least this often
+    unsigned writerIntervalMs = 50;
+    // the strategy used in order to choose the pages to be evicted
+    ReplacementStrategy replacementStrategy = ReplacementStrategy::TwoQ;
+    // sizes of the 2Q's FIFO queue (Kin) and ghost queue (Kout)
+    // as fractions of the buffer size
+    double twoQInRatio = 0.25;
+    double twoQOutRatio = 0.5;
+    // if set, the pageId of every fixPage call is appended to this file as
+    // binary uint64_t. Meant for recording traces for "bufferbench replay",
+    // all fixPage calls are serialized while recording.
+    std::string traceFile;
+  };
+
+  // a snapshot of a BufferManager's counters. All counters start at 0
+  // when the BufferManager is created.
+  struct BufferStats {
+    // fixes of resident pages
+    uint64_t hits;
+    // fixes which had to load the page
+    uint64_t misses;
+    // pages loaded by prefetch()
+    uint64_t prefetchedPages;
+    // all evicted pages
+    uint64_t evictions;
+    // victims which could not be evicted since they were pinned or
+    // since they were used again while being written
+    uint64_t evictionRetries;
+    // evictions which had to write their dirty victim themselves
+    uint64_t foregroundWrites;
+    // pages written by the background writer
+    uint64_t backgroundWrites;
+    // pwritev calls issued by the background writer
+    uint64_t backgroundWriteCalls;
+    // time spent waiting for evictable pages
+    uint64_t evictionWaitNanos;
+    // time spent waiting for latches and for pages being loaded
+    uint64_t latchWaitNanos;
+    // calls of commit() and fdatasync calls on the write-ahead log.
+    // Concurrent commits share a single sync.
+    uint64_t commits;
+    uint64_t logSyncs;
+    // checkpoints, including the automatic ones of the background writer
+    uint64_t checkpoints;
+    // fixes by threads running on another NUMA node than the one storing the
+    // frame. Only counted if the frame pool is split across several nodes.
+    uint64_t remoteFixes;
+  };
+
+  // prints all counters in a single line
+  std::ostream& operator<<(std::ostream& out, const BufferStats& stats);
+
+  // thrown if a page read from disk does not match its checksum,
+  // e.g. since a write was torn by a crash
+  class CorruptPageError : public std::runtime_error {
+    public:
+      CorruptPageError(uint64_t pageId);
+    private:
+      static std::string buildErrorMsg(uint64_t pageId);
+  };
+
   class BufferManager {
   public:
     // constructor
-    BufferManager(uint64_t size);
+    BufferManager(uint64_t size, const BufferOptions& options = BufferOptions());
     // destructor
     virtual ~BufferManager();
-    
+
     // returns BufferFrame for given pageId
     // if exclusive==true, the page is write-locked otherwise read-locked
-    // if there's no free space in buffer, an old page will be evicted following the twoQ strategy
+    // if there's no free space in buffer, an old page will be evicted following the configured replacement strategy
     BufferFrame& fixPage(uint64_t pageId, bool exclusive);
 
     // takes a BufferFrame and writes it on disk if it is dirty
     void unfixPage(BufferFrame& frame, bool isDirty);
 
-    // the number of bits stored in one page
-    static const uint32_t pageSize;
+    // fixes a page like fixPage(). The page is unfixed by the returned guard.
+    PageGuard fixPageGuarded(uint64_t pageId, bool exclusive);
+
+    // fixes a page for optimistic reading: the page is pinned but not latched,
+    // so readers do not modify the frame's latch. The frame's current version is
+    // stored in version. Data read from the page may be inconsistent unless
+    // validate() succeeds afterwards. Must be released using unfixPageOptimistic().
+    BufferFrame& fixPageOptimistic(uint64_t pageId, uint64_t& version);
+    // returns true if nobody latched the frame exclusively since version was obtained
+    static bool validate(BufferFrame& frame, uint64_t version);
+    void unfixPageOptimistic(BufferFrame& frame);
+
+    // asynchronously loads the pages [firstPageId, firstPageId + pageCount).
+    // This is only a hint: pages which are resident already or which do not
+    // exist on disk are skipped, and at most a quarter of the buffer is used.
+    // Segments which were not opened by a fix so far are skipped entirely,
+    // so a prefetch never creates a segment file or fails to open one.
+    // Consecutive pages are read using a single I/O request.
+    // Subsequent fixPage calls for these pages wait until the read completed.
+    void prefetch(uint64_t firstPageId, uint64_t pageCount);
+
+    // appends the after-image of length bytes at offset of the frame's page to
+    // the write-ahead log and returns the record's LSN. The frame must be
+    // latched exclusively. Does nothing and returns 0 if no log is used.
+    uint64_t logUpdate(BufferFrame& frame, uint32_t offset, uint32_t length);
+    // waits until the log records up to lsn are durable
+    void commit(uint64_t lsn);
+    // writes all dirty pages and discards the log records which are
+    // not needed for recovery anymore
+    void checkpoint();
+    // writes the dirty pages among [firstPageId, firstPageId + pageCount)
+    // of one segment which are resident, e.g. after they were filled by a bulk load.
+    // Consecutive pages are written using a single pwritev call. Pages which
+    // are latched exclusively are skipped, they are being modified anyway.
+    void writePages(uint64_t firstPageId, uint64_t pageCount);
+
+    // records the resident pages in BufferOptions::warmUpFile.
+    // Does nothing if no warm-up file is configured.
+    void saveWarmUpSnapshot();
+
+    // returns the current values of all counters. The counters are
+    // collected in one stripe per hardware thread and aggregated by this call.
+    BufferStats getStats() const;
+
+    // returns the usable size of the given segment's pages in bytes
+    uint32_t getPageSize(uint64_t segmentId) const;
 
     static uint64_t getSegmentIdForPageId(uint64_t pageId);
     static uint64_t getPartIdForPageId(uint64_t pageId);
     static uint64_t buildPageId(uint64_t segmentId, uint64_t partId);
 
   private:
-    // maximum number of pages in buffer
+    friend class PageGuard;
+
+    // The page table is split into several partitions. Each partition is
+    // protected by its own mutex, so that fixing a resident page only
+    // serializes with other threads accessing the same partition.
+    //
+    // Each partition is a hash table with chaining. The chains are linked
+    // through the BufferFrames themselves, so no memory is allocated when
+    // inserting or removing a page.
+    struct Partition {
+      std::mutex mutex;
+      // the hash table's buckets. Each bucket points to the first frame of its chain.
+      std::unique_ptr<BufferFrame*[]> buckets;
+      uint64_t bucketMask;
+      // the NUMA node storing the pages of this partition which are loaded
+      // on behalf of no particular thread, e.g. by prefetching
+      unsigned node;
+      // pages which were accessed but were not yet reported to the replacement policy.
+      // Hits only append to this log, the replacement policy is informed in batches.
+      std::vector<uint64_t> accessLog;
+
+      // returns the frame containing the given page or nullptr if it is not resident
+      BufferFrame* find(uint64_t pageId);
+      // adds the frame to the hash table using the frame's pageId as key
+      void insert(BufferFrame* frame);
+      // removes the frame from the hash table
+      void erase(BufferFrame* frame);
+    };
+    // number of bits of a page's hash used in order to determine its partition
+    static const unsigned partitionBits;
+    // number of partitions
+    static const unsigned partitionCount;
+    // the frames storing pages of one size. Each page class has its own free
+    // frames and its own replacement policy, so that a frame is only ever
+    // reused for pages of the same size.
+    struct PageClass {
+      uint32_t pageSize;
+      // number of frames
+      uint64_t size;
+      // frames which do not contain any page, one list per NUMA node.
+      // Protected by the globalMutex.
+      std::vector<std::vector<BufferFrame*>> freeFrames;
+      uint64_t freeFrameCount;
+      // the pages which are evictable, managed according to the replacement strategy
+      std::unique_ptr<ReplacementPolicy<uint64_t>> replacement;
+      // maximum number of pages loaded by one prefetch call
+      uint64_t maxPrefetchPages;
+      // the background writer's watermarks in frames
+      uint64_t writerLowWatermark;
+      uint64_t writerHighWatermark;
+      // the class's part of the frame pool and its first frame
+      uint8_t* pool;
+      uint64_t firstFrame;
+
+      // removes a free frame, preferably one on the given node.
+      // Returns nullptr if no frame is free.
+      BufferFrame* takeFreeFrame(unsigned node);
+      // adds a frame to the free frames of its node
+      void addFreeFrame(BufferFrame* frame);
+    };
+    // where a page of a compressed segment is stored. Extents consist of
+    // whole sectors. length is 0 for pages which were never written, pages
+    // which do not compress are stored as they are with length == pageSize.
+    struct PageExtent {
+      uint64_t offset;
+      uint32_t length;
+      uint32_t sectors;
+    };
+    // the unit in which space for compressed pages is allocated
+    static const uint32_t compressionSectorSize;
+    // an opened segment file
+    struct Segment {
+      int fd;
+      // size of the segment's pages
+      uint32_t pageSize;
+      // the file's contents if the segment is memory mapped, nullptr otherwise
+      uint8_t* mapping;
+      uint64_t mappingSize;
+      // number of pages stored in the file. Pages beyond are zeroed when loaded,
+      // so misses on new pages do not need to access the file at all.
+      std::atomic<uint64_t> pageCount;
+      // number of pages for which disk space was preallocated. Protected by extentMutex.
+      uint64_t allocatedPages;
+      std::mutex extentMutex;
+      // set if the pages are compressed. The page map is read when the segment
+      // is opened and every change is written to the page map's file at mapFd.
+      bool compressed;
+      int mapFd;
+      // the extent of each page, the unused extents by their number of sectors
+      // and the number of sectors of the file. Protected by extentMutex.
+      std::vector<PageExtent> pageMap;
+      std::multimap<uint32_t, uint64_t> freeExtents;
+      uint64_t fileSectors;
+      // extents replaced since the last sync. Until the new extents and the page
+      // map are durable, a crash might bring back the old ones, so they are only
+      // added to freeExtents by syncSegments(). Protected by extentMutex.
+      std::vector<PageExtent> releasedExtents;
+      // pages which need not be verified when they are loaded again
+      // in PageChecksums::FirstLoad mode. Protected by extentMutex.
+      std::vector<bool> trustedPages;
+    };
+    // segment files are grown by at least this many pages at once
+    static const uint64_t segmentExtentPages;
+    // an access log containing this many entries should be drained
+    static const unsigned accessLogBatchSize;
+    // hits must wait for the globalMutex if the access log reaches this size
+    static const unsigned accessLogCapacity;
+
+    Partition& getPartition(uint64_t pageId);
+    // informs the replacement policy about all logged accesses of the given partition.
+    // The caller must hold the globalMutex and the partition's mutex.
+    bool drainAccessLog(Partition& partition);
+    // drains the access logs of all partitions. Requires the globalMutex.
+    void drainAccessLogs();
+    // appends the pageId to the trace file if a trace is recorded
+    void recordTrace(uint64_t pageId);
+    // returns the page's frame pinned, or nullptr if the page is not resident.
+    // The frame is not latched yet.
+    BufferFrame* pinResidentPage(uint64_t pageId);
+    // slow path of fixPage: loads a page which was not resident.
+    // Returns the pinned and latched frame. If read is not set, the page's
+    // content is left uninitialized since the caller overwrites all of it.
+    BufferFrame& fixMissingPage(uint64_t pageId, bool exclusive, bool read = true);
+    // evicts one page (if possible) in order to make room for a new one.
+    // Might temporarily release the given lock on the globalMutex.
+    // If no page is evictable at the moment, it waits if mayWait is set
+    // and returns false otherwise.
+    bool evictPage(PageClass& pageClass, std::unique_lock<std::mutex>& globalLock, bool mayWait = true);
+    // latches a pinned frame. Waits until asynchronous reads completed.
+    void latchFrame(BufferFrame& frame, bool exclusive);
+    // exchanges the latch of a fixed frame for one of the given mode.
+    // If isDirty is set, the frame is marked dirty before releasing the latch.
+    void relatchFrame(BufferFrame& frame, bool exclusive, bool isDirty);
+    // reads the frame's page from disk. Pages not stored on disk yet are zeroed.
+    void readPage(BufferFrame& frame);
+    // reads and decompresses consecutive pages of a compressed segment.
+    // Pages stored in adjacent extents are read using a single request.
+    void readCompressedPages(Segment& segment, BufferFrame* const* run, size_t count);
+    // compresses the frame's page and writes it into its compressed segment
+    void writeCompressedPage(Segment& segment, BufferFrame& frame);
+    // reads the page map of a compressed segment and collects its unused extents
+    void openPageMap(Segment& segment, uint64_t segmentId);
+    // reads consecutive pages asynchronously. Executed by the ioPool.
+    void readPagesAsync(const std::vector<BufferFrame*>& run);
+    // marks the frames as loaded and wakes up all threads waiting for them.
+    // If the read failed, the next thread latching a frame reads it again.
+    void completeLoads(BufferFrame* const* loaded, size_t count, bool failed);
+    // stores the checksum of the frame's page in the page's trailer.
+    // Called before the page is written.
+    void setChecksum(Segment& segment, BufferFrame& frame);
+    // throws a CorruptPageError if a page read from disk does not match its checksum
+    void verifyChecksum(Segment& segment, BufferFrame& frame);
+    // computes the checksum of a page. The pageId is included, so that pages
+    // written to the wrong location are detected as well.
+    static uint32_t computeChecksum(BufferFrame& frame);
+    // writes the frame's contents to disk
+    void writeFrame(BufferFrame& frame);
+    // makes the log records of the frames durable before they are written
+    void flushLog(BufferFrame* const* frames, size_t count);
+    // applies the write-ahead log's records to the pages
+    void recover();
+    // loads the pages recorded in the warm-up file. Pages are read
+    // in sorted order, consecutive pages using a single request.
+    void warmUp();
+    // makes all writes to the segment files durable
+    void syncSegments();
+    // writes consecutive pages of one segment using vectored I/O
+    void writeFrames(BufferFrame* const* run, size_t count);
+    // main loop of the background writer thread
+    void runWriter();
+    // one round of the background writer: flushes the dirty pages among the
+    // next eviction candidates of the page class if there are not enough clean ones
+    void cleanEvictionCandidates(PageClass& pageClass);
+    // returns the index of the segment's page class
+    unsigned getPageClass(uint64_t segmentId) const;
+    // maps a read-only segment's file into memory
+    void mapSegment(Segment& segment, uint64_t segmentId, AccessPattern accessPattern);
+    // returns the segment's metadata. Opens the file if necessary.
+    Segment& getSegment(uint64_t segmentId);
+    // returns the segment's metadata or nullptr if its file was not opened so far
+    Segment* findSegment(uint64_t segmentId);
+    // preallocates disk space for the first pageCount pages of the segment
+    void allocatePages(Segment& segment, uint64_t pageCount);
+    // puts a frame which was removed from the page table back on the free list.
+    // Requires the globalMutex.
+    void releaseFrame(BufferFrame& frame);
+
+    // returns the hash value used for partitioning and for the buckets
+    static uint64_t hashPageId(uint64_t pageId);
+    // the pageId of frames which do not contain any page
+    static const uint64_t invalidPageId;
+
+    // maximum number of pages in buffer, summed over all page classes
     uint64_t size;
-    // hash map storing the BufferFrames
-    std::unordered_map<uint64_t, BufferFrame> frames;
+    // the memory of all frames. One contiguous, page-aligned memory region.
+    // The frames of each page class occupy a consecutive part of it.
+    uint8_t* framePool;
+    uint64_t framePoolSize;
+    // the frame descriptors, ordered by page class
+    std::unique_ptr<BufferFrame[]> frames;
+    // the page classes. The first one is used for all segments
+    // not listed in segmentPageClasses.
+    std::vector<PageClass> pageClasses;
+    std::unordered_map<uint64_t, unsigned> segmentPageClasses;
+    // the partitions of the page table
+    std::unique_ptr<Partition[]> partitions;
     // file descriptor for the directory storing all segment files
     int folderFd;
-    // hash map storing file descriptors for all created segment files
-    std::unordered_map<uint64_t, int> segmentFds;
-    // implementation of twoQ strategy
-    TwoQ<uint64_t> twoQ;
-    std::condition_variable twoQAccessed;
-    // the global mutex for the maps and the twoQ
+    // all opened segments. Segments are never removed, so references stay valid.
+    std::unordered_map<uint64_t, std::unique_ptr<Segment>> segments;
+    std::mutex segmentMutex;
+    // the segments which are memory mapped
+    std::unordered_map<uint64_t, AccessPattern> mappedSegments;
+    // number of NUMA nodes the frame pool is split across
+    unsigned numaNodes;
+    // returns the NUMA node of the calling thread, 0 if NUMA awareness is disabled
+    unsigned getNumaNode() const;
+    // the segments whose pages are compressed
+    std::unordered_set<uint64_t> compressedSegments;
+    // when the checksums of pages are verified
+    PageChecksums pageChecksums;
+    // set while recover() replays the log. The pages it loads are not verified,
+    // since torn pages are only repaired by the replay.
+    bool recovering;
+    // size of the page trailer storing the checksum. A multiple of 8 bytes,
+    // so that the usable part of a page stays aligned.
+    static const uint32_t pageTrailerSize;
+    // whether segment files are opened using O_DIRECT
+    bool directIO;
+    // the warm-up snapshot's file and how often the writer records it
+    std::string warmUpFile;
+    std::chrono::milliseconds warmUpInterval;
+    // at most this many pages are read by one request while warming up
+    static const uint64_t warmUpRunPages;
+    // the write-ahead log if BufferOptions::logFile is set
+    std::unique_ptr<WriteAheadLog> log;
+    uint64_t checkpointLogSize;
+    // threads executing asynchronous reads
+    std::unique_ptr<ThreadPool> ioPool;
+    // signaled whenever reads of loading frames completed
+    std::mutex loadMutex;
+    std::condition_variable loadCompleted;
+    // receives the pageIds of all fixPage calls if a trace is recorded
+    FILE* trace;
+    std::mutex traceMutex;
+    // the background writer and its configuration
+    std::thread writerThread;
+    std::mutex writerMutex;
+    std::condition_variable writerWakeup;
+    bool writerStopping;
+    unsigned writerIntervalMs;
+    // only used by the background writer, members in order to avoid allocations
+    std::vector<uint64_t> writerCandidates;
+    std::vector<BufferFrame*> writerFrames;
+    // the counters of BufferStats. There is one stripe per hardware thread
+    // and each thread increments the counters of one of them, so that threads
+    // rarely write to the same cache line.
+    struct StatsStripe {
+      std::atomic<uint64_t> hits;
+      std::atomic<uint64_t> misses;
+      std::atomic<uint64_t> prefetchedPages;
+      std::atomic<uint64_t> evictions;
+      std::atomic<uint64_t> evictionRetries;
+      std::atomic<uint64_t> foregroundWrites;
+      std::atomic<uint64_t> backgroundWrites;
+      std::atomic<uint64_t> backgroundWriteCalls;
+      std::atomic<uint64_t> evictionWaitNanos;
+      std::atomic<uint64_t> latchWaitNanos;
+      std::atomic<uint64_t> commits;
+      std::atomic<uint64_t> checkpoints;
+      std::atomic<uint64_t> remoteFixes;
+      // separates the counters of neighboring stripes
+      char padding[64];
+    };
+    unsigned statsStripeCount;
+    std::unique_ptr<StatsStripe[]> stats;
+    // increments a counter of the calling thread's stripe
+    void count(std::atomic<uint64_t> StatsStripe::* counter, uint64_t value = 1);
+    // adds the time passed since start to a counter
+    void countWait(std::atomic<uint64_t> StatsStripe::* counter,
+        std::chrono::steady_clock::time_point start);
+    // signaled whenever a page was added to a replacement policy
+    std::condition_variable pageAccessed;
+    // the global mutex for the replacement policies, the free frames and for adding
+    // and removing frames to/from the page table.
+    // Must be acquired before any partition's mutex.
     std::mutex globalMutex;
   };
 }
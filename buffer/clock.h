@@ -0,0 +1,63 @@
+#ifndef _CLOCK_HPP_
+#define _CLOCK_HPP_
+
+#include <vector>
+#include <cstdint>
+#include "buffer/replacementPolicy.h"
+
+namespace dbImpl {
+
+  /*
+   * Manages elements according to the CLOCK (second chance) strategy.
+   *
+   * All memory is allocated by the constructor, so neither hits nor
+   * insertions allocate. Pages are inserted without reference bit, i.e. a
+   * page must be accessed again before it gets a second chance.
+   */
+  template<typename T>
+  class Clock : public ReplacementPolicy<T> {
+    public:
+      // capacity is the maximum number of pages tracked at the same time
+      Clock(size_t capacity);
+
+      T evict() override;
+
+      // the hand simply passes rejected pages
+      T evictIf(const std::function<bool(T)>& evictable) override;
+
+      // throws a std::runtime_error if a new page exceeds the capacity
+      void access(T pageId) override;
+
+      bool empty() override;
+
+      void erase(T pageId) override;
+
+      void peekVictims(size_t count, std::vector<T>& victims) const override;
+
+    private:
+      struct Slot {
+        T pageId;
+        bool used;
+        bool referenced;
+      };
+      // the clock's slots. The hand moves over them in circles.
+      std::vector<Slot> slots;
+      std::vector<size_t> freeSlots;
+      size_t hand;
+      // hash table using linear probing. Maps pageIds to (slot index + 1), 0 marks empty buckets.
+      std::vector<size_t> table;
+      size_t tableMask;
+      unsigned tableShift;
+
+      // returns the bucket containing pageId or the empty bucket where it should be inserted
+      size_t findBucket(T pageId) const;
+      size_t homeBucket(T pageId) const;
+      // removes a non-empty bucket from the hash table
+      void eraseBucket(size_t bucket);
+  };
+
+}
+
+#include "buffer/clock.inl.cpp"
+
+#endif
@@ -0,0 +1,147 @@
+#include "buffer/clock.h"
+
+#include <functional>
+#include <stdexcept>
+
+namespace dbImpl {
+
+  template<typename T>
+  Clock<T>::Clock(size_t capacity) : slots(capacity), hand(0) {
+    freeSlots.reserve(capacity);
+    for (size_t i = capacity; i > 0; i--) {
+      slots[i - 1].used = false;
+      freeSlots.push_back(i - 1);
+    }
+    // the hash table is kept at a load factor of at most 0.5
+    size_t tableSize = 2;
+    tableShift = 63;
+    while (tableSize < 2 * capacity) {
+      tableSize <<= 1;
+      tableShift--;
+    }
+    table.assign(tableSize, 0);
+    tableMask = tableSize - 1;
+  }
+
+  template<typename T>
+  T Clock<T>::evict() {
+    if (empty()) {
+      throw std::runtime_error("evict() called on empty Clock");
+    }
+    return evictIf([](T) { return true; });
+  }
+
+  template<typename T>
+  T Clock<T>::evictIf(const std::function<bool(T)>& evictable) {
+    // the first round clears all reference bits, so every page
+    // is checked within two rounds
+    for (size_t passed = 0; passed < 2 * slots.size(); passed++) {
+      Slot& slot = slots[hand];
+      size_t current = hand;
+      hand = (hand + 1) % slots.size();
+      if (!slot.used) {
+        continue;
+      }
+      if (slot.referenced) {
+        // second chance
+        slot.referenced = false;
+        continue;
+      }
+      if (!evictable(slot.pageId)) {
+        continue;
+      }
+      eraseBucket(findBucket(slot.pageId));
+      slot.used = false;
+      freeSlots.push_back(current);
+      return slot.pageId;
+    }
+    throw std::runtime_error("Clock does not contain an evictable page");
+  }
+
+  template<typename T>
+  void Clock<T>::access(T pageId) {
+    size_t bucket = findBucket(pageId);
+    if (table[bucket] != 0) {
+      slots[table[bucket] - 1].referenced = true;
+      return;
+    }
+    if (freeSlots.empty()) {
+      throw std::runtime_error("Clock cannot track more pages than its capacity");
+    }
+    size_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    slots[slot].pageId = pageId;
+    slots[slot].used = true;
+    slots[slot].referenced = false;
+    table[bucket] = slot + 1;
+  }
+
+  template<typename T>
+  bool Clock<T>::empty() {
+    return freeSlots.size() == slots.size();
+  }
+
+  template<typename T>
+  void Clock<T>::erase(T pageId) {
+    size_t bucket = findBucket(pageId);
+    if (table[bucket] == 0) {
+      return;
+    }
+    size_t slot = table[bucket] - 1;
+    eraseBucket(bucket);
+    slots[slot].used = false;
+    freeSlots.push_back(slot);
+  }
+
+  template<typename T>
+  void Clock<T>::peekVictims(size_t count, std::vector<T>& victims) const {
+    // the hand first evicts all pages without reference bit. Afterwards, all
+    // reference bits are cleared and the remaining pages follow in the same order.
+    for (bool referenced : {false, true}) {
+      for (size_t i = 0; i < slots.size() && count > 0; i++) {
+        const Slot& slot = slots[(hand + i) % slots.size()];
+        if (slot.used && slot.referenced == referenced) {
+          victims.push_back(slot.pageId);
+          count--;
+        }
+      }
+    }
+  }
+
+  template<typename T>
+  size_t Clock<T>::homeBucket(T pageId) const {
+    // Fibonacci hashing, since std::hash is the identity for integers
+    return (static_cast<uint64_t>(std::hash<T>()(pageId)) * 0x9e3779b97f4a7c15ull) >> tableShift;
+  }
+
+  template<typename T>
+  size_t Clock<T>::findBucket(T pageId) const {
+    size_t bucket = homeBucket(pageId);
+    while (table[bucket] != 0 && slots[table[bucket] - 1].pageId != pageId) {
+      bucket = (bucket + 1) & tableMask;
+    }
+    return bucket;
+  }
+
+  template<typename T>
+  void Clock<T>::eraseBucket(size_t bucket) {
+    // backward shift deletion: move following entries into the gap
+    // unless this would move them in front of their home bucket.
+    table[bucket] = 0;
+    size_t next = bucket;
+    while (true) {
+      next = (next + 1) & tableMask;
+      if (table[next] == 0) {
+        return;
+      }
+      size_t home = homeBucket(slots[table[next] - 1].pageId);
+      // distance from the home bucket to the current/the free bucket
+      if (((next - home) & tableMask) >= ((next - bucket) & tableMask)) {
+        table[bucket] = table[next];
+        table[next] = 0;
+        bucket = next;
+      }
+    }
+  }
+
+}
@@ -0,0 +1,60 @@
+#ifndef _LRU_K_HPP_
+#define _LRU_K_HPP_
+
+#include <unordered_map>
+#include <set>
+#include <tuple>
+#include <vector>
+#include <cstdint>
+#include "buffer/replacementPolicy.h"
+
+namespace dbImpl {
+
+  /*
+   * Manages elements according to the LRU-K strategy.
+   *
+   * The victim is the page whose K-th most recent access lies furthest in
+   * the past. Pages with less than K accesses are evicted first, in LRU order.
+   * The history of evicted pages is not retained.
+   */
+  template<typename T>
+  class LruK : public ReplacementPolicy<T> {
+    public:
+      LruK(unsigned k = 2);
+
+      T evict() override;
+
+      // Rejected pages keep their position, it is determined by their
+      // access history.
+      T evictIf(const std::function<bool(T)>& evictable) override;
+
+      void access(T pageId) override;
+
+      bool empty() override;
+
+      void erase(T pageId) override;
+
+      void peekVictims(size_t count, std::vector<T>& victims) const override;
+
+    private:
+      // (time of the K-th most recent access or 0, time of the last access, page)
+      typedef std::tuple<uint64_t, uint64_t, T> Key;
+      struct Entry {
+        // the last K access times, the most recent one first
+        std::vector<uint64_t> history;
+        typename std::set<Key>::iterator position;
+      };
+
+      unsigned k;
+      // logical clock, incremented on every access
+      uint64_t now;
+      // all pages ordered by eviction priority
+      std::set<Key> queue;
+      std::unordered_map<T, Entry> entries;
+  };
+
+}
+
+#include "buffer/lruK.inl.cpp"
+
+#endif
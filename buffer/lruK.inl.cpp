@@ -0,0 +1,77 @@
+#include "buffer/lruK.h"
+
+#include <stdexcept>
+
+namespace dbImpl {
+
+  template<typename T>
+  LruK<T>::LruK(unsigned k) : k(k), now(0) {
+    if (k == 0) {
+      throw std::invalid_argument("LRU-K requires K > 0");
+    }
+  }
+
+  template<typename T>
+  T LruK<T>::evict() {
+    if (queue.empty()) {
+      throw std::runtime_error("evict() called on empty LRU-K");
+    }
+    T evicted = std::get<2>(*queue.begin());
+    queue.erase(queue.begin());
+    entries.erase(evicted);
+    return evicted;
+  }
+
+  template<typename T>
+  T LruK<T>::evictIf(const std::function<bool(T)>& evictable) {
+    for (auto it = queue.begin(); it != queue.end(); it++) {
+      T candidate = std::get<2>(*it);
+      if (evictable(candidate)) {
+        queue.erase(it);
+        entries.erase(candidate);
+        return candidate;
+      }
+    }
+    throw std::runtime_error("LRU-K does not contain an evictable page");
+  }
+
+  template<typename T>
+  void LruK<T>::access(T pageId) {
+    now++;
+    Entry& entry = entries[pageId];
+    if (!entry.history.empty()) {
+      queue.erase(entry.position);
+    }
+    if (entry.history.size() < k) {
+      entry.history.push_back(0);
+    }
+    for (size_t i = entry.history.size() - 1; i > 0; i--) {
+      entry.history[i] = entry.history[i - 1];
+    }
+    entry.history[0] = now;
+    uint64_t kthAccess = entry.history.size() == k ? entry.history.back() : 0;
+    entry.position = queue.insert(Key(kthAccess, now, pageId)).first;
+  }
+
+  template<typename T>
+  bool LruK<T>::empty() {
+    return queue.empty();
+  }
+
+  template<typename T>
+  void LruK<T>::erase(T pageId) {
+    auto it = entries.find(pageId);
+    if (it != entries.end()) {
+      queue.erase(it->second.position);
+      entries.erase(it);
+    }
+  }
+
+  template<typename T>
+  void LruK<T>::peekVictims(size_t count, std::vector<T>& victims) const {
+    for (auto it = queue.begin(); it != queue.end() && count > 0; it++, count--) {
+      victims.push_back(std::get<2>(*it));
+    }
+  }
+
+}
@@ -0,0 +1,63 @@
+#include "buffer/pageGuard.h"
+
+#include "buffer/bufferFrame.h"
+#include "buffer/bufferManager.h"
+
+namespace dbImpl {
+
+  PageGuard::PageGuard()
+    : bm(nullptr), frame(nullptr), exclusive(false), dirty(false) {}
+
+  PageGuard::PageGuard(BufferManager& bm, BufferFrame& frame, bool exclusive)
+    : bm(&bm), frame(&frame), exclusive(exclusive), dirty(false) {}
+
+  PageGuard::PageGuard(PageGuard&& other)
+    : bm(other.bm), frame(other.frame), exclusive(other.exclusive), dirty(other.dirty) {
+    other.frame = nullptr;
+  }
+
+  PageGuard& PageGuard::operator=(PageGuard&& other) {
+    if (this != &other) {
+      release();
+      bm = other.bm;
+      frame = other.frame;
+      exclusive = other.exclusive;
+      dirty = other.dirty;
+      other.frame = nullptr;
+    }
+    return *this;
+  }
+
+  PageGuard::~PageGuard() {
+    release();
+  }
+
+  uint8_t* PageGuard::getData() const {
+    return frame->getData();
+  }
+
+  void PageGuard::upgrade() {
+    if (!exclusive) {
+      bm->relatchFrame(*frame, true, false);
+      exclusive = true;
+    }
+  }
+
+  void PageGuard::downgrade() {
+    if (exclusive) {
+      // the modifications must be known before others may latch the page
+      bm->relatchFrame(*frame, false, dirty);
+      exclusive = false;
+    }
+  }
+
+  void PageGuard::release() {
+    if (frame != nullptr) {
+      BufferFrame* released = frame;
+      frame = nullptr;
+      bm->unfixPage(*released, dirty);
+      dirty = false;
+    }
+  }
+
+}
@@ -0,0 +1,61 @@
+#ifndef _PAGE_GUARD_H_
+#define _PAGE_GUARD_H_
+
+#include <cstdint>
+
+namespace dbImpl {
+  class BufferManager;
+  class BufferFrame;
+
+  /**
+   * Keeps a page fixed and latched for as long as the guard exists.
+   * Returned by BufferManager::fixPageGuarded().
+   *
+   * Guards are move-only. Moving a guard hands the fix over without touching
+   * the frame's pin count or latch. The page is unfixed when the guard is
+   * destroyed or release() is called, as dirty page if markDirty() was called.
+   */
+  class PageGuard {
+    public:
+      // an empty guard, which does not hold any page
+      PageGuard();
+      PageGuard(PageGuard&& other);
+      // releases the page held so far and takes over the other guard's page
+      PageGuard& operator=(PageGuard&& other);
+      PageGuard(const PageGuard&) = delete;
+      PageGuard& operator=(const PageGuard&) = delete;
+      ~PageGuard();
+
+      // true if the guard holds a page
+      explicit operator bool() const { return frame != nullptr; }
+      BufferFrame& operator*() const { return *frame; }
+      BufferFrame* operator->() const { return frame; }
+      // returns the frame or nullptr if the guard is empty
+      BufferFrame* getFrame() const { return frame; }
+      uint8_t* getData() const;
+      bool isExclusive() const { return exclusive; }
+
+      // the page is unfixed as dirty
+      void markDirty() { dirty = true; }
+      // Exchanges the shared latch for an exclusive one. The page stays fixed,
+      // but the latch is released in between: other threads might modify the
+      // page meanwhile, so everything read before must be checked again.
+      void upgrade();
+      // exchanges the exclusive latch for a shared one. Like upgrade(), the
+      // latch is released in between.
+      void downgrade();
+      // unfixes the page. The guard is empty afterwards.
+      void release();
+
+    private:
+      friend class BufferManager;
+      PageGuard(BufferManager& bm, BufferFrame& frame, bool exclusive);
+
+      BufferManager* bm;
+      BufferFrame* frame;
+      bool exclusive;
+      bool dirty;
+  };
+}
+
+#endif //_PAGE_GUARD_H_
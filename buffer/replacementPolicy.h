@@ -0,0 +1,70 @@
+#ifndef _REPLACEMENT_POLICY_HPP_
+#define _REPLACEMENT_POLICY_HPP_
+
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+namespace dbImpl {
+
+  // the replacement strategies a BufferManager can be configured with
+  enum class ReplacementStrategy {
+    TwoQ,
+    Clock,
+    LruK,
+    Arc
+  };
+
+  /*
+   * Decides which page should be evicted next.
+   * A policy only tracks pages which are resident (some policies remember
+   * the history of evicted pages additionally). It is not thread safe.
+   */
+  template<typename T>
+  class ReplacementPolicy {
+    public:
+      virtual ~ReplacementPolicy() {}
+
+      // Evicts a page out of the policy and returns it.
+      // Throws a std::runtime_error if no page is tracked.
+      virtual T evict() = 0;
+
+      // Evicts the next page in eviction order for which evictable returns true.
+      // evictable is not called anymore once it returned true. Pages it rejects,
+      // e.g. because they are pinned, stay tracked. Policies move them behind
+      // the pages checked next where possible, so that pages rejected over and
+      // over again are not checked again by every call.
+      // Throws a std::runtime_error if no page is evictable.
+      virtual T evictIf(const std::function<bool(T)>& evictable) = 0;
+
+      // Informs the policy about the access of a page.
+      // Pages which are not tracked yet are added.
+      virtual void access(T pageId) = 0;
+
+      virtual bool empty() = 0;
+
+      // Removes a page without treating it as evicted.
+      virtual void erase(T pageId) = 0;
+
+      // Removes a resident page, but keeps what the policy remembers about
+      // evicted pages, e.g. a ghost entry created when the page was evicted.
+      virtual void eraseResident(T pageId) { erase(pageId); }
+
+      // Appends the next (at most) count pages which would be evicted to victims.
+      // The policy is not modified.
+      virtual void peekVictims(size_t count, std::vector<T>& victims) const = 0;
+
+      // Returns true if the policy considers the page as frequently used,
+      // e.g. because it was promoted out of a queue for pages seen only once.
+      // Stored in warm-up snapshots.
+      virtual bool isFrequent(T pageId) const { return false; }
+
+      // Adds a page which was tracked before a restart. frequent is the value
+      // isFrequent() returned back then. Policies which do not distinguish
+      // frequently used pages treat this as a simple access.
+      virtual void restore(T pageId, bool frequent) { access(pageId); }
+  };
+
+}
+
+#endif
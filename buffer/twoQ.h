@@ -3,36 +3,74 @@
 
 #include <unordered_map>
 #include <list>
+#include <vector>
 #include <ostream>
+#include "buffer/replacementPolicy.h"
 
 namespace dbImpl {
 
   /*
    * Manages elements according to the 2Q-strategy.
+   *
+   * New pages enter the FIFO queue A1in. Repeated accesses while a page is
+   * in A1in are considered correlated and do not promote it. Pages evicted
+   * from A1in are remembered in the ghost queue A1out; if such a page is
+   * accessed again, it is promoted to the LRU queue Am. This way, a single
+   * large scan only passes through A1in and does not flush the hot pages in Am.
    */
   template<typename T>
-  class TwoQ {
+  class TwoQ : public ReplacementPolicy<T> {
     public:
+      // capacity is the number of pages managed by the caller.
+      // A1in is kept at inRatio * capacity pages (Kin) unless Am is empty,
+      // A1out remembers the last outRatio * capacity pages evicted from A1in (Kout).
+      TwoQ(size_t capacity, double inRatio = 0.25, double outRatio = 0.5);
+
       // Evicts a page out of the queues.
-      T evict();
+      T evict() override;
+
+      // Rejected pages are moved to the front of their queue. They are
+      // neither promoted nor remembered in the ghost queue.
+      T evictIf(const std::function<bool(T)>& evictable) override;
       
       // Informs the queue about the access of a page.
-      void access(T pageId);
+      void access(T pageId) override;
       
-      bool empty();
+      bool empty() override;
+
+      void erase(T pageId) override;
+      void eraseResident(T pageId) override;
+
+      // Appends the next (at most) count pages which would be evicted to victims.
+      // The queues are not modified.
+      void peekVictims(size_t count, std::vector<T>& victims) const override;
 
-      void erase(T pageId);
+      // pages in the LRU queue (Am) are frequently used
+      bool isFrequent(T pageId) const override;
+
+      // frequently used pages are put into the LRU queue directly
+      void restore(T pageId, bool frequent) override;
 
     private:
-      // FIFO and LRU queues are managed using std::lists
+      // Kin and Kout
+      size_t maxFifoSize;
+      size_t maxGhostSize;
+
+      // FIFO (A1in), LRU (Am) and ghost (A1out) queues are managed using std::lists
       std::list<T> fifoQueue;
       std::list<T> lruQueue;
+      std::list<T> ghostQueue;
       
       typedef typename std::list<T>::iterator list_iterator;
       
       // Hashmaps are used for O(1) access to the queue elements
       std::unordered_map<T, list_iterator> fifoMap;
       std::unordered_map<T, list_iterator> lruMap;
+      std::unordered_map<T, list_iterator> ghostMap;
+
+      // remove the last page of the respective queue
+      T evictFromFifo();
+      T evictFromLru();
 
       template<typename T2>
       friend std::ostream& operator<< (std::ostream& stream, const TwoQ<T2>& queue);
@@ -1,24 +1,73 @@
 #include "buffer/twoQ.h"
 
+#include <iterator>
 #include <stdexcept>
 
 namespace dbImpl {
   
+  template<typename T>
+  TwoQ<T>::TwoQ(size_t capacity, double inRatio, double outRatio)
+    : maxFifoSize(capacity * inRatio), maxGhostSize(capacity * outRatio) {}
+
   template<typename T>
   T TwoQ<T>::evict() {
-    T evicted;
-    if (!fifoQueue.empty()) {
-      evicted = fifoQueue.back();
-      fifoMap.erase(evicted);
-      fifoQueue.pop_back();
+    if (!fifoQueue.empty() && (fifoQueue.size() > maxFifoSize || lruQueue.empty())) {
+      return evictFromFifo();
     } else if(!lruQueue.empty()) {
-      evicted = lruQueue.back();
-      lruMap.erase(evicted);
-      lruQueue.pop_back();
+      return evictFromLru();
     } else {
       throw std::runtime_error("evict() called on empty 2Q");
     }
+  }
+
+  template<typename T>
+  T TwoQ<T>::evictIf(const std::function<bool(T)>& evictable) {
+    // Rejected pages are moved to the front of their queue, so the sizes of
+    // the queues do not change. Every page is checked at most once.
+    size_t fifoChecked = 0;
+    size_t lruChecked = 0;
+    while (true) {
+      bool fifoLeft = fifoChecked < fifoQueue.size();
+      bool lruLeft = lruChecked < lruQueue.size();
+      bool fromFifo;
+      if (fifoLeft && (fifoQueue.size() > maxFifoSize || !lruLeft)) {
+        fromFifo = true;
+      } else if (lruLeft) {
+        fromFifo = false;
+      } else {
+        throw std::runtime_error("2Q does not contain an evictable page");
+      }
+      std::list<T>& queue = fromFifo ? fifoQueue : lruQueue;
+      if (evictable(queue.back())) {
+        return fromFifo ? evictFromFifo() : evictFromLru();
+      }
+      queue.splice(queue.begin(), queue, std::prev(queue.end()));
+      (fromFifo ? fifoChecked : lruChecked)++;
+    }
+  }
 
+  template<typename T>
+  T TwoQ<T>::evictFromFifo() {
+    T evicted = fifoQueue.back();
+    fifoMap.erase(evicted);
+    fifoQueue.pop_back();
+    // remember the page, so that we can detect if it was needed again
+    if (maxGhostSize > 0) {
+      if (ghostQueue.size() >= maxGhostSize) {
+        ghostMap.erase(ghostQueue.back());
+        ghostQueue.pop_back();
+      }
+      ghostQueue.push_front(evicted);
+      ghostMap[evicted] = ghostQueue.begin();
+    }
+    return evicted;
+  }
+
+  template<typename T>
+  T TwoQ<T>::evictFromLru() {
+    T evicted = lruQueue.back();
+    lruMap.erase(evicted);
+    lruQueue.pop_back();
     return evicted;
   }
   
@@ -30,17 +79,18 @@ namespace dbImpl {
     if (it != lruMap.end()) {
       // Move to beginning
       lruQueue.splice(lruQueue.begin(), lruQueue, it->second);
-    } else {
-      it = fifoMap.find(pageId);
-      // in Fifo?
-      if (it != fifoMap.end()) {
+    } else if (fifoMap.find(pageId) == fifoMap.end()) {
+      // accesses to pages in the FIFO are correlated references. They are ignored.
+      it = ghostMap.find(pageId);
+      // recently evicted from the FIFO?
+      if (it != ghostMap.end()) {
         // add to lru queue
-        lruQueue.push_front(*it->second);
+        lruQueue.push_front(pageId);
         lruMap[pageId] = lruQueue.begin();
-        
-        // Remove from FIFO
-        fifoQueue.erase(it->second);
-        fifoMap.erase(pageId);
+
+        // Remove from ghost queue
+        ghostQueue.erase(it->second);
+        ghostMap.erase(it);
       } else {
         // Not in Memory
         // Add to FiFO
@@ -52,6 +102,17 @@ namespace dbImpl {
 
   template<typename T>
   void TwoQ<T>::erase(T pageId) {
+    eraseResident(pageId);
+    //erase from ghost queue
+    auto it = ghostMap.find(pageId);
+    if(it != ghostMap.end()) {
+      ghostQueue.erase(it->second);
+      ghostMap.erase(it);
+    }
+  }
+
+  template<typename T>
+  void TwoQ<T>::eraseResident(T pageId) {
     //erase from LRU queue
     auto it1 = lruMap.find(pageId);
     if(it1 != lruMap.end()) {
@@ -66,6 +127,43 @@ namespace dbImpl {
     }
   }
   
+  template<typename T>
+  void TwoQ<T>::peekVictims(size_t count, std::vector<T>& victims) const {
+    // same order as used by evict(): the FIFO down to its maximum size,
+    // then the LRU queue and finally the remaining pages of the FIFO
+    auto fifoIt = fifoQueue.rbegin();
+    size_t fifoSize = fifoQueue.size();
+    for(; fifoSize > maxFifoSize && count > 0; fifoIt++, fifoSize--, count--) {
+      victims.push_back(*fifoIt);
+    }
+    for(auto it = lruQueue.rbegin(); it != lruQueue.rend() && count > 0; it++, count--) {
+      victims.push_back(*it);
+    }
+    for(; fifoIt != fifoQueue.rend() && count > 0; fifoIt++, count--) {
+      victims.push_back(*fifoIt);
+    }
+  }
+
+  template<typename T>
+  bool TwoQ<T>::isFrequent(T pageId) const {
+    return lruMap.find(pageId) != lruMap.end();
+  }
+
+  template<typename T>
+  void TwoQ<T>::restore(T pageId, bool frequent) {
+    if (!frequent || lruMap.find(pageId) != lruMap.end() || fifoMap.find(pageId) != fifoMap.end()) {
+      access(pageId);
+      return;
+    }
+    auto it = ghostMap.find(pageId);
+    if (it != ghostMap.end()) {
+      ghostQueue.erase(it->second);
+      ghostMap.erase(it);
+    }
+    lruQueue.push_front(pageId);
+    lruMap[pageId] = lruQueue.begin();
+  }
+
   template<typename T>
   bool TwoQ<T>::empty() {
     return lruQueue.empty() && fifoQueue.empty();
@@ -99,6 +197,19 @@ namespace dbImpl {
         }
       }
     }
+    out << "; ghost: ";
+    if(queue.ghostQueue.empty()) {
+      out << "empty";
+    } else {
+      auto it = queue.ghostQueue.begin();
+      while(it != queue.ghostQueue.end()) {
+        out << *it;
+        it++;
+        if(it != queue.ghostQueue.end()) {
+          out << ", ";
+        }
+      }
+    }
     return out;
   }
   
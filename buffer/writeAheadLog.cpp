@@ -0,0 +1,253 @@
+#include "buffer/writeAheadLog.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include "utils/checkedIO.h"
+
+namespace dbImpl {
+
+const uint64_t WriteAheadLog::headerSize = 4096;
+const uint64_t WriteAheadLog::magic = 0x6c6f67646261ull;
+const uint64_t WriteAheadLog::replayChunkSize = 1024 * 1024;
+
+namespace {
+  // records are aligned to 8 bytes
+  uint64_t padded(uint64_t length) {
+    return (length + 7) & ~7ull;
+  }
+
+  // throws a std::system_error for the current errno
+  void throwErrno(const std::string& msg) {
+    int occurredErrno = errno;
+    errno = 0; //reset, so that later calls can succeed
+    throw std::system_error(std::error_code(occurredErrno, std::system_category()), msg);
+  }
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& fileName)
+  : fileName(fileName), endLsn(headerSize), durableLsn(headerSize),
+    checkpointLsn(headerSize), flushing(false), recoveryLsn(headerSize), syncCount(0) {
+  fd = open(fileName.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if (fd == -1) {
+    throwErrno("unable to open write-ahead log \"" + fileName + "\"");
+  }
+  struct stat logStat;
+  if (fstat(fd, &logStat) != 0) {
+    close(fd);
+    throwErrno("unable to stat write-ahead log \"" + fileName + "\"");
+  }
+  try {
+    if (static_cast<uint64_t>(logStat.st_size) < headerSize) {
+      writeHeader();
+    } else {
+      Header header;
+      checkedPread(fd, &header, sizeof(header), 0);
+      if (header.magic != magic || header.recoveryLsn < headerSize) {
+        throw std::runtime_error("\"" + fileName + "\" is not a write-ahead log");
+      }
+      recoveryLsn = header.recoveryLsn;
+      endLsn = durableLsn = checkpointLsn = static_cast<uint64_t>(logStat.st_size);
+    }
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+  try {
+    flush(getEndLsn());
+  } catch (...) {
+    //records which were never flushed were not committed either
+  }
+  close(fd);
+}
+
+uint64_t WriteAheadLog::append(uint64_t pageId, uint32_t offset, const uint8_t* data, uint32_t length) {
+  RecordHeader header;
+  header.pageId = pageId;
+  header.offset = offset;
+  header.length = length;
+  header.checksum = checksum(header, data);
+  std::lock_guard < std::mutex > lock(mutex);
+  return appendRecord(header, data);
+}
+
+uint64_t WriteAheadLog::appendUpdate(uint64_t pageId, const uint8_t* page, uint32_t pageSize,
+    uint32_t offset, uint32_t length, uint64_t pageLsn) {
+  while (true) {
+    // the checksum is computed without holding the mutex. If a checkpoint
+    // begins in the meantime, the record is built again as a full page image.
+    bool fullPage = pageLsn <= checkpointLsn.load();
+    RecordHeader header;
+    header.pageId = pageId;
+    header.offset = fullPage ? 0 : offset;
+    header.length = fullPage ? pageSize : length;
+    const uint8_t* data = page + header.offset;
+    header.checksum = checksum(header, data);
+    std::lock_guard < std::mutex > lock(mutex);
+    if (fullPage || pageLsn > checkpointLsn) {
+      return appendRecord(header, data);
+    }
+  }
+}
+
+uint64_t WriteAheadLog::beginCheckpoint() {
+  std::lock_guard < std::mutex > lock(mutex);
+  checkpointLsn = endLsn;
+  return endLsn;
+}
+
+uint64_t WriteAheadLog::appendRecord(const RecordHeader& header, const uint8_t* data) {
+  size_t start = buffer.size();
+  buffer.resize(start + sizeof(header) + padded(header.length));
+  std::memcpy(&buffer[start], &header, sizeof(header));
+  std::memcpy(&buffer[start + sizeof(header)], data, header.length);
+  endLsn += sizeof(header) + padded(header.length);
+  return endLsn;
+}
+
+void WriteAheadLog::flush(uint64_t lsn) {
+  std::unique_lock < std::mutex > lock(mutex);
+  lsn = std::min(lsn, endLsn);
+  while (durableLsn < lsn) {
+    if (flushing) {
+      // somebody else is writing. Their write might not include our
+      // records, so we check again once it completed.
+      flushed.wait(lock);
+      continue;
+    }
+    // write everything appended so far, including other threads' records
+    flushing = true;
+    flushBuffer.swap(buffer);
+    uint64_t flushedLsn = endLsn;
+    lock.unlock();
+    try {
+      checkedPwrite(fd, flushBuffer.data(), flushBuffer.size(), flushedLsn - flushBuffer.size());
+      if (fdatasync(fd) != 0) {
+        throwErrno("unable to sync write-ahead log \"" + fileName + "\"");
+      }
+      syncCount++;
+    } catch (...) {
+      // put the records back, the next flush tries again
+      lock.lock();
+      buffer.insert(buffer.begin(), flushBuffer.begin(), flushBuffer.end());
+      flushBuffer.clear();
+      flushing = false;
+      flushed.notify_all();
+      throw;
+    }
+    flushBuffer.clear();
+    lock.lock();
+    durableLsn = flushedLsn;
+    flushing = false;
+    flushed.notify_all();
+  }
+}
+
+uint64_t WriteAheadLog::getEndLsn() {
+  std::lock_guard < std::mutex > lock(mutex);
+  return endLsn;
+}
+
+uint64_t WriteAheadLog::getSize() {
+  std::lock_guard < std::mutex > lock(mutex);
+  return endLsn - recoveryLsn;
+}
+
+void WriteAheadLog::replay(const std::function<void(uint64_t pageId, uint32_t offset,
+    const uint8_t* data, uint32_t length)>& apply) {
+  // the records are read in chunks, so that long logs do not have to fit
+  // into memory. The chunk starts at the file offset chunkStart.
+  std::vector<uint8_t> chunk;
+  uint64_t chunkStart = recoveryLsn;
+  // makes sure that the chunk contains [lsn, lsn + length)
+  auto load = [&](uint64_t lsn, uint64_t length) {
+    if (lsn + length > chunkStart + chunk.size()) {
+      chunkStart = lsn;
+      chunk.resize(std::min(std::max(replayChunkSize, length), endLsn - lsn));
+      checkedPread(fd, chunk.data(), chunk.size(), chunkStart);
+    }
+  };
+  // records behind a torn record were never durable, so they must not be replayed
+  uint64_t lsn = recoveryLsn;
+  while (lsn + sizeof(RecordHeader) <= endLsn) {
+    load(lsn, sizeof(RecordHeader));
+    RecordHeader header;
+    std::memcpy(&header, &chunk[lsn - chunkStart], sizeof(header));
+    uint64_t recordLength = sizeof(header) + padded(header.length);
+    if (recordLength > endLsn - lsn) {
+      break;
+    }
+    load(lsn, recordLength);
+    const uint8_t* data = &chunk[lsn - chunkStart + sizeof(header)];
+    if (checksum(header, data) != header.checksum) {
+      break;
+    }
+    apply(header.pageId, header.offset, data, header.length);
+    lsn += recordLength;
+  }
+  // cut off the torn records, so that new records are not mixed up with them
+  endLsn = durableLsn = checkpointLsn = lsn;
+  if (ftruncate(fd, endLsn) != 0 || fdatasync(fd) != 0) {
+    throwErrno("unable to truncate write-ahead log \"" + fileName + "\"");
+  }
+}
+
+void WriteAheadLog::discard(uint64_t lsn) {
+  flush(lsn);
+  {
+    std::lock_guard < std::mutex > lock(mutex);
+    if (lsn <= recoveryLsn) {
+      return;
+    }
+    recoveryLsn = lsn;
+    writeHeader();
+  }
+  // free the disk space of the discarded records. Only an optimization,
+  // so errors can be ignored.
+  uint64_t holeEnd = lsn / headerSize * headerSize;
+  if (holeEnd > headerSize) {
+    if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, headerSize, holeEnd - headerSize) != 0) {
+      errno = 0;
+    }
+  }
+}
+
+uint64_t WriteAheadLog::getSyncCount() const {
+  return syncCount;
+}
+
+void WriteAheadLog::writeHeader() {
+  Header header;
+  header.magic = magic;
+  header.recoveryLsn = recoveryLsn;
+  std::vector<uint8_t> page(headerSize);
+  std::memcpy(page.data(), &header, sizeof(header));
+  checkedPwrite(fd, page.data(), page.size(), 0);
+  if (fdatasync(fd) != 0) {
+    throwErrno("unable to sync write-ahead log \"" + fileName + "\"");
+  }
+}
+
+uint64_t WriteAheadLog::checksum(const RecordHeader& header, const uint8_t* data) {
+  // FNV-1a over the record's header fields and its data
+  uint64_t hash = 0xcbf29ce484222325ull;
+  auto add = [&hash](const uint8_t* bytes, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+  };
+  add(reinterpret_cast<const uint8_t*>(&header.pageId), sizeof(header.pageId));
+  add(reinterpret_cast<const uint8_t*>(&header.offset), sizeof(header.offset));
+  add(reinterpret_cast<const uint8_t*>(&header.length), sizeof(header.length));
+  add(data, header.length);
+  return hash;
+}
+
+}
@@ -0,0 +1,115 @@
+#ifndef _WRITE_AHEAD_LOG_H_
+#define _WRITE_AHEAD_LOG_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+namespace dbImpl {
+
+  /**
+   * A redo log storing after-images of modified byte ranges of pages.
+   *
+   * The log sequence number (LSN) of a record is the file offset directly
+   * behind the record, so LSNs increase monotonically. Records are collected
+   * in memory and written by flush(). Threads flushing concurrently are served
+   * by a single write and fdatasync (group commit): one thread writes all
+   * records appended so far while the others wait for it.
+   *
+   * The first 4 KiB of the file contain the LSN at which recovery starts.
+   * Records in front of it are discarded by punching a hole into the file.
+   * The first record of a page behind the start of a checkpoint stores the
+   * whole page (full page image), so recovery does not depend on the page's
+   * state on disk, which might be torn.
+   */
+  class WriteAheadLog {
+    public:
+      // opens the log file. It is created if it does not exist.
+      WriteAheadLog(const std::string& fileName);
+      ~WriteAheadLog();
+      WriteAheadLog(const WriteAheadLog&) = delete;
+      WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+      // appends the after-image of length bytes stored at offset of the given
+      // page and returns the record's LSN. The record is not durable before
+      // flush() was called for its LSN.
+      uint64_t append(uint64_t pageId, uint32_t offset, const uint8_t* data, uint32_t length);
+      // like append for the modified range of the given page of pageSize bytes.
+      // The whole page is logged instead if the page's last record (pageLsn)
+      // does not follow the LSN returned by the last call of beginCheckpoint().
+      uint64_t appendUpdate(uint64_t pageId, const uint8_t* page, uint32_t pageSize,
+          uint32_t offset, uint32_t length, uint64_t pageLsn);
+      // returns the current end of the log. The next modification of each
+      // page is logged as a full page image, so a checkpoint covering all
+      // records up to the returned LSN may discard them.
+      uint64_t beginCheckpoint();
+      // waits until all records up to the given LSN are durable
+      void flush(uint64_t lsn);
+      // returns the LSN of the last appended record
+      uint64_t getEndLsn();
+      // returns the size of the records behind the recovery LSN
+      uint64_t getSize();
+      // calls apply for every record behind the recovery LSN, in the order of
+      // their LSNs. A torn record at the end of the file terminates the log.
+      // The file is read in chunks of replayChunkSize bytes.
+      // Must be called before any records are appended.
+      void replay(const std::function<void(uint64_t pageId, uint32_t offset,
+          const uint8_t* data, uint32_t length)>& apply);
+      // marks all records before lsn as unnecessary for recovery, i.e. all
+      // pages they modified were written to disk.
+      void discard(uint64_t lsn);
+      // number of fdatasync calls issued for the log
+      uint64_t getSyncCount() const;
+
+    private:
+      // the file header. Occupies the first headerSize bytes.
+      struct Header {
+        uint64_t magic;
+        // recovery starts at this LSN
+        uint64_t recoveryLsn;
+      };
+      // stored in front of each record's data. The data is padded to 8 bytes.
+      struct RecordHeader {
+        uint64_t pageId;
+        uint32_t offset;
+        uint32_t length;
+        uint64_t checksum;
+      };
+      static const uint64_t headerSize;
+      static const uint64_t magic;
+      static const uint64_t replayChunkSize;
+      static uint64_t checksum(const RecordHeader& header, const uint8_t* data);
+      // persists the header
+      void writeHeader();
+      // adds the record to the buffer and returns its LSN. Requires the mutex.
+      uint64_t appendRecord(const RecordHeader& header, const uint8_t* data);
+
+      int fd;
+      std::string fileName;
+      std::mutex mutex;
+      // signaled whenever a flush completed
+      std::condition_variable flushed;
+      // records which were appended but not written yet. Protected by the mutex.
+      std::vector<uint8_t> buffer;
+      // the records currently being written. Only used by the flushing thread.
+      std::vector<uint8_t> flushBuffer;
+      // LSN of the last appended and of the last durable record
+      uint64_t endLsn;
+      uint64_t durableLsn;
+      // LSN returned by the last call of beginCheckpoint(). Only written while
+      // holding the mutex, but read without it in order to compute a record's
+      // checksum before appending.
+      std::atomic<uint64_t> checkpointLsn;
+      // set while one thread is writing records for everybody
+      bool flushing;
+      uint64_t recoveryLsn;
+      std::atomic<uint64_t> syncCount;
+  };
+
+}
+
+#endif //_WRITE_AHEAD_LOG_H_
@@ -0,0 +1,596 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <unordered_set>
+#include <algorithm>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string.h>
+
+#include "buffer/bufferManager.h"
+#include "buffer/bufferFrame.h"
+#include "buffer/twoQ.h"
+#include "buffer/clock.h"
+#include "buffer/lruK.h"
+#include "buffer/arc.h"
+#include "slottedPages/spSegment.h"
+#include "utils/checkedIO.h"
+
+using namespace std;
+using namespace dbImpl;
+
+BufferManager* bm;
+unsigned pagesInRAM;
+unsigned fixesPerThread;
+unsigned* threadSeed;
+
+// writes pagesOnDisk pages into segment 0
+static void createScannedSegment(unsigned pagesOnDisk, const BufferOptions& options) {
+  unlink("segments/0");
+  bm = new BufferManager(pagesInRAM, options);
+  for (unsigned i=0; i<pagesOnDisk; i++) {
+    BufferFrame& bf = bm->fixPage(i, true);
+    reinterpret_cast<unsigned*>(bf.getData())[0]=i;
+    bm->unfixPage(bf, true);
+  }
+  delete bm;
+}
+
+// evicts segment 0 from the operating system's page cache,
+// so that the next scan starts cold
+static void dropScannedSegmentFromPageCache() {
+  int segmentFd = open("segments/0", O_RDONLY);
+  if (segmentFd != -1) {
+    fdatasync(segmentFd);
+    posix_fadvise(segmentFd, 0, 0, POSIX_FADV_DONTNEED);
+    close(segmentFd);
+  }
+}
+
+// scans the pages of segment 0 sequentially using a new BufferManager
+// and reports the throughput
+static void timeScan(const char* name, unsigned pagesOnDisk, unsigned readAhead,
+    const BufferOptions& options) {
+  bm = new BufferManager(pagesInRAM, options);
+  auto start = chrono::steady_clock::now();
+  uint64_t checksum = 0;
+  for (unsigned page=0; page<pagesOnDisk; page++) {
+    if (readAhead > 0 && page % readAhead == 0) {
+      bm->prefetch(page + readAhead, readAhead);
+    }
+    BufferFrame& bf = bm->fixPage(page, false);
+    // read the whole page, otherwise a mapped page would only be touched partially
+    unsigned* words = reinterpret_cast<unsigned*>(bf.getData());
+    for (uint32_t i=0; i<bf.getSize()/sizeof(unsigned); i++) {
+      checksum += words[i];
+    }
+    bm->unfixPage(bf, false);
+  }
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  double megabytes = static_cast<double>(pagesOnDisk) * bm->getPageSize(0) / (1024 * 1024);
+  cout << name << "scanned " << pagesOnDisk << " pages in " << elapsed.count() << "s ("
+       << megabytes / elapsed.count() << " MiB/s, checksum " << checksum << ")" << endl;
+  delete bm;
+}
+
+// scans all pages sequentially. Reads ahead readAhead pages using prefetch().
+static int scan(unsigned pagesOnDisk, unsigned readAhead, uint32_t pageSize) {
+  BufferOptions options;
+  options.pageSize = pageSize;
+  createScannedSegment(pagesOnDisk, options);
+  dropScannedSegmentFromPageCache();
+  timeScan("", pagesOnDisk, readAhead, options);
+  return 0;
+}
+
+// compares cold scans reading the pages into the frame pool with
+// scans of the memory mapped segment
+static int mappedScan(unsigned pagesOnDisk, unsigned readAhead) {
+  BufferOptions options;
+  createScannedSegment(pagesOnDisk, options);
+  BufferOptions mappedOptions;
+  mappedOptions.mappedSegments[0] = AccessPattern::Sequential;
+  dropScannedSegmentFromPageCache();
+  timeScan("pread: ", pagesOnDisk, readAhead, options);
+  dropScannedSegmentFromPageCache();
+  timeScan("mmap:  ", pagesOnDisk, readAhead, mappedOptions);
+  // the same again, this time the segment is cached by the operating system
+  timeScan("pread (cached): ", pagesOnDisk, readAhead, options);
+  timeScan("mmap (cached):  ", pagesOnDisk, readAhead, mappedOptions);
+  return 0;
+}
+
+// writes pagesOnDisk pages into segment 0 which look like the pages of a
+// table: fixed size rows with an ascending key, small numbers and names
+static void createTableSegment(unsigned pagesOnDisk, const BufferOptions& options) {
+  struct Row {
+    uint64_t id;
+    uint32_t quantity;
+    uint32_t status;
+    char name[16];
+  };
+  const char* names[] = {"Smith", "Johnson", "Williams", "Brown", "Jones", "Miller", "Davis", "Garcia"};
+  unlink("segments/0");
+  unlink("segments/0.map");
+  bm = new BufferManager(pagesInRAM, options);
+  unsigned seed = 42;
+  uint64_t id = 0;
+  for (unsigned i=0; i<pagesOnDisk; i++) {
+    BufferFrame& bf = bm->fixPage(i, true);
+    Row* rows = reinterpret_cast<Row*>(bf.getData());
+    for (uint32_t r=0; r<bf.getSize()/sizeof(Row); r++) {
+      rows[r].id = id++;
+      rows[r].quantity = rand_r(&seed) % 100;
+      rows[r].status = rand_r(&seed) % 4;
+      memset(rows[r].name, 0, sizeof(rows[r].name));
+      strcpy(rows[r].name, names[rand_r(&seed) % 8]);
+    }
+    bm->unfixPage(bf, true);
+  }
+  delete bm;
+}
+
+// compares cold scans of a compressed and an uncompressed segment
+static int compressedScan(unsigned pagesOnDisk, unsigned readAhead) {
+  BufferOptions compressedOptions;
+  compressedOptions.compressedSegments.insert(0);
+  BufferOptions options;
+  for (const BufferOptions* scanned : {&options, &compressedOptions}) {
+    const char* name = scanned == &options ? "uncompressed: " : "compressed:   ";
+    createTableSegment(pagesOnDisk, *scanned);
+    struct stat segmentStat;
+    if (stat("segments/0", &segmentStat) == 0) {
+      cout << name << segmentStat.st_size / (1024 * 1024) << " MiB on disk" << endl;
+    }
+    dropScannedSegmentFromPageCache();
+    timeScan(name, pagesOnDisk, readAhead, *scanned);
+    timeScan(name, pagesOnDisk, readAhead, *scanned);
+  }
+  return 0;
+}
+
+// measures the latency of misses with and without verifying page checksums.
+// The pages are cached by the operating system, so the checksum's share of the
+// latency is larger than for misses which have to access the disk. Every page
+// is loaded twice: the second scan consists of reloads of evicted pages.
+static int checksumLatency(unsigned pagesOnDisk) {
+  BufferOptions options;
+  options.pageChecksums = PageChecksums::Always;
+  createScannedSegment(pagesOnDisk, options);
+  const pair<const char*, PageChecksums> modes[] = {
+    {"none:       ", PageChecksums::None},
+    {"always:     ", PageChecksums::Always},
+    {"first load: ", PageChecksums::FirstLoad}
+  };
+  double baseline[2] = {0, 0};
+  // the first round warms up the operating system's cache
+  for (unsigned round=0; round<2; round++) {
+    for (auto& mode : modes) {
+      options.pageChecksums = mode.second;
+      bm = new BufferManager(pagesInRAM, options);
+      double nanosPerMiss[2];
+      for (unsigned scan=0; scan<2; scan++) {
+        uint64_t missesBefore = bm->getStats().misses;
+        auto start = chrono::steady_clock::now();
+        for (unsigned page=0; page<pagesOnDisk; page++) {
+          BufferFrame& bf = bm->fixPage(page, false);
+          bm->unfixPage(bf, false);
+        }
+        chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+        nanosPerMiss[scan] = elapsed.count() / (bm->getStats().misses - missesBefore);
+        if (mode.second == PageChecksums::None) {
+          baseline[scan] = nanosPerMiss[scan];
+        }
+      }
+      delete bm;
+      if (round == 1) {
+        cout << mode.first;
+        for (unsigned scan=0; scan<2; scan++) {
+          cout << (scan == 0 ? "first load " : ", reload ") << static_cast<uint64_t>(nanosPerMiss[scan])
+               << "ns per miss (+" << (nanosPerMiss[scan] / baseline[scan] - 1) * 100 << "%)";
+        }
+        cout << endl;
+      }
+    }
+  }
+  return 0;
+}
+
+static void* fixMissingPages(void *arg) {
+  // every thread fixes its own pages behind the pinned ones, so every fix is a miss
+  uintptr_t threadNum = reinterpret_cast<uintptr_t>(arg);
+  uint64_t firstPage = pagesInRAM + threadNum * static_cast<uint64_t>(fixesPerThread);
+  for (unsigned i=0; i<fixesPerThread; i++) {
+    BufferFrame& bf = bm->fixPage(BufferManager::buildPageId(1, firstPage + i), false);
+    bm->unfixPage(bf, false);
+  }
+  return nullptr;
+}
+
+// measures the latency of misses while a growing share of the frames is pinned.
+// Every miss has to search an unpinned victim.
+static int pinnedEviction(unsigned threadCount) {
+  unlink("segments/1");
+  BufferOptions options;
+  options.backgroundWriter = false;
+  pthread_attr_t pattr;
+  pthread_attr_init(&pattr);
+  for (unsigned pinnedPercent : {0, 50, 90, 99}) {
+    bm = new BufferManager(pagesInRAM, options);
+    unsigned pinnedCount = static_cast<uint64_t>(pagesInRAM) * pinnedPercent / 100;
+    vector<BufferFrame*> pinned;
+    for (unsigned i=0; i<pinnedCount; i++) {
+      pinned.push_back(&bm->fixPage(BufferManager::buildPageId(1, i), false));
+    }
+    uint64_t retriesBefore = bm->getStats().evictionRetries;
+    vector<pthread_t> threads(threadCount);
+    auto start = chrono::steady_clock::now();
+    for (unsigned i=0; i<threadCount; i++) {
+      pthread_create(&threads[i], &pattr, fixMissingPages, reinterpret_cast<void*>(i));
+    }
+    for (unsigned i=0; i<threadCount; i++) {
+      pthread_join(threads[i], NULL);
+    }
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    BufferStats stats = bm->getStats();
+    uint64_t misses = static_cast<uint64_t>(threadCount) * fixesPerThread;
+    cout << "pinned " << pinnedPercent << "%: "
+         << static_cast<uint64_t>(elapsed.count() * threadCount / misses) << "ns per miss, "
+         << static_cast<double>(stats.evictionRetries - retriesBefore) / misses
+         << " pinned pages skipped per miss" << endl;
+    for (BufferFrame* frame : pinned) {
+      bm->unfixPage(*frame, false);
+    }
+    delete bm;
+  }
+  unlink("segments/1");
+  return 0;
+}
+
+// records a trace of a mixed workload: every other fix belongs to a sequential
+// scan over all pages, the remaining fixes access random pages of a hot set.
+static int record(const char* traceFile, unsigned pagesOnDisk, unsigned fixes) {
+  unlink(traceFile);
+  BufferOptions options;
+  options.traceFile = traceFile;
+  bm = new BufferManager(pagesInRAM, options);
+  unsigned seed = 42;
+  unsigned hotPages = std::max(pagesOnDisk / 10, 1u);
+  for (unsigned i=0; i<fixes; i++) {
+    uint64_t page = i % 2 == 0 ? (i / 2) % pagesOnDisk : rand_r(&seed) % hotPages;
+    BufferFrame& bf = bm->fixPage(page, false);
+    bm->unfixPage(bf, false);
+  }
+  delete bm;
+  return 0;
+}
+
+// replays the trace against a policy managing pagesInRAM pages.
+// If hotPages is set, the hit ratio of the pages [0, hotPages) is reported as well.
+static void simulate(const char* name, ReplacementPolicy<uint64_t>& policy,
+    const vector<uint64_t>& trace, uint64_t hotPages) {
+  unordered_set<uint64_t> resident;
+  resident.reserve(2 * pagesInRAM);
+  uint64_t hits = 0;
+  uint64_t hotAccesses = 0;
+  uint64_t hotHits = 0;
+  auto start = chrono::steady_clock::now();
+  for (uint64_t page : trace) {
+    bool hot = page < hotPages;
+    hotAccesses += hot;
+    if (resident.count(page)) {
+      hits++;
+      hotHits += hot;
+    } else {
+      if (resident.size() >= pagesInRAM) {
+        resident.erase(policy.evict());
+      }
+      resident.insert(page);
+    }
+    policy.access(page);
+  }
+  chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+  cout << name << "\t" << static_cast<double>(hits) / trace.size()
+       << "\t" << elapsed.count() / trace.size();
+  if (hotPages > 0) {
+    cout << "\t" << static_cast<double>(hotHits) / hotAccesses;
+  }
+  cout << endl;
+}
+
+// runs the trace against all replacement strategies
+static void compareStrategies(const vector<uint64_t>& trace, uint64_t hotPages) {
+  cout << "policy\thit ratio\tns/access" << (hotPages > 0 ? "\thot hit ratio" : "") << endl;
+  {
+    TwoQ<uint64_t> policy(pagesInRAM);
+    simulate("2Q", policy, trace, hotPages);
+  }
+  {
+    Clock<uint64_t> policy(pagesInRAM);
+    simulate("CLOCK", policy, trace, hotPages);
+  }
+  {
+    LruK<uint64_t> policy(2);
+    simulate("LRU-2", policy, trace, hotPages);
+  }
+  {
+    Arc<uint64_t> policy(pagesInRAM);
+    simulate("ARC", policy, trace, hotPages);
+  }
+}
+
+// compares the replacement strategies on a trace recorded using BufferOptions::traceFile
+static int replay(const char* traceFile) {
+  int fd = open(traceFile, O_RDONLY);
+  struct stat traceStat;
+  if (fd == -1 || fstat(fd, &traceStat) != 0) {
+    cerr << "unable to open trace file " << traceFile << endl;
+    return 1;
+  }
+  vector<uint64_t> trace(traceStat.st_size / sizeof(uint64_t));
+  checkedPread(fd, trace.data(), trace.size() * sizeof(uint64_t), 0);
+  close(fd);
+  compareStrategies(trace, 0);
+  return 0;
+}
+
+// point lookups on hot pages (e.g. B-Tree inner nodes) interleaved with
+// sequential scans over scanPages other pages. Reports whether the hot
+// pages survive the scans.
+static int scanMix(unsigned hotPages, unsigned scanPages, unsigned rounds) {
+  vector<uint64_t> trace;
+  unsigned seed = 42;
+  for (unsigned round=0; round<rounds; round++) {
+    for (unsigned i=0; i<scanPages; i++) {
+      // one lookup on every fourth scanned page
+      if (i % 4 == 0) {
+        trace.push_back(rand_r(&seed) % hotPages);
+      }
+      trace.push_back(hotPages + i);
+    }
+  }
+  compareStrategies(trace, hotPages);
+  return 0;
+}
+
+// loads records into a slotted pages segment, once using single inserts and
+// once using an Appender. Reports the throughput and the number of page fixes
+// per record for every tenth of the records.
+static int load(unsigned records) {
+  uint8_t data[100];
+  memset(data, 'x', sizeof(data));
+  unsigned step = max(records / 10, 1u);
+  for (bool bulk : {false, true}) {
+    unlink("segments/1");
+    bm = new BufferManager(pagesInRAM);
+    SPSegment* segment = new SPSegment(*bm, 1);
+    SPSegment::Appender appender = segment->appender();
+    cout << (bulk ? "appender:" : "insert:") << endl;
+    cout << "records\trecords/s\tMiB/s\tfixes per record" << endl;
+    auto loadStart = chrono::steady_clock::now();
+    for (unsigned loaded=0; loaded<records; ) {
+      BufferStats before = bm->getStats();
+      unsigned inserted = 0;
+      auto start = chrono::steady_clock::now();
+      for (; inserted<step && loaded<records; inserted++, loaded++) {
+        memcpy(data, &loaded, sizeof(loaded));
+        if (bulk) {
+          appender.append(data, sizeof(data));
+        } else {
+          segment->insert(Record(sizeof(data), data));
+        }
+      }
+      if (loaded == records) {
+        appender.finish();
+      }
+      chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+      BufferStats stats = bm->getStats();
+      cout << loaded << "\t" << static_cast<uint64_t>(inserted / elapsed.count())
+           << "\t" << static_cast<uint64_t>(inserted * sizeof(data) / elapsed.count() / (1024 * 1024))
+           << "\t" << static_cast<double>(stats.hits + stats.misses - before.hits - before.misses) / inserted << endl;
+    }
+    // including writing all pages
+    bm->checkpoint();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - loadStart;
+    cout << "total (written): " << static_cast<uint64_t>(records / elapsed.count()) << " records/s, "
+         << static_cast<uint64_t>(records * sizeof(data) / elapsed.count() / (1024 * 1024)) << " MiB/s" << endl;
+    delete segment;
+    delete bm;
+  }
+  unlink("segments/1");
+  return 0;
+}
+
+// resolves random TIDs, as an index nested loop join does, once by single
+// lookups and once in batches of batchSize TIDs. Both start with a cold
+// buffer and with the segment evicted from the operating system's page cache.
+static int lookup(unsigned records, unsigned lookups, unsigned batchSize) {
+  unlink("segments/1");
+  vector<uint64_t> tids;
+  {
+    bm = new BufferManager(pagesInRAM);
+    SPSegment segment(*bm, 1);
+    uint8_t data[100];
+    memset(data, 'x', sizeof(data));
+    SPSegment::Appender appender = segment.appender();
+    for (unsigned i=0; i<records; i++) {
+      appender.append(data, sizeof(data));
+    }
+    for (const SPSegment::TidRange& range : appender.finish()) {
+      for (uint16_t i=0; i<range.count; i++) {
+        tids.push_back(range.getTid(i));
+      }
+    }
+    delete bm;
+  }
+  unsigned seed = 42;
+  vector<uint64_t> probes(lookups);
+  for (uint64_t& probe : probes) {
+    probe = tids[rand_r(&seed) % tids.size()];
+  }
+  for (bool batched : {false, true}) {
+    int segmentFd = open("segments/1", O_RDONLY);
+    if (segmentFd != -1) {
+      // dirty pages are not dropped from the page cache
+      fdatasync(segmentFd);
+      posix_fadvise(segmentFd, 0, 0, POSIX_FADV_DONTNEED);
+      close(segmentFd);
+    }
+    bm = new BufferManager(pagesInRAM);
+    SPSegment* segment = new SPSegment(*bm, 1);
+    uint64_t checksum = 0;
+    auto start = chrono::steady_clock::now();
+    if (batched) {
+      for (unsigned first=0; first<lookups; first+=batchSize) {
+        vector<uint64_t> batch(probes.begin() + first, probes.begin() + min(first + batchSize, lookups));
+        segment->lookupBatch(batch, [&checksum](size_t, const RecordView& record) {
+          checksum += record.getData()[0];
+        });
+      }
+    } else {
+      for (uint64_t probe : probes) {
+        checksum += segment->lookup(probe).getData()[0];
+      }
+    }
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    BufferStats stats = bm->getStats();
+    cout << (batched ? "lookupBatch: " : "lookup:      ") << static_cast<uint64_t>(elapsed.count() / lookups)
+         << "ns per record, " << static_cast<double>(stats.hits + stats.misses) / lookups
+         << " fixes per record, " << static_cast<double>(stats.misses + stats.prefetchedPages) / lookups
+         << " page reads per record (" << checksum << ")" << endl;
+    delete segment;
+    delete bm;
+  }
+  unlink("segments/1");
+  return 0;
+}
+
+// inserts records of recordSize bytes and reports how densely they are stored
+// and how long a cold scan over them takes. For comparison, the pages the
+// previous format with 8 bit slot numbers and 16 byte slots would need are
+// computed as well.
+static int density(unsigned records, unsigned recordSize) {
+  unlink("segments/1");
+  bm = new BufferManager(pagesInRAM);
+  uint32_t pageSize = bm->getPageSize(1);
+  uint64_t lastPageId = 0;
+  {
+    SPSegment segment(*bm, 1);
+    vector<uint8_t> data(recordSize, 'x');
+    for (unsigned i=0; i<records; i++) {
+      // (the lower 48 bits of a TID store the page id)
+      lastPageId = max<uint64_t>(lastPageId, segment.insert(Record(recordSize, data.data())) & 0xffffffffffffull);
+    }
+  }
+  delete bm;
+  uint64_t pages = BufferManager::getPartIdForPageId(lastPageId) + 1;
+  // the page header had 16 bytes as well
+  uint64_t narrowPerPage = min<uint64_t>(255, (pageSize - 16) / (recordSize + 16));
+  uint64_t narrowPages = (records + narrowPerPage - 1) / narrowPerPage;
+  cout << "pages: " << pages << " (8 bit slot numbers: " << narrowPages << ")" << endl;
+  cout << "records per page: " << static_cast<double>(records) / pages
+       << " (8 bit slot numbers: " << narrowPerPage << ")" << endl;
+  cout << "page utilization: " << 100.0 * records * recordSize / (pages * pageSize)
+       << "% (8 bit slot numbers: " << 100.0 * records * recordSize / (narrowPages * pageSize) << "%)" << endl;
+
+  int segmentFd = open("segments/1", O_RDONLY);
+  if (segmentFd != -1) {
+    fdatasync(segmentFd);
+    posix_fadvise(segmentFd, 0, 0, POSIX_FADV_DONTNEED);
+    close(segmentFd);
+  }
+  bm = new BufferManager(pagesInRAM);
+  {
+    SPSegment segment(*bm, 1);
+    uint64_t checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (auto iter = segment.begin(); iter != segment.end(); iter++) {
+      checksum += (*iter).getData()[0];
+    }
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    BufferStats stats = bm->getStats();
+    cout << "cold scan: " << static_cast<uint64_t>(elapsed.count() / records) << "ns per record, "
+         << stats.misses + stats.prefetchedPages << " pages read (" << checksum << ")" << endl;
+  }
+  delete bm;
+  unlink("segments/1");
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  string mode = argc > 1 ? argv[1] : "";
+  if (mode == "scan" && (argc == 5 || argc == 6)) {
+    unsigned pagesOnDisk = atoi(argv[2]);
+    pagesInRAM = atoi(argv[3]);
+    unsigned readAhead = atoi(argv[4]);
+    uint32_t pageSize = argc == 6 ? atoi(argv[5]) : BufferOptions().pageSize;
+    return scan(pagesOnDisk, readAhead, pageSize);
+  } else if (mode == "mapscan" && argc == 5) {
+    unsigned pagesOnDisk = atoi(argv[2]);
+    pagesInRAM = atoi(argv[3]);
+    unsigned readAhead = atoi(argv[4]);
+    return mappedScan(pagesOnDisk, readAhead);
+  } else if (mode == "compressedscan" && argc == 5) {
+    unsigned pagesOnDisk = atoi(argv[2]);
+    pagesInRAM = atoi(argv[3]);
+    unsigned readAhead = atoi(argv[4]);
+    return compressedScan(pagesOnDisk, readAhead);
+  } else if (mode == "checksum" && argc == 4) {
+    unsigned pagesOnDisk = atoi(argv[2]);
+    pagesInRAM = atoi(argv[3]);
+    return checksumLatency(pagesOnDisk);
+  } else if (mode == "pinned" && argc == 5) {
+    pagesInRAM = atoi(argv[2]);
+    unsigned threadCount = atoi(argv[3]);
+    fixesPerThread = atoi(argv[4]);
+    return pinnedEviction(threadCount);
+  } else if (mode == "load" && argc == 4) {
+    unsigned records = atoi(argv[2]);
+    pagesInRAM = atoi(argv[3]);
+    return load(records);
+  } else if (mode == "lookup" && argc == 6) {
+    unsigned records = atoi(argv[2]);
+    unsigned lookups = atoi(argv[3]);
+    unsigned batchSize = atoi(argv[4]);
+    pagesInRAM = atoi(argv[5]);
+    return lookup(records, lookups, max(batchSize, 1u));
+  } else if (mode == "density" && argc == 5) {
+    unsigned records = atoi(argv[2]);
+    unsigned recordSize = atoi(argv[3]);
+    pagesInRAM = atoi(argv[4]);
+    return density(records, recordSize);
+  } else if (mode == "record" && argc == 6) {
+    unsigned pagesOnDisk = atoi(argv[3]);
+    pagesInRAM = atoi(argv[4]);
+    unsigned fixes = atoi(argv[5]);
+    return record(argv[2], pagesOnDisk, fixes);
+  } else if (mode == "scanmix" && argc == 6) {
+    unsigned hotPages = atoi(argv[2]);
+    unsigned scanPages = atoi(argv[3]);
+    pagesInRAM = atoi(argv[4]);
+    unsigned rounds = atoi(argv[5]);
+    return scanMix(hotPages, scanPages, rounds);
+  } else if (mode == "replay" && argc == 4) {
+    pagesInRAM = atoi(argv[3]);
+    return replay(argv[2]);
+  } else {
+    cerr << "usage: " << argv[0] << " scan <pagesOnDisk> <pagesInRAM> <readAhead> [<pageSize>]" << endl;
+    cerr << "       " << argv[0] << " mapscan <pagesOnDisk> <pagesInRAM> <readAhead>" << endl;
+    cerr << "       " << argv[0] << " compressedscan <pagesOnDisk> <pagesInRAM> <readAhead>" << endl;
+    cerr << "       " << argv[0] << " checksum <pagesOnDisk> <pagesInRAM>" << endl;
+    cerr << "       " << argv[0] << " pinned <pagesInRAM> <threads> <fixesPerThread>" << endl;
+    cerr << "       " << argv[0] << " load <records> <pagesInRAM>" << endl;
+    cerr << "       " << argv[0] << " lookup <records> <lookups> <batchSize> <pagesInRAM>" << endl;
+    cerr << "       " << argv[0] << " density <records> <recordSize> <pagesInRAM>" << endl;
+    cerr << "       " << argv[0] << " record <traceFile> <pagesOnDisk> <pagesInRAM> <fixes>" << endl;
+    cerr << "       " << argv[0] << " replay <traceFile> <pagesInRAM>" << endl;
+    cerr << "       " << argv[0] << " scanmix <hotPages> <scanPages> <pagesInRAM> <rounds>" << endl;
+    return 1;
+  }
+}
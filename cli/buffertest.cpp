@@ -1,10 +1,13 @@
 #include <iostream>
 #include <sstream>
+#include <string>
 #include <vector>
 #include <stdlib.h>
 #include <stdint.h>
 #include <assert.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <chrono>
 
 #include "buffer/bufferManager.h"
 #include "buffer/bufferFrame.h"
@@ -18,6 +21,10 @@ unsigned pagesInRAM;
 unsigned threadCount;
 unsigned* threadSeed;
 volatile bool stop=false;
+unsigned fixesPerThread;
+unsigned statsInterval=0;
+unsigned numaNodes=1;
+volatile bool stopStats=false;
 
 unsigned randomPage(unsigned threadNum) {
   // pseudo-gaussian, causes skewed access pattern
@@ -47,6 +54,17 @@ static void* scan(void *arg) {
   return NULL;
 }
 
+static void* dumpStats(void *arg) {
+  // periodically print the buffer manager's counters
+  while (!stopStats) {
+    for (unsigned waited=0; waited<statsInterval && !stopStats; waited++) {
+      usleep(1000);
+    }
+    clog << "stats: " << bm->getStats() << endl;
+  }
+  return NULL;
+}
+
 static void* readWrite(void *arg) {
   // read or write random pages
   uintptr_t threadNum = reinterpret_cast<uintptr_t>(arg);
@@ -74,13 +92,75 @@ static void* readWrite(void *arg) {
   return reinterpret_cast<void*>(count);
 }
 
+static void* fixResidentPages(void *arg) {
+  // fix random pages which are all resident, i.e. every fix is a hit
+  uintptr_t threadNum = reinterpret_cast<uintptr_t>(arg);
+  uintptr_t checksum = 0;
+  for (unsigned i=0; i<fixesPerThread; i++) {
+    uint64_t page = rand_r(&threadSeed[threadNum])%pagesInRAM;
+    BufferFrame& bf = bm->fixPage(page, false);
+    checksum += reinterpret_cast<unsigned*>(bf.getData())[0];
+    bm->unfixPage(bf, false);
+  }
+  return reinterpret_cast<void*>(checksum);
+}
+
+// measures the hit throughput for different numbers of threads
+static int scaling(unsigned maxThreads) {
+  bm = new BufferManager(pagesInRAM);
+  threadSeed = new unsigned[maxThreads];
+
+  // load all pages, so that the measured fixes are all hits
+  for (unsigned i=0; i<pagesInRAM; i++) {
+    BufferFrame& bf = bm->fixPage(i, true);
+    reinterpret_cast<unsigned*>(bf.getData())[0]=i;
+    bm->unfixPage(bf, true);
+  }
+
+  pthread_attr_t pattr;
+  pthread_attr_init(&pattr);
+  cout << "threads\thits/s\thits/s per thread" << endl;
+  for (unsigned threadCount=1; threadCount<=maxThreads; threadCount*=2) {
+    for (unsigned i=0; i<threadCount; i++)
+      threadSeed[i] = i*97134;
+    vector<pthread_t> threads(threadCount);
+    auto start = chrono::steady_clock::now();
+    for (unsigned i=0; i<threadCount; i++) {
+      pthread_create(&threads[i], &pattr, fixResidentPages, reinterpret_cast<void*>(i));
+    }
+    for (unsigned i=0; i<threadCount; i++) {
+      pthread_join(threads[i], NULL);
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    double hitsPerSecond = threadCount * static_cast<double>(fixesPerThread) / elapsed.count();
+    cout << threadCount << "\t" << static_cast<uint64_t>(hitsPerSecond)
+         << "\t" << static_cast<uint64_t>(hitsPerSecond / threadCount) << endl;
+  }
+
+  delete[] threadSeed;
+  delete bm;
+  return 0;
+}
+
 int main(int argc, char** argv) {
-  if (argc==4) {
+  if (argc==5 && string(argv[1])=="scaling") {
+    pagesInRAM = atoi(argv[2]);
+    unsigned maxThreads = atoi(argv[3]);
+    fixesPerThread = atoi(argv[4]);
+    return scaling(maxThreads);
+  } else if (argc>=4 && argc<=6) {
     pagesOnDisk = atoi(argv[1]);
     pagesInRAM = atoi(argv[2]);
     threadCount = atoi(argv[3]);
+    if (argc>=5) {
+      statsInterval = atoi(argv[4]);
+    }
+    if (argc==6) {
+      numaNodes = atoi(argv[5]);
+    }
   } else {
-    cerr << "usage: " << argv[0] << " <pagesOnDisk> <pagesInRAM> <threads>" << endl;
+    cerr << "usage: " << argv[0] << " <pagesOnDisk> <pagesInRAM> <threads> [<statsIntervalMs> [<numaNodes>]]" << endl;
+    cerr << "       " << argv[0] << " scaling <pagesInRAM> <maxThreads> <fixesPerThread>" << endl;
     exit(1);
   }
   
@@ -88,7 +168,9 @@ int main(int argc, char** argv) {
   for (unsigned i=0; i<threadCount; i++)
     threadSeed[i] = i*97134;
   
-  bm = new BufferManager(pagesInRAM);
+  BufferOptions options;
+  options.numaNodes = numaNodes;
+  bm = new BufferManager(pagesInRAM, options);
   
   vector<pthread_t> threads(threadCount);
   pthread_attr_t pattr;
@@ -104,8 +186,16 @@ int main(int argc, char** argv) {
   // start scan thread
   pthread_t scanThread;
   pthread_create(&scanThread, &pattr, scan, NULL);
+
+  // start the thread printing the statistics
+  pthread_t statsThread;
+  if (statsInterval > 0) {
+    pthread_create(&statsThread, &pattr, dumpStats, NULL);
+  }
   
   // start read/write threads
+  BufferStats statsBefore = bm->getStats();
+  auto start = chrono::steady_clock::now();
   for (unsigned i=0; i<threadCount; i++) {
     pthread_create(&threads[i], &pattr, readWrite, reinterpret_cast<void*>(i));
   }
@@ -117,11 +207,23 @@ int main(int argc, char** argv) {
     pthread_join(threads[i], &ret);
     totalCount+=reinterpret_cast<uintptr_t>(ret);
   }
+  // the scan thread's fixes are included
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  BufferStats statsAfter = bm->getStats();
+  uint64_t fixes = statsAfter.hits + statsAfter.misses - statsBefore.hits - statsBefore.misses;
+  clog << "throughput: " << static_cast<uint64_t>(fixes / seconds) << " fixes/s, "
+       << statsAfter.remoteFixes - statsBefore.remoteFixes << " of " << fixes << " fixes on remote NUMA nodes" << endl;
   
   
   // wait for scan thread
   stop=true;
   pthread_join(scanThread, NULL);
+
+  // print the final statistics
+  if (statsInterval > 0) {
+    stopStats=true;
+    pthread_join(statsThread, NULL);
+  }
   
   
   // restart buffer manager
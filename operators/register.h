@@ -85,11 +85,18 @@ namespace dbImpl {
       }
 
       void setString(const std::string& s){
+        setString(s.data(), s.size());
+      }
+
+      //the memory of a string stored before is reused
+      void setString(const char* s, size_t len){
         if(type != TypeTag::Char) {
           deconstructValue();
           type = TypeTag::Char;
+          new(&value.str) std::string(s, len);
+        } else {
+          value.str.assign(s, len);
         }
-        new(&value.str) std::string(s);
       }
 
       bool operator<(Register r) const {
@@ -31,13 +31,9 @@ namespace dbImpl {
         if (slotIterator == segment.end()) {
           return false;
         } else {
-          auto tuple = deserialize(*slotIterator);
-          //we must copy the elements explicitely in order
-          //to ensure that the memory addresses of the
-          //elements do not change
-          for(size_t i = 0; i < tuple.size(); i++) {
-            registers[i] = tuple[i];
-          }
+          //deserialize directly from the page into the registers,
+          //so that the memory addresses of the registers do not change
+          deserialize(*slotIterator, registers);
           slotIterator++;
           return true;
         }
@@ -3,7 +3,9 @@
 
 #include <cstdint>
 #include <vector>
+#include <stdexcept>
 #include "slottedPages/record.h"
+#include "slottedPages/recordView.h"
 #include "operators/register.h"
 
 namespace dbImpl {
@@ -18,17 +20,34 @@ namespace dbImpl {
       const std::vector<TypeTag>& getColumnTypes() { return columnTypes; }
 
       std::vector<Register> operator()(const Record& rec) {
-        std::vector<Register> values;
-        values.reserve(columnTypes.size());
-        const uint8_t* currPos = rec.getData();
-        const uint8_t* endPos = currPos + rec.getLen();
-        for(auto& type : columnTypes) {
-          switch(type) {
+        std::vector<Register> values(columnTypes.size());
+        deserialize(rec.getData(), rec.getLen(), values);
+        return values;
+      }
+
+      /*
+       * deserializes the record directly from its page into the given registers.
+       * The registers' memory is reused, so no memory is allocated once
+       * the registers hold values of the right types.
+       */
+      void operator()(const RecordView& rec, std::vector<Register>& values) {
+        deserialize(rec.getData(), rec.getLen(), values);
+      }
+
+    private:
+      void deserialize(const uint8_t* data, size_t len, std::vector<Register>& values) {
+        if(values.size() != columnTypes.size()) {
+          throw std::invalid_argument("number of registers does not match the number of columns");
+        }
+        const uint8_t* currPos = data;
+        const uint8_t* endPos = currPos + len;
+        for(size_t i = 0; i < columnTypes.size(); i++) {
+          switch(columnTypes[i]) {
             case TypeTag::Integer:
               if(currPos + sizeof(int) > endPos) {
                 throw std::runtime_error("Read out of record's bounds");
               }
-              values.push_back(Register(*reinterpret_cast<const int*>(currPos)));
+              values[i].setInteger(*reinterpret_cast<const int*>(currPos));
               currPos += sizeof(int);
               break;
             case TypeTag::Char:
@@ -41,7 +60,7 @@ namespace dbImpl {
                 if(currPos + stringSize > endPos) {
                   throw std::runtime_error("Read out of record's bounds");
                 }
-                values.push_back(Register(std::string(reinterpret_cast<const char*>(currPos), stringSize)));
+                values[i].setString(reinterpret_cast<const char*>(currPos), stringSize);
                 currPos += stringSize;
                 break;
               }
@@ -52,7 +71,6 @@ namespace dbImpl {
         if(currPos != endPos) {
           throw std::runtime_error("Record's data is not completely parsed into tuple");
         }
-        return values;
       }
   };
 
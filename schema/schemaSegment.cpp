@@ -5,7 +5,6 @@
 #include "schema/relationSchema.h"
 #include "buffer/bufferFrame.h"
 #include "buffer/bufferManager.h"
-#include "utils/finally.h"
 
 namespace dbImpl {
 
@@ -13,15 +12,15 @@ namespace dbImpl {
     : bufferManager(bm), segmentNr(segmentNr) {}
 
   void SchemaSegment::store(const std::vector<RelationSchema>& s) {
-    BufferFrame& frame = bufferManager.fixPage(BufferManager::buildPageId(segmentNr, 0), true);
-    auto finallyUnfixFrame = finally([&frame, this] { bufferManager.unfixPage(frame, true); });
-    uint8_t* data = frame.getData();
+    PageGuard page = bufferManager.fixPageGuarded(BufferManager::buildPageId(segmentNr, 0), true);
+    page.markDirty();
+    uint8_t* data = page.getData();
 
     uint32_t offset = 0;
     //serialize all RelationSchemas
     for(const auto& relationSchema : s) {
       Record serialized = relationSchema.serializeToRecord();
-      if(offset + sizeof(uint64_t) + serialized.getLen() > BufferManager::pageSize) {
+      if(offset + sizeof(uint64_t) + serialized.getLen() > page->getSize()) {
         throw std::runtime_error("schema segment too small to hold all schema data");
       }
       uint64_t* sizePtr = reinterpret_cast<uint64_t*>(data + offset);;
@@ -31,16 +30,15 @@ namespace dbImpl {
       offset += serialized.getLen();
     }
     //write terminator
-    if(offset + sizeof(uint64_t) > BufferManager::pageSize) {
+    if(offset + sizeof(uint64_t) > page->getSize()) {
       throw std::runtime_error("schema segment too small to hold all schema data");
     }
     *reinterpret_cast<uint64_t*>(data + offset) = 0;
   }
 
   std::vector<RelationSchema> SchemaSegment::read() {
-    BufferFrame& frame = bufferManager.fixPage(BufferManager::buildPageId(segmentNr, 0), false);
-    auto finallyUnfixFrame = finally([&frame, this] { bufferManager.unfixPage(frame, false); });
-    uint8_t* data = frame.getData();
+    PageGuard page = bufferManager.fixPageGuarded(BufferManager::buildPageId(segmentNr, 0), false);
+    uint8_t* data = page.getData();
     uint32_t offset = 0;
 
     std::vector<RelationSchema> schema;
@@ -48,7 +46,7 @@ namespace dbImpl {
     uint64_t size;
     while((size = *reinterpret_cast<uint64_t*>(data + offset)) > 0) {
       offset += sizeof(uint64_t);
-      if(offset + size > BufferManager::pageSize) {
+      if(offset + size > page->getSize()) {
         throw std::runtime_error("invalid data stored in schema segment");
       }
       Record serialized(size, data + offset);
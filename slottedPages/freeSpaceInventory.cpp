@@ -0,0 +1,86 @@
+#include "slottedPages/freeSpaceInventory.h"
+#include <algorithm>
+
+namespace dbImpl {
+
+  FreeSpaceInventory::FreeSpaceInventory(uint32_t pageSize)
+    : pageSize(pageSize), pageCount(0) {
+    std::fill(searchStart, searchStart + 16, 0);
+  }
+
+  uint8_t FreeSpaceInventory::compressSpaceIndicator(uint32_t byteCount) {
+    uint8_t relativeSize = static_cast<uint64_t>(byteCount) * 255 / pageSize;
+    if(relativeSize >= 128) {
+      //linear mapping for upper half
+      return relativeSize >> 4;
+    } else {
+      //logarithmic mapping for range < 128
+      uint8_t result = 0;
+      while(relativeSize) {
+        result++;
+        relativeSize >>= 1;
+      }
+      return result;
+    }
+  }
+
+  uint64_t FreeSpaceInventory::findFreeSpace(uint32_t requiredBytes) {
+    //pages of the same class as the request might have less space than requested
+    uint8_t minIndicator = compressSpaceIndicator(requiredBytes) + 1;
+    std::lock_guard<std::mutex> lock(mutex);
+    //for a big number of required bytes only an empty page is good enough
+    if(minIndicator > 0x0f) {
+      return pageCount;
+    }
+    for(uint64_t partId = searchStart[minIndicator]; partId < pageCount; partId++) {
+      uint8_t entry = entries[partId / 2];
+      uint8_t indicator = partId % 2 ? entry & 0x0f : entry >> 4;
+      if(indicator >= minIndicator) {
+        searchStart[minIndicator] = partId;
+        return partId;
+      }
+    }
+    searchStart[minIndicator] = pageCount;
+    return pageCount;
+  }
+
+  void FreeSpaceInventory::updateFreeSpace(uint64_t partId, uint32_t freeBytes) {
+    uint8_t indicator = compressSpaceIndicator(freeBytes);
+    std::lock_guard<std::mutex> lock(mutex);
+    if(partId >= pageCount) {
+      //pages in between are unused so far, i.e. completely empty
+      entries.resize(partId / 2 + 1, 0xff);
+      if(partId > pageCount) {
+        for(uint8_t c = 0; c <= 0x0f; c++) {
+          searchStart[c] = std::min(searchStart[c], pageCount);
+        }
+      }
+      pageCount = partId + 1;
+    }
+    uint8_t& entry = entries[partId / 2];
+    if(partId % 2) {
+      entry = (entry & 0xf0) | indicator;
+    } else {
+      entry = (entry & 0x0f) | indicator << 4;
+    }
+    //the page might be the first one with enough space for the classes up to its own
+    for(uint8_t c = 0; c <= indicator; c++) {
+      searchStart[c] = std::min(searchStart[c], partId);
+    }
+  }
+
+  uint64_t FreeSpaceInventory::appendPage() {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t partId = pageCount++;
+    entries.resize(pageCount / 2 + 1, 0xff);
+    uint8_t& entry = entries[partId / 2];
+    entry &= partId % 2 ? 0xf0 : 0x0f;
+    return partId;
+  }
+
+  uint64_t FreeSpaceInventory::getPageCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pageCount;
+  }
+
+}
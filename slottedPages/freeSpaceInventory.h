@@ -0,0 +1,79 @@
+#ifndef _FREE_SPACE_INVENTORY_HPP_
+#define _FREE_SPACE_INVENTORY_HPP_
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+
+namespace dbImpl {
+
+  /*
+   * Keeps track of the free space on the pages of a segment.
+   *
+   * The free space of each page is compressed into a 4 bit fill class, so the
+   * inventory of a segment with a million pages occupies 512 KiB. The classes
+   * are conservative: a page is only returned for a request if its class
+   * guarantees that enough space is available.
+   *
+   * The inventory is kept in memory only. The pages themselves remain the
+   * authoritative source, so the inventory is always rebuilt from them and
+   * does not need to be logged.
+   */
+  class FreeSpaceInventory {
+    public:
+      // Assignment Operator: deleted
+      FreeSpaceInventory& operator=(FreeSpaceInventory& rhs) = delete;
+      // Copy Constructor: deleted
+      FreeSpaceInventory(FreeSpaceInventory& t) = delete;
+      /*
+       * actual constructor
+       * parameters:
+       *  * pageSize: the size of the managed pages
+       */
+      FreeSpaceInventory(uint32_t pageSize);
+
+      /*
+       * finds the first page which is able to store at least the given number
+       * of bytes. If no such page is known, the number of the first page behind
+       * all known pages is returned.
+       */
+      uint64_t findFreeSpace(uint32_t requiredBytes);
+
+      //updates the free space indicated for the given page
+      void updateFreeSpace(uint64_t partId, uint32_t freeBytes);
+
+      /*
+       * returns the first page behind all known pages and records it as full,
+       * so that findFreeSpace does not return it to others until its free
+       * space is updated.
+       */
+      uint64_t appendPage();
+
+      //the number of pages known to the inventory
+      uint64_t getPageCount();
+
+    protected:
+      /*
+       * compresses the number of free/required bytes given into
+       * a 4bit integer. This mapping is done using a combination
+       * of linear and logarithmic mapping of the given byte number
+       * relative to the pageSize.
+       */
+      uint8_t compressSpaceIndicator(uint32_t byteCount);
+
+      uint32_t pageSize;
+      std::mutex mutex;
+      //two 4 bit entries per byte, the even page in the upper half
+      std::vector<uint8_t> entries;
+      uint64_t pageCount;
+      /*
+       * searchStart[c] is a page number such that all pages in front of
+       * it belong to classes below c. Searches start there, so filling
+       * the segment from the front does not scan the full pages again.
+       */
+      uint64_t searchStart[16];
+  };
+
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include "slottedPages/recordView.h"
+
+#include <vector>
+#include <algorithm>
+#include "buffer/bufferFrame.h"
+#include "buffer/bufferManager.h"
+
+namespace dbImpl {
+
+  namespace {
+    //the segments of the pages the thread holds through views, once per page
+    thread_local std::vector<uint64_t> viewedSegments;
+  }
+
+  ViewedPage::ViewedPage(PageGuard&& page)
+    : PageGuard(std::move(page)), registered(false), segmentId(0) {
+    if(getFrame() != nullptr) {
+      segmentId = BufferManager::getSegmentIdForPageId(getFrame()->pageId);
+      viewedSegments.push_back(segmentId);
+      registered = true;
+    }
+  }
+
+  ViewedPage::ViewedPage(ViewedPage&& other)
+    : PageGuard(std::move(other)), registered(other.registered), segmentId(other.segmentId) {
+    other.registered = false;
+  }
+
+  ViewedPage& ViewedPage::operator=(ViewedPage&& other) {
+    if(this != &other) {
+      unregister();
+      PageGuard::operator=(std::move(other));
+      registered = other.registered;
+      segmentId = other.segmentId;
+      other.registered = false;
+    }
+    return *this;
+  }
+
+  ViewedPage::~ViewedPage() {
+    unregister();
+  }
+
+  bool ViewedPage::isViewing(uint64_t segmentId) {
+    return std::find(viewedSegments.begin(), viewedSegments.end(), segmentId) != viewedSegments.end();
+  }
+
+  void ViewedPage::unregister() {
+    if(registered) {
+      viewedSegments.erase(std::find(viewedSegments.begin(), viewedSegments.end(), segmentId));
+      registered = false;
+    }
+  }
+
+}
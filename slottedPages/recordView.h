@@ -0,0 +1,79 @@
+#ifndef _RECORD_VIEW_HPP_
+#define _RECORD_VIEW_HPP_
+
+#include <cstdint>
+#include <memory>
+
+#include "slottedPages/record.h"
+#include "buffer/pageGuard.h"
+
+namespace dbImpl {
+
+  /*
+   * A page latched in shared mode on behalf of RecordViews and SlotIterators.
+   * As long as it exists, the page is registered for the thread which created it.
+   * Modifications of the page's segment by that thread would wait for their own
+   * latch, so they check isViewing() and throw instead.
+   * It must be destroyed by the same thread.
+   */
+  class ViewedPage : public PageGuard {
+    public:
+      ViewedPage() : registered(false), segmentId(0) {}
+      // takes over the guard and registers its page, if any
+      explicit ViewedPage(PageGuard&& page);
+      ViewedPage(ViewedPage&& other);
+      ViewedPage& operator=(ViewedPage&& other);
+      ~ViewedPage();
+
+      // true if the calling thread holds a page of the segment through a view
+      static bool isViewing(uint64_t segmentId);
+
+    private:
+      void unregister();
+      bool registered;
+      uint64_t segmentId;
+  };
+
+  /*
+   * A record stored on a page, which is accessed without copying it.
+   * The view keeps the page fixed, so the data stays valid as long as the view exists.
+   * It also keeps the page's shared latch: while a view exists, its thread must
+   * not modify the segment, e.g. update or remove the viewed record, since these
+   * would wait for an exclusive latch and never get it. They throw a
+   * std::logic_error instead. Use toRecord() to keep the data.
+   */
+  class RecordView {
+    public:
+      // an empty view
+      RecordView() : data(nullptr), len(0) {}
+      // a view owning the guard of its page, as returned by lookups
+      RecordView(const uint8_t* data, unsigned len, PageGuard&& page)
+        : data(data), len(len), page(std::move(page)) {}
+      // a view sharing the guard of its page, as returned by SlotIterators
+      RecordView(const uint8_t* data, unsigned len, const std::shared_ptr<ViewedPage>& sharedPage)
+        : data(data), len(len), sharedPage(sharedPage) {}
+
+      // Get pointer to data
+      const uint8_t* getData() const {
+        return data;
+      }
+      // Get data size in bytes
+      unsigned getLen() const {
+        return len;
+      }
+      // copies the data into a Record, which stays valid after the page was unfixed
+      Record toRecord() const {
+        return Record(len, data);
+      }
+
+    private:
+      const uint8_t* data;
+      unsigned len;
+      // keep the page fixed. Only one of them is used.
+      ViewedPage page;
+      std::shared_ptr<ViewedPage> sharedPage;
+  };
+
+}
+
+#endif
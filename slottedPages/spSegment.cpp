@@ -3,51 +3,79 @@
 #include <stdexcept>
 #include <cstring>
 #include <memory>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 namespace dbImpl {
 
   //describes one slot on a page
   union SlotDescriptor {
     struct InplaceDescriptor {
-      uint8_t redirectionMarker;
-      uint8_t migratedPageMarker;
-      uint32_t offset : 24;
-      uint32_t len : 24;
+      uint64_t redirectionMarker : 8;
+      uint64_t unused : 8;
+      uint64_t offset : 24;
+      uint64_t len : 24;
 
       InplaceDescriptor(uint32_t offset, uint32_t len)
-        : redirectionMarker(0), migratedPageMarker(0),
+        : redirectionMarker(0), unused(0),
           offset(offset), len(len) {}
     } inplace;
 
-    uint64_t redirectionTid;
+    //refers to a record on another page of the same segment
+    struct RedirectionDescriptor {
+      uint8_t redirectionMarker;
+      uint8_t unused;
+      uint16_t slotNr;
+      uint32_t partId;
+
+      RedirectionDescriptor(uint32_t partId, uint16_t slotNr)
+        : redirectionMarker(0xff), unused(0), slotNr(slotNr), partId(partId) {}
+    } redirection;
 
     bool isRedirection() const {  
       return inplace.redirectionMarker == 0xff;
     }
-
-    bool isMigratedSlot() const {
-      return inplace.migratedPageMarker;
-    }
   };
 
+  static_assert(sizeof(SlotDescriptor) == 8, "slots are packed into 8 bytes");
+
+  //identifies pages of the current format. Pages of the initial format began
+  //with their dataStart, which was at most 16 KiB = 0x4000, so they can not
+  //be mistaken for pages of this format.
+  const uint16_t pageFormat = 0xf002;
+
   //describes a slotted page
   struct SPHeader {
-    uint16_t dataStart; //the offset at which data starts
-    uint16_t freeSpace; //number of bytes which would be available 
-    uint8_t nrAllocatedSlots; //the number of allocated slot descriptors
-    uint8_t firstFreeSlot; //the index of the first free slot
-
-    SPHeader()
-      : dataStart(BufferManager::pageSize),
-        freeSpace(BufferManager::pageSize - sizeof(SPHeader)),
+    uint16_t format; //pageFormat, 0 if the page was not initialized so far
+    uint16_t nrAllocatedSlots; //the number of allocated slot descriptors
+    uint32_t dataStart; //the offset at which data starts
+    uint32_t freeSpace; //number of bytes which would be available 
+    uint16_t firstFreeSlot; //the index of the first free slot
+    uint16_t unused;
+
+    SPHeader(uint32_t pageSize)
+      : format(pageFormat),
         nrAllocatedSlots(0),
-        firstFreeSlot(0) {}
+        dataStart(pageSize),
+        freeSpace(pageSize - sizeof(SPHeader)),
+        firstFreeSlot(0),
+        unused(0) {}
+
+    //pages behind the end of the segment are zeroed.
+    //(Pages of the older formats are initialized as well.)
+    bool isInitialized() const {
+      return format != 0;
+    }
   };
 
   union TupleIdentifier {
     struct {
-      uint64_t pageId : 56;
-      uint8_t slotNr : 8;
+      uint64_t pageId : 48;
+      uint64_t slotNr : 16;
     } interpreted;
     uint64_t opaque;
 
@@ -57,14 +85,219 @@ namespace dbImpl {
   };
 
 
+  //identifies pages of the format with 8 bit slot numbers, which preceded the
+  //current one. Its pages are converted by SPSegment::widenSlotNumbers().
+  const uint16_t pageFormatV1 = 0xf001;
+
+  //the header of the format with 8 bit slot numbers
+  struct SPHeaderV1 {
+    uint16_t format; //pageFormatV1
+    uint8_t nrAllocatedSlots;
+    uint8_t firstFreeSlot;
+    uint32_t dataStart;
+    uint32_t freeSpace;
+    uint32_t unused;
+
+    SPHeaderV1(uint32_t pageSize)
+      : format(pageFormatV1),
+        nrAllocatedSlots(0),
+        firstFreeSlot(0),
+        dataStart(pageSize),
+        freeSpace(pageSize - sizeof(SPHeaderV1)),
+        unused(0) {}
+
+    bool isInitialized() const {
+      return format != 0;
+    }
+  };
+
+  //both headers have the same size, so the slots start at the same offset
+  static_assert(sizeof(SPHeader) == sizeof(SPHeaderV1), "the slots must start at the same offset");
+
+  //a slot of the format with 8 bit slot numbers, which occupied 16 bytes
+  union SlotDescriptorV1 {
+    struct InplaceDescriptor {
+      uint8_t redirectionMarker;
+      uint8_t unused;
+      uint32_t offset : 24;
+      uint32_t len : 24;
+
+      InplaceDescriptor(uint32_t offset, uint32_t len)
+        : redirectionMarker(0), unused(0),
+          offset(offset), len(len) {}
+    } inplace;
+
+    //the TID is stored behind the marker, so that it does not overlap it
+    struct RedirectionDescriptor {
+      uint8_t redirectionMarker;
+      uint64_t tid;
+
+      RedirectionDescriptor(uint64_t tid)
+        : redirectionMarker(0xff), tid(tid) {}
+    } redirection;
+
+    bool isRedirection() const {
+      return inplace.redirectionMarker == 0xff;
+    }
+  };
+
+  //a TID of the initial format and of the format with 8 bit slot numbers
+  union TupleIdentifierV1 {
+    struct {
+      uint64_t pageId : 56;
+      uint8_t slotNr : 8;
+    } interpreted;
+    uint64_t opaque;
+
+    TupleIdentifierV1() {}
+    TupleIdentifierV1(uint64_t tid)
+      : opaque(tid) {}
+  };
+
+
+  //the page size of the initial format, which could not be configured
+  const uint32_t legacyPageSize = 16 * 1024;
+
+  //the header of the initial page format
+  struct LegacySPHeader {
+    uint16_t dataStart;
+    uint16_t freeSpace;
+    uint8_t nrAllocatedSlots;
+    uint8_t firstFreeSlot;
+  };
+
+  //a slot of the initial page format. Due to the alignment of redirectionTid
+  //slots occupied 16 bytes. They directly followed the 6 byte header.
+  //A redirection overwrote the first 8 bytes with the TID, so its marker was
+  //only set if the lowest byte of the target's part id happened to be 0xff.
+  //Its len was always 0, since the slot was cleared before.
+  union LegacySlotDescriptor {
+    struct {
+      uint8_t redirectionMarker;
+      uint8_t unused; //always 0
+      uint32_t offset : 24;
+      uint32_t len : 24;
+    } inplace;
+
+    uint64_t redirectionTid;
+  };
+
+
+  //stores a redirection to the record with the given TID in the slot
+  void setRedirection(SlotDescriptor& slot, uint64_t opaqueTid) {
+    TupleIdentifier tid(opaqueTid);
+    slot.redirection = SlotDescriptor::RedirectionDescriptor(
+        BufferManager::getPartIdForPageId(tid.interpreted.pageId), tid.interpreted.slotNr);
+  }
+
+  //returns the TID of the record the slot redirects to
+  uint64_t getRedirection(const SlotDescriptor& slot, uint32_t segmentId) {
+    TupleIdentifier tid;
+    tid.interpreted.pageId = BufferManager::buildPageId(segmentId, slot.redirection.partId);
+    tid.interpreted.slotNr = slot.redirection.slotNr;
+    return tid.opaque;
+  }
+
+
+  //throws if the calling thread holds a view of the segment. Modifying the
+  //segment would wait for an exclusive latch on the viewed page and never get it.
+  void checkNotViewing(uint32_t segmentId) {
+    if(ViewedPage::isViewing(segmentId)) {
+      throw std::logic_error("the segment can not be modified while the thread holds a view of it");
+    }
+  }
+
+
+  //number of pages the SlotIterator reads ahead
+  const uint32_t readAheadPages = 16;
+
+  //number of filled pages an Appender writes at once
+  const uint64_t appendBatchPages = 64;
+
+  //the number of slots on a page is limited by the type of nrAllocatedSlots.
+  //Pages below 512 KiB run out of space before they run out of slots.
+  const uint16_t maxSlots = std::numeric_limits<uint16_t>::max();
+
+  //the page ids stored in TIDs have 48 bits, 32 of which are used by the part id
+  const uint32_t maxSegmentId = std::numeric_limits<uint16_t>::max();
+
+  //the number of bytes an insert can use on the given page.
+  //Pages on which all slots are in use are full, regardless of their free space.
+  uint32_t insertableBytes(const SPHeader* header) {
+    if(header->nrAllocatedSlots < maxSlots) {
+      return header->freeSpace;
+    }
+    const SlotDescriptor* slots = reinterpret_cast<const SlotDescriptor*> (header + 1);
+    for(unsigned slotNr = header->firstFreeSlot; slotNr < header->nrAllocatedSlots; slotNr++) {
+      if(slots[slotNr].inplace.offset == 0) {
+        return header->freeSpace;
+      }
+    }
+    return 0;
+  }
+
+
+  //names a slot of the initial format in error messages
+  std::string describeSlot(uint64_t opaqueTid) {
+    TupleIdentifierV1 tid(opaqueTid);
+    return "slot " + std::to_string(static_cast<unsigned>(tid.interpreted.slotNr))
+        + " of page " + std::to_string(BufferManager::getPartIdForPageId(tid.interpreted.pageId))
+        + " of segment " + std::to_string(BufferManager::getSegmentIdForPageId(tid.interpreted.pageId));
+  }
+
+
   SPSegment::SPSegment(BufferManager& bm, uint32_t segmentId)
-    : bm(bm), segmentId(segmentId) {}
+    : bm(bm), segmentId(segmentId), inventory(bm.getPageSize(segmentId)), lastLsn(0) {
+    if(segmentId > maxSegmentId) {
+      throw std::invalid_argument("segment " + std::to_string(segmentId)
+          + " can not store slotted pages: TIDs only support segment ids up to " + std::to_string(maxSegmentId));
+    }
+    //dataStart fits into 32 bits, but the offsets of the slots have 24 bits
+    if(bm.getPageSize(segmentId) >= (1u << 24)) {
+      throw std::invalid_argument("slotted pages must be smaller than 16 MiB");
+    }
+    //the first page is converted last, so it tells whether a conversion is needed
+    PageGuard firstPage = bm.fixPageGuarded(bm.buildPageId(segmentId, 0), false);
+    SPHeader* header = reinterpret_cast<SPHeader*>(firstPage.getData());
+    uint16_t format = header->isInitialized() ? header->format : pageFormat;
+    firstPage.release();
+    if(format != pageFormat && format != pageFormatV1) {
+      //pages of the initial format start with their dataStart
+      if(format > legacyPageSize) {
+        throw std::runtime_error("segment " + std::to_string(segmentId) + " uses an unknown page format");
+      }
+      //the header of larger pages would be misread otherwise
+      if(bm.getPageSize(segmentId) != legacyPageSize) {
+        throw std::invalid_argument("segment " + std::to_string(segmentId)
+            + " uses the initial page format, which requires pages of 16 KiB");
+      }
+      convertLegacyPages();
+      format = pageFormatV1;
+    }
+    if(format == pageFormatV1) {
+      widenSlotNumbers();
+    }
+  }
+
+
+  uint64_t SPSegment::convertLegacyTid(uint64_t legacyTid) {
+    TupleIdentifierV1 legacy(legacyTid);
+    if(legacy.interpreted.pageId >> 48 != 0) {
+      throw std::invalid_argument("the page id of the TID does not fit into 48 bits");
+    }
+    TupleIdentifier tid;
+    tid.interpreted.pageId = legacy.interpreted.pageId;
+    tid.interpreted.slotNr = legacy.interpreted.slotNr;
+    return tid.opaque;
+  }
 
 
   uint64_t SPSegment::insert(const Record& r) {
+    checkNotViewing(segmentId);
+    std::call_once(inventoryLoaded, &SPSegment::loadInventory, this);
     //get a page for this record
-    BufferFrame& frame = getFrameForSize(r.getLen() + sizeof(SlotDescriptor));
-    SPHeader* header = reinterpret_cast<SPHeader*>(frame.getData());
+    PageGuard page = getPageForSize(r.getLen() + sizeof(SlotDescriptor));
+    SPHeader* header = reinterpret_cast<SPHeader*>(page.getData());
     SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
     //allocate a slot descriptor
     //try to find one which was already allocated
@@ -73,39 +306,44 @@ namespace dbImpl {
     }
     if(header->firstFreeSlot == header->nrAllocatedSlots) {
       //no free slot found? => allocate a new one.
+      slots[header->nrAllocatedSlots].inplace = SlotDescriptor::InplaceDescriptor(0,0);
       header->nrAllocatedSlots++;
+      header->freeSpace -= sizeof(SlotDescriptor);
     }
-    uint8_t slotNr = header->firstFreeSlot;
+    uint16_t slotNr = header->firstFreeSlot;
     header->firstFreeSlot++;
-    emplaceContents(frame, slotNr, r);
-    bm.unfixPage(frame, true);
-    //build and return the TID
+    uint64_t lsn = emplaceContents(*page, slotNr, r);
+    updateInventory(*page);
+    //build the TID before the frame might be reused for another page
     TupleIdentifier tid;
-    tid.interpreted.pageId = frame.pageId;
+    tid.interpreted.pageId = page->pageId;
     tid.interpreted.slotNr = slotNr;
+    page.markDirty();
+    page.release();
+    logged(lsn);
     return tid.opaque;
   }
 
 
   void SPSegment::remove(uint64_t opaqueTid) {
+    checkNotViewing(segmentId);
+    std::call_once(inventoryLoaded, &SPSegment::loadInventory, this);
     TupleIdentifier tid (opaqueTid);
     if(bm.getSegmentIdForPageId(tid.interpreted.pageId) != segmentId) {
       throw std::runtime_error("TID does not belong to the segment managed by this SPSegment instance");
     }
     //load page
-    BufferFrame& frame = bm.fixPage(tid.interpreted.pageId, true);
+    PageGuard page = bm.fixPageGuarded(tid.interpreted.pageId, true);
     //obtain pointers to header & slot descriptors
-    SPHeader* header = reinterpret_cast<SPHeader*>(frame.getData());
+    SPHeader* header = reinterpret_cast<SPHeader*>(page.getData());
     SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
     //check slot number
-    uint8_t slotNr = tid.interpreted.slotNr;
-    if(slotNr > header->nrAllocatedSlots) {
-      bm.unfixPage(frame, false);
+    uint16_t slotNr = tid.interpreted.slotNr;
+    if(slotNr >= header->nrAllocatedSlots) {
       throw std::runtime_error("slot id above number of allocated slots on page");
     }
     SlotDescriptor slot = slots[slotNr];
     if(!slot.isRedirection() && slot.inplace.offset == 0) {
-      bm.unfixPage(frame, false);
       throw std::runtime_error("trying to remove invalid slot");
     }
     //clear the slot descriptor on this page by setting offset and len to 0
@@ -117,199 +355,393 @@ namespace dbImpl {
     if(!slot.isRedirection()) {
       header->freeSpace += slot.inplace.len;
     }
-    bm.unfixPage(frame, true);
+    uint64_t lsn = logSlots(*page);
+    updateInventory(*page);
+    page.markDirty();
+    page.release();
     //if it was a redirection, also clear the redirected record
     if(slot.isRedirection()) {
-      remove(slot.redirectionTid);
+      remove(getRedirection(slot, segmentId));
     }
+    logged(lsn);
   }
 
 
   Record SPSegment::lookup(uint64_t opaqueTid) {
+    return lookupView(opaqueTid).toRecord();
+  }
+
+
+  RecordView SPSegment::lookupView(uint64_t opaqueTid) {
     TupleIdentifier tid (opaqueTid);
     if(bm.getSegmentIdForPageId(tid.interpreted.pageId) != segmentId) {
       throw std::runtime_error("TID does not belong to the segment managed by this SPSegment instance");
     }
     //load page
-    BufferFrame& frame = bm.fixPage(tid.interpreted.pageId, false);
+    PageGuard page = bm.fixPageGuarded(tid.interpreted.pageId, false);
     uint32_t slotNr = tid.interpreted.slotNr;
     //obtain pointers to header & slot descriptors
-    SPHeader* header = reinterpret_cast<SPHeader*>(frame.getData());
+    SPHeader* header = reinterpret_cast<SPHeader*>(page.getData());
     SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
     //check slot number
-    if(slotNr > header->nrAllocatedSlots) {
-      bm.unfixPage(frame, false);
+    if(slotNr >= header->nrAllocatedSlots) {
       throw std::runtime_error("slot id above number of allocated slots on page");
     }
     SlotDescriptor slot = slots[slotNr];
     //redirected?
     if(slot.isRedirection()) {
       //follow redirection
-      bm.unfixPage(frame, false);
-      return lookup(slot.redirectionTid);
+      page.release();
+      return lookupView(getRedirection(slot, segmentId));
     } else {
       //valid slot?
       if(slot.inplace.offset == 0) {
-        bm.unfixPage(frame, false);
         throw std::runtime_error("trying to lookup invalid slot");
       }
-      //load data into record
-      uint8_t* data = frame.getData() + slot.inplace.offset;
+      const uint8_t* data = page.getData() + slot.inplace.offset;
       uint32_t len = slot.inplace.len;
-      if(slot.isMigratedSlot()) {
-        data += sizeof(uint64_t);
-        len  -= sizeof(uint64_t);
+      return RecordView(data, len, std::move(page));
+    }
+  }
+
+
+  void SPSegment::lookupBatch(const std::vector<uint64_t>& tids,
+      const std::function<void(size_t index, const RecordView& record)>& consume) {
+    std::vector<std::pair<uint64_t, size_t>> requests;
+    requests.reserve(tids.size());
+    for(size_t i = 0; i < tids.size(); i++) {
+      if(bm.getSegmentIdForPageId(TupleIdentifier(tids[i]).interpreted.pageId) != segmentId) {
+        throw std::runtime_error("TID does not belong to the segment managed by this SPSegment instance");
       }
-      Record r(len, data);
-      bm.unfixPage(frame, false);
-      return r;
+      requests.emplace_back(tids[i], i);
+    }
+    lookupGrouped(requests, consume);
+  }
+
+
+  void SPSegment::lookupGrouped(std::vector<std::pair<uint64_t, size_t>>& requests,
+      const std::function<void(size_t index, const RecordView& record)>& consume) {
+    auto pageOf = [&requests](size_t i) -> uint64_t {
+      return TupleIdentifier(requests[i].first).interpreted.pageId;
+    };
+    std::sort(requests.begin(), requests.end(),
+        [](const std::pair<uint64_t, size_t>& a, const std::pair<uint64_t, size_t>& b) {
+          TupleIdentifier tidA(a.first), tidB(b.first);
+          if(tidA.interpreted.pageId != tidB.interpreted.pageId) {
+            return tidA.interpreted.pageId < tidB.interpreted.pageId;
+          }
+          return tidA.interpreted.slotNr < tidB.interpreted.slotNr;
+        });
+    std::vector<std::pair<uint64_t, size_t>> redirected;
+    //requests[ahead] is the first request whose page was not prefetched so far
+    size_t ahead = 0;
+    uint32_t pagesAhead = 0;
+    for(size_t pos = 0; pos < requests.size(); ) {
+      //keep the following pages in flight while this one is being processed.
+      //Consecutive pages are prefetched together.
+      while(ahead < requests.size() && pagesAhead < readAheadPages) {
+        uint64_t runStart = pageOf(ahead);
+        uint64_t runLength = 0;
+        while(ahead < requests.size() && pageOf(ahead) == runStart + runLength && pagesAhead < readAheadPages) {
+          while(ahead < requests.size() && pageOf(ahead) == runStart + runLength) {
+            ahead++;
+          }
+          runLength++;
+          pagesAhead++;
+        }
+        bm.prefetch(runStart, runLength);
+      }
+      uint64_t pageId = pageOf(pos);
+      ViewedPage page(bm.fixPageGuarded(pageId, false));
+      pagesAhead--;
+      SPHeader* header = reinterpret_cast<SPHeader*>(page.getData());
+      SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
+      for(; pos < requests.size() && pageOf(pos) == pageId; pos++) {
+        uint32_t slotNr = TupleIdentifier(requests[pos].first).interpreted.slotNr;
+        if(slotNr >= header->nrAllocatedSlots) {
+          throw std::runtime_error("slot id above number of allocated slots on page");
+        }
+        SlotDescriptor slot = slots[slotNr];
+        if(slot.isRedirection()) {
+          redirected.emplace_back(getRedirection(slot, segmentId), requests[pos].second);
+          continue;
+        }
+        if(slot.inplace.offset == 0) {
+          throw std::runtime_error("trying to lookup invalid slot");
+        }
+        const uint8_t* data = page.getData() + slot.inplace.offset;
+        uint32_t len = slot.inplace.len;
+        consume(requests[pos].second, RecordView(data, len, PageGuard()));
+      }
+    }
+    //the redirected records are grouped by their pages again
+    if(!redirected.empty()) {
+      lookupGrouped(redirected, consume);
     }
   }
 
 
   void SPSegment::update(uint64_t opaqueTid, const Record& r) {
+    checkNotViewing(segmentId);
+    std::call_once(inventoryLoaded, &SPSegment::loadInventory, this);
     TupleIdentifier tid(opaqueTid);
     if(bm.getSegmentIdForPageId(tid.interpreted.pageId) != segmentId) {
       throw std::runtime_error("TID does not belong to the segment managed by this SPSegment instance");
     }
-    //load page
-    BufferFrame& frame = bm.fixPage(tid.interpreted.pageId, true);
-    //obtain pointers to header & slot descriptors
-    SPHeader* header = reinterpret_cast<SPHeader*>(frame.getData());
-    SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
-    //check slot number
-    uint8_t slotNr = tid.interpreted.slotNr;
-    if(slotNr > header->nrAllocatedSlots) {
-      bm.unfixPage(frame, false);
-      throw std::runtime_error("slot id above number of allocated slots on page");
-    }
-    SlotDescriptor slot = slots[slotNr];
-    if(!slot.isRedirection() && slot.inplace.offset == 0) {
-      bm.unfixPage(frame, false);
-      throw std::runtime_error("trying to update invalid slot");
-    }
-    //free the memory if currently stored on own page
-    SlotDescriptor* slotDescriptor = &slots[slotNr];
-    if(!slotDescriptor->isRedirection()) {
-      slotDescriptor->inplace = SlotDescriptor::InplaceDescriptor(0,0);
-      header->freeSpace += slotDescriptor->inplace.len;
-    }
-    //fits onto own page?
-    if(header->freeSpace >= r.getLen()) {
-      SlotDescriptor originalDescriptor = *slotDescriptor;
-      emplaceContents(frame, slotNr, r);
-      bm.unfixPage(frame, true);
-      //if the page was migrated, free the space on the guest page
-      if(originalDescriptor.isRedirection()) {
-        remove(originalDescriptor.redirectionTid);
+    //At most two pages are latched at once, in the order of their page ids.
+    //insert() latches pages on its own, so it is called without holding a latch.
+    while(true) {
+      //load page
+      PageGuard page = bm.fixPageGuarded(tid.interpreted.pageId, true);
+      //obtain pointers to header & slot descriptors
+      SPHeader* header = reinterpret_cast<SPHeader*>(page.getData());
+      SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
+      //check slot number
+      uint16_t slotNr = tid.interpreted.slotNr;
+      if(slotNr >= header->nrAllocatedSlots) {
+        throw std::runtime_error("slot id above number of allocated slots on page");
       }
-    } else {
-      //is redirected?
-      if(slotDescriptor->isRedirection()) {
-        //load the guest page
-        TupleIdentifier guestTid(slotDescriptor->redirectionTid);
-        BufferFrame& guestFrame = bm.fixPage(guestTid.interpreted.pageId, false);
-        SPHeader* guestHeader = reinterpret_cast<SPHeader*>(guestFrame.getData());
-        SlotDescriptor* guestSlots = reinterpret_cast<SlotDescriptor*> (guestHeader + 1);
-        uint8_t guestSlotNr = guestTid.interpreted.slotNr;
-        //free the currently occupied space
-        guestSlots[guestSlotNr].inplace = SlotDescriptor::InplaceDescriptor(0,0);
-        header->freeSpace += slotDescriptor->inplace.len;
-        //fits onto guest page?
-        if(guestHeader->freeSpace >= r.getLen()) {
-          emplaceContents(guestFrame, guestSlotNr, r); //TODO: mark as migrated
-          bm.unfixPage(guestFrame, true);
-          bm.unfixPage(frame, false);
-        } else {
-          bm.unfixPage(guestFrame, true);
-          //insert somewhere else and store a redirection
-          slotDescriptor->redirectionTid = insert(r); //TODO: mark as migrated
+      SlotDescriptor slot = slots[slotNr];
+      if(!slot.isRedirection() && slot.inplace.offset == 0) {
+        throw std::runtime_error("trying to update invalid slot");
+      }
+      //fits onto own page? The space of a record stored inplace is reused.
+      uint32_t ownLen = slot.isRedirection() ? 0 : slot.inplace.len;
+      if(header->freeSpace + ownLen >= r.getLen()) {
+        header->freeSpace += ownLen;
+        slots[slotNr].inplace = SlotDescriptor::InplaceDescriptor(0,0);
+        uint64_t lsn = emplaceContents(*page, slotNr, r);
+        updateInventory(*page);
+        page.markDirty();
+        page.release();
+        //if the record was moved to another page, free the space there
+        if(slot.isRedirection()) {
+          remove(getRedirection(slot, segmentId));
         }
-      } else {
-        //not redirected so far...
-        //insert somewhere else and store a redirection
-        slotDescriptor->redirectionTid = insert(r); //TODO: mark as migrated
+        logged(lsn);
+        return;
+      }
+      if(slot.isRedirection()) {
+        TupleIdentifier guestTid(getRedirection(slot, segmentId));
+        uint64_t guestPageId = guestTid.interpreted.pageId;
+        if(guestPageId != page->pageId) {
+          //load the guest page
+          PageGuard guestPage;
+          if(guestPageId > page->pageId) {
+            guestPage = bm.fixPageGuarded(guestPageId, true);
+          } else {
+            //the guest page must be latched first, so the redirection is checked again
+            page.release();
+            guestPage = bm.fixPageGuarded(guestPageId, true);
+            page = bm.fixPageGuarded(tid.interpreted.pageId, true);
+            header = reinterpret_cast<SPHeader*>(page.getData());
+            slots = reinterpret_cast<SlotDescriptor*> (header + 1);
+            if(slotNr >= header->nrAllocatedSlots || !slots[slotNr].isRedirection()
+                || getRedirection(slots[slotNr], segmentId) != guestTid.opaque) {
+              continue;
+            }
+          }
+          SPHeader* guestHeader = reinterpret_cast<SPHeader*>(guestPage.getData());
+          SlotDescriptor* guestSlots = reinterpret_cast<SlotDescriptor*> (guestHeader + 1);
+          uint16_t guestSlotNr = guestTid.interpreted.slotNr;
+          //fits onto guest page? The redirection stays as it is.
+          if(guestHeader->freeSpace + guestSlots[guestSlotNr].inplace.len >= r.getLen()) {
+            guestHeader->freeSpace += guestSlots[guestSlotNr].inplace.len;
+            guestSlots[guestSlotNr].inplace = SlotDescriptor::InplaceDescriptor(0,0);
+            uint64_t lsn = emplaceContents(*guestPage, guestSlotNr, r);
+            updateInventory(*guestPage);
+            guestPage.markDirty();
+            guestPage.release();
+            page.release();
+            logged(lsn);
+            return;
+          }
+        }
+      }
+      //insert somewhere else and store a redirection. Until then, the slot keeps
+      //its old contents, so that its number is not reused by a concurrent insert.
+      page.release();
+      uint64_t newTid = insert(r);
+      page = bm.fixPageGuarded(tid.interpreted.pageId, true);
+      header = reinterpret_cast<SPHeader*>(page.getData());
+      slots = reinterpret_cast<SlotDescriptor*> (header + 1);
+      SlotDescriptor replaced = slots[slotNr];
+      if(!replaced.isRedirection() && replaced.inplace.offset == 0) {
+        //removed concurrently
+        page.release();
+        remove(newTid);
+        throw std::runtime_error("trying to update invalid slot");
       }
+      if(!replaced.isRedirection()) {
+        header->freeSpace += replaced.inplace.len;
+      }
+      setRedirection(slots[slotNr], newTid);
+      uint64_t lsn = logSlots(*page);
+      updateInventory(*page);
+      page.markDirty();
+      page.release();
+      //free the space on the previous guest page
+      if(replaced.isRedirection()) {
+        remove(getRedirection(replaced, segmentId));
+      }
+      logged(lsn);
+      return;
     }
   }
 
 
-  SPSegment::SlotIterator SPSegment::begin() {
-    SlotIterator iter(&bm.fixPage(bm.buildPageId(segmentId, 0), false), 0, &bm);
-    iter.normalize();
-    return iter;
+  void SPSegment::commit() {
+    bm.commit(lastLsn.load());
   }
 
 
-  SPSegment::SlotIterator SPSegment::end() {
-    return SlotIterator(nullptr, 0, &bm);
+  void SPSegment::logged(uint64_t lsn) {
+    uint64_t last = lastLsn.load();
+    while(last < lsn && !lastLsn.compare_exchange_weak(last, lsn)) {
+    }
+  }
+
+
+  uint64_t SPSegment::TidRange::getTid(uint16_t i) const {
+    TupleIdentifier tid;
+    tid.interpreted.pageId = pageId;
+    tid.interpreted.slotNr = i;
+    return tid.opaque;
+  }
+
+
+  SPSegment::Appender SPSegment::appender() {
+    std::call_once(inventoryLoaded, &SPSegment::loadInventory, this);
+    return Appender(*this);
+  }
+
+
+  SPSegment::Appender::Appender(SPSegment& segment)
+    : segment(&segment), batchStart(0), batchEnd(0), lsn(0) {}
+
+
+  SPSegment::Appender::~Appender() {
+    try {
+      if(page) {
+        completePage();
+      }
+    } catch(...) {
+      //the page is unfixed by its guard anyway
+    }
   }
 
 
-  SPSegment::SlotIterator::~SlotIterator() {
-    if(currentFrame != nullptr) {
-      bm->unfixPage(*currentFrame, false);
-      currentFrame = nullptr;
+  void SPSegment::Appender::append(const uint8_t* data, uint32_t len) {
+    if(len + sizeof(SlotDescriptor) > segment->bm.getPageSize(segment->segmentId) - sizeof(SPHeader)) {
+      throw std::runtime_error("Record larger than maximum supported record size.");
+    }
+    if(page) {
+      SPHeader* header = reinterpret_cast<SPHeader*>(page.getData());
+      if(header->freeSpace < len + sizeof(SlotDescriptor) || header->nrAllocatedSlots == maxSlots) {
+        completePage();
+      }
+    }
+    if(!page) {
+      startPage();
     }
+    //the page was filled from its end, so the free space is contiguous
+    SPHeader* header = reinterpret_cast<SPHeader*>(page.getData());
+    SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
+    header->dataStart -= len;
+    header->freeSpace -= len + sizeof(SlotDescriptor);
+    slots[header->nrAllocatedSlots].inplace = SlotDescriptor::InplaceDescriptor(header->dataStart, len);
+    header->nrAllocatedSlots++;
+    header->firstFreeSlot = header->nrAllocatedSlots;
+    std::memcpy(page.getData() + header->dataStart, data, len);
+    ranges.back().count++;
   }
 
 
-  SPSegment::SlotIterator::SlotIterator(const SlotIterator& other)
-  : bm(other.bm) {
-    //we must fix the page in order to increment the
-    //reference counter accordingly
-    if(other.currentFrame != nullptr) {
-      currentFrame = &bm->fixPage(other.currentFrame->pageId, false);
-    } else {
-      currentFrame = nullptr;
+  std::vector<SPSegment::TidRange> SPSegment::Appender::finish() {
+    if(page) {
+      completePage();
     }
-    slotNr = other.slotNr;
+    if(batchEnd > batchStart) {
+      segment->bm.writePages(segment->bm.buildPageId(segment->segmentId, batchStart), batchEnd - batchStart);
+      batchStart = batchEnd;
+    }
+    segment->bm.commit(lsn);
+    std::vector<TidRange> result;
+    result.swap(ranges);
+    return result;
   }
 
 
-  SPSegment::SlotIterator::SlotIterator(SlotIterator&& other)
-  : bm(other.bm) {
-    //steal the page from the other iterator without incrementing
-    //the reference counter
-    currentFrame = other.currentFrame;
-    other.currentFrame = nullptr;
-    slotNr = other.slotNr;
+  void SPSegment::Appender::startPage() {
+    while(true) {
+      uint64_t partId = segment->inventory.appendPage();
+      page = segment->bm.fixPageGuarded(segment->bm.buildPageId(segment->segmentId, partId), true);
+      SPHeader* header = reinterpret_cast<SPHeader*>(page.getData());
+      if(!header->isInitialized()) {
+        *header = SPHeader(page->getSize());
+        ranges.push_back(TidRange{page->pageId, 0});
+        return;
+      }
+      //a concurrent insert initialized the page before we got it
+      segment->updateInventory(*page);
+      page.release();
+    }
   }
 
 
-  SPSegment::SlotIterator& SPSegment::SlotIterator::operator=(const SlotIterator& other) {
-    bm = other.bm;
-    //we must fix the page in order to increment the
-    //reference counter accordingly
-    if(other.currentFrame != nullptr) {
-      currentFrame = &bm->fixPage(other.currentFrame->pageId, false);
-    } else {
-      currentFrame = nullptr;
+  void SPSegment::Appender::completePage() {
+    SPHeader* header = reinterpret_cast<SPHeader*>(page.getData());
+    BufferManager& bm = segment->bm;
+    lsn = std::max(lsn, segment->logSlots(*page));
+    lsn = std::max(lsn, bm.logUpdate(*page, header->dataStart, page->getSize() - header->dataStart));
+    segment->updateInventory(*page);
+    uint64_t partId = bm.getPartIdForPageId(page->pageId);
+    page.markDirty();
+    page.release();
+    //write the filled pages in batches, so that they do not have to be
+    //written one by one when they are evicted
+    if(batchEnd == batchStart) {
+      batchStart = partId;
+    }
+    batchEnd = partId + 1;
+    if(batchEnd - batchStart >= appendBatchPages) {
+      bm.writePages(bm.buildPageId(segment->segmentId, batchStart), batchEnd - batchStart);
+      batchStart = batchEnd;
     }
-    slotNr = other.slotNr;
-    return *this;
   }
 
 
-  SPSegment::SlotIterator& SPSegment::SlotIterator::operator=(SlotIterator&& other) {
-    bm = other.bm;
-    //steal the page from the other iterator without incrementing
-    //the reference counter
-    currentFrame = other.currentFrame;
-    other.currentFrame = nullptr;
-    slotNr = other.slotNr;
-    return *this;
+  SPSegment::SlotIterator SPSegment::begin() {
+    bm.prefetch(bm.buildPageId(segmentId, 0), 2 * readAheadPages);
+    SlotIterator iter(bm.fixPageGuarded(bm.buildPageId(segmentId, 0), false), 0, &bm);
+    iter.normalize();
+    return iter;
+  }
+
+
+  SPSegment::SlotIterator SPSegment::end() {
+    return SlotIterator(PageGuard(), 0, &bm);
+  }
+
+
+  SPSegment::SlotIterator::SlotIterator(PageGuard&& page, uint16_t slotNr, BufferManager* bm)
+    : bm(bm), slotNr(slotNr) {
+    if(page) {
+      currentPage = std::make_shared<ViewedPage>(std::move(page));
+    }
   }
 
 
   //comparision operators
   bool SPSegment::SlotIterator::operator==(const SlotIterator& rhs) const {
-    return bm == rhs.bm && currentFrame == rhs.currentFrame && slotNr == rhs.slotNr;
+    BufferFrame* frame = currentPage ? currentPage->getFrame() : nullptr;
+    BufferFrame* rhsFrame = rhs.currentPage ? rhs.currentPage->getFrame() : nullptr;
+    return bm == rhs.bm && frame == rhsFrame && slotNr == rhs.slotNr;
   }
 
 
   SPSegment::SlotIterator& SPSegment::SlotIterator::operator++() {
-    if(currentFrame != nullptr) {
+    if(currentPage) {
       //increment at least once
       incrementSlotNr();
       //increment until we reach the next valid slot
@@ -319,54 +751,48 @@ namespace dbImpl {
   }
 
   
-  Record SPSegment::SlotIterator::operator*() {
-    if(currentFrame == nullptr) {
-      return Record(0);
+  RecordView SPSegment::SlotIterator::operator*() {
+    if(!currentPage) {
+      return RecordView();
     } else {
       //obtain pointers to header & slot descriptors
-      SPHeader* header = reinterpret_cast<SPHeader*>(currentFrame->getData());
+      SPHeader* header = reinterpret_cast<SPHeader*>(currentPage->getData());
       SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
       SlotDescriptor slot = slots[slotNr];
       //redirected?
       if(slot.isRedirection() || slot.inplace.offset == 0) {
-        throw new std::runtime_error("slot iterator in undefined state");
+        throw std::runtime_error("slot iterator in undefined state");
       } else {
-        //load data into record
-        uint8_t* data = currentFrame->getData() + slot.inplace.offset;
+        const uint8_t* data = currentPage->getData() + slot.inplace.offset;
         uint32_t len = slot.inplace.len;
-        if(slot.isMigratedSlot()) {
-          data += sizeof(uint64_t);
-          len  -= sizeof(uint64_t);
-        }
-        Record r(len, data);
-        return r;
+        return RecordView(data, len, currentPage);
       }
     }
   }
 
   void SPSegment::SlotIterator::incrementSlotNr() {
     slotNr++;
-    SPHeader* header = reinterpret_cast<SPHeader*>(currentFrame->getData());
-    uint64_t pageId = currentFrame->pageId;
+    SPHeader* header = reinterpret_cast<SPHeader*>(currentPage->getData());
+    uint64_t pageId = (*currentPage)->pageId;
     uint32_t segmentId = bm->getSegmentIdForPageId(pageId);
     //next page?
     if(slotNr >= header->nrAllocatedSlots) {
-      bm->unfixPage(*currentFrame, false);
+      //copies of this iterator might still use the page
+      currentPage.reset();
       pageId++;
-      //passed the end of this segment
-      if(segmentId != bm->getSegmentIdForPageId(pageId)) {
-        //we reached the end
-        currentFrame = nullptr;
-        slotNr = 0;
-      } else {
+      slotNr = 0; //reset slotNr
+      //passed the end of this segment?
+      if(segmentId == bm->getSegmentIdForPageId(pageId)) {
+        //keep the next pages in flight while this one is being processed
+        if(bm->getPartIdForPageId(pageId) % readAheadPages == 0) {
+          bm->prefetch(pageId + readAheadPages, readAheadPages);
+        }
         //load next page
-        currentFrame = &bm->fixPage(pageId, false);
-        header = reinterpret_cast<SPHeader*>(currentFrame->getData());
-        slotNr = 0; //reset slotNr
-        //did we reach the last page?
-        if(header->nrAllocatedSlots == 0) {
-          bm->unfixPage(*currentFrame, false);
-          currentFrame = nullptr;
+        PageGuard page = bm->fixPageGuarded(pageId, false);
+        header = reinterpret_cast<SPHeader*>(page.getData());
+        //the last page is followed by an empty one
+        if(header->nrAllocatedSlots != 0) {
+          currentPage = std::make_shared<ViewedPage>(std::move(page));
         }
       }
     }
@@ -374,14 +800,16 @@ namespace dbImpl {
 
 
   void SPSegment::SlotIterator::normalize() {
-    if(currentFrame != nullptr) {
+    if(currentPage) {
       //increment the slotNr at least once
-      SPHeader* header = reinterpret_cast<SPHeader*>(currentFrame->getData());
+      SPHeader* header = reinterpret_cast<SPHeader*>(currentPage->getData());
       SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
-      while(currentFrame != nullptr && (slots[slotNr].isRedirection() || slots[slotNr].inplace.offset == 0)) {
+      while(currentPage && (slots[slotNr].isRedirection() || slots[slotNr].inplace.offset == 0)) {
         incrementSlotNr();
-        header = reinterpret_cast<SPHeader*>(currentFrame->getData());
-        slots = reinterpret_cast<SlotDescriptor*> (header + 1);
+        if(currentPage) {
+          header = reinterpret_cast<SPHeader*>(currentPage->getData());
+          slots = reinterpret_cast<SlotDescriptor*> (header + 1);
+        }
       }
     }
   }
@@ -391,16 +819,16 @@ namespace dbImpl {
     SPHeader* header = reinterpret_cast<SPHeader*>(frame.getData());
     SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
 
-    std::unique_ptr<uint8_t[]> copiedData(new uint8_t[BufferManager::pageSize]);
-    std::memcpy(copiedData.get(), frame.getData(), BufferManager::pageSize);
+    std::unique_ptr<uint8_t[]> copiedData(new uint8_t[frame.getSize()]);
+    std::memcpy(copiedData.get(), frame.getData(), frame.getSize());
 
     //reset dataStart to the end of the page
-    header->dataStart = BufferManager::pageSize;
+    header->dataStart = frame.getSize();
     //put all the records to the end of the page
     for(int slotNr = header->nrAllocatedSlots-1; slotNr >= 0; slotNr--) {
-      if(slots[slotNr].isRedirection()) {
-        uint32_t newOffset = header->dataStart;
+      if(!slots[slotNr].isRedirection() && slots[slotNr].inplace.offset != 0) {
         header->dataStart -= slots[slotNr].inplace.len;
+        uint32_t newOffset = header->dataStart;
         std::memcpy(frame.getData() + newOffset, copiedData.get() + slots[slotNr].inplace.offset, slots[slotNr].inplace.len);
         slots[slotNr].inplace.offset = newOffset;
       }
@@ -408,44 +836,350 @@ namespace dbImpl {
   }
 
 
-  BufferFrame& SPSegment::getFrameForSize(uint64_t size) {
-    if(size > BufferManager::pageSize - sizeof(SPHeader)) {
+  PageGuard SPSegment::getPageForSize(uint64_t size) {
+    if(size > bm.getPageSize(segmentId) - sizeof(SPHeader)) {
       throw std::runtime_error("Record larger than maximum supported record size.");
     }
-    //search through all pages of this segement
-    for(uint32_t i = 0; i < std::numeric_limits<uint32_t>::max(); i++) {
-      uint64_t pageId = bm.buildPageId(segmentId, i);
-      BufferFrame* frame = &bm.fixPage(pageId, false);
-      SPHeader* header = reinterpret_cast<SPHeader*> (frame->getData());
-      //does the data fit into this page?
-      //dataStart should never be 0. If it is 0, this means that the page was not initialized so far.
-      bool mightFit = header->dataStart == 0 || header->freeSpace >= size;
-      bm.unfixPage(*frame, false);
-      if(mightFit) {
-        //try to lock it with write permissions
-        frame = &bm.fixPage(pageId, true);
-        header = reinterpret_cast<SPHeader*> (frame->getData());
-        //recheck the conditions (might have changed while no lock was held)
-        if(header->dataStart == 0) {
-          //uninitialized page => initialize it
-          *header = SPHeader();
-          return *frame;
+    while(true) {
+      uint64_t partId = inventory.findFreeSpace(size);
+      PageGuard page = bm.fixPageGuarded(bm.buildPageId(segmentId, partId), true);
+      SPHeader* header = reinterpret_cast<SPHeader*> (page.getData());
+      //pages behind the end of the segment were not initialized so far
+      if(!header->isInitialized()) {
+        *header = SPHeader(page->getSize());
+      }
+      if(insertableBytes(header) >= size) {
+        return page;
+      }
+      //a concurrent insert used the space in the meantime
+      updateInventory(*page);
+    }
+  }
+
+
+  void SPSegment::loadInventory() {
+    bm.prefetch(bm.buildPageId(segmentId, 0), 2 * readAheadPages);
+    for(uint64_t partId = 0; ; partId++) {
+      uint64_t pageId = bm.buildPageId(segmentId, partId);
+      if(partId % readAheadPages == 0) {
+        bm.prefetch(pageId + readAheadPages, readAheadPages);
+      }
+      PageGuard page = bm.fixPageGuarded(pageId, false);
+      SPHeader* header = reinterpret_cast<SPHeader*> (page.getData());
+      //the last page is followed by an uninitialized one
+      if(!header->isInitialized()) {
+        return;
+      }
+      inventory.updateFreeSpace(partId, insertableBytes(header));
+    }
+  }
+
+
+  void SPSegment::updateInventory(BufferFrame& frame) {
+    SPHeader* header = reinterpret_cast<SPHeader*>(frame.getData());
+    inventory.updateFreeSpace(bm.getPartIdForPageId(frame.pageId), insertableBytes(header));
+  }
+
+
+  void SPSegment::convertLegacyPages() {
+    //A redirection of the initial format can only be told apart from a free
+    //slot or an empty record by the record it points to. So all slots are
+    //classified before any page is modified.
+    enum SlotKind : uint8_t {freeSlot, recordSlot, emptyRecordSlot, redirectionSlot, undecidedSlot};
+    uint32_t pageSize = bm.getPageSize(segmentId);
+    std::vector<std::vector<uint8_t>> kinds; //the kinds of the slots of every page
+    std::vector<bool> converted; //pages converted before an interrupted conversion
+    std::map<uint64_t, uint64_t> redirections; //TID of the redirection => TID of its target
+    std::map<uint64_t, LegacySlotDescriptor> undecided; //slots of length 0 without marker
+    std::vector<std::vector<std::pair<uint64_t, uint32_t>>> moves; //TIDs and lengths of records which do not fit
+    auto buildTid = [this](uint64_t partId, uint32_t slotNr) {
+      TupleIdentifierV1 tid;
+      tid.interpreted.pageId = bm.buildPageId(segmentId, partId);
+      tid.interpreted.slotNr = slotNr;
+      return tid.opaque;
+    };
+    for(uint64_t partId = 0; ; partId++) {
+      PageGuard page = bm.fixPageGuarded(bm.buildPageId(segmentId, partId), false);
+      SPHeaderV1* header = reinterpret_cast<SPHeaderV1*>(page.getData());
+      //the last page is followed by an uninitialized one
+      if(!header->isInitialized()) {
+        break;
+      }
+      kinds.emplace_back();
+      moves.emplace_back();
+      converted.push_back(header->format == pageFormatV1);
+      if(converted.back()) {
+        SlotDescriptorV1* slots = reinterpret_cast<SlotDescriptorV1*> (header + 1);
+        for(uint32_t slotNr = 0; slotNr < header->nrAllocatedSlots; slotNr++) {
+          if(slots[slotNr].isRedirection()) {
+            kinds.back().push_back(redirectionSlot);
+            redirections[buildTid(partId, slotNr)] = slots[slotNr].redirection.tid;
+          } else {
+            kinds.back().push_back(slots[slotNr].inplace.offset == 0 ? freeSlot : recordSlot);
+          }
+        }
+        continue;
+      }
+      LegacySPHeader legacyHeader;
+      std::memcpy(&legacyHeader, page.getData(), sizeof(LegacySPHeader));
+      uint32_t slotsEnd = sizeof(LegacySPHeader) + legacyHeader.nrAllocatedSlots * sizeof(LegacySlotDescriptor);
+      //the space the page needs with 8 bit slot numbers
+      uint32_t used = sizeof(SPHeaderV1) + legacyHeader.nrAllocatedSlots * sizeof(SlotDescriptorV1);
+      std::vector<std::pair<uint32_t, uint64_t>> records;
+      for(uint32_t slotNr = 0; slotNr < legacyHeader.nrAllocatedSlots; slotNr++) {
+        //the legacy slots are not aligned
+        LegacySlotDescriptor slot;
+        std::memcpy(&slot, page.getData() + sizeof(LegacySPHeader) + slotNr * sizeof(LegacySlotDescriptor), sizeof(slot));
+        uint64_t tid = buildTid(partId, slotNr);
+        if(slot.inplace.redirectionMarker == 0xff) {
+          kinds.back().push_back(redirectionSlot);
+          redirections[tid] = slot.redirectionTid;
+        } else if(slot.inplace.len != 0) {
+          uint32_t offset = slot.inplace.offset;
+          uint32_t len = slot.inplace.len;
+          if(slot.inplace.unused != 0 || offset < slotsEnd || offset + len > pageSize) {
+            throw std::runtime_error(describeSlot(tid) + " of the initial page format is invalid");
+          }
+          kinds.back().push_back(recordSlot);
+          used += len;
+          records.emplace_back(len, tid);
+        } else {
+          kinds.back().push_back(undecidedSlot);
+          undecided[tid] = slot;
         }
-        if(header->freeSpace >= size) {
-          return *frame;
+      }
+      page.release();
+      //the header grew, so the largest records are moved to other pages until the rest fits
+      std::sort(records.rbegin(), records.rend());
+      for(size_t i = 0; used > pageSize; i++) {
+        if(records[i].first > pageSize - sizeof(SPHeaderV1) - sizeof(SlotDescriptorV1)) {
+          throw std::runtime_error(describeSlot(records[i].second) + " is too large for the format with 8 bit slot numbers");
         }
+        used -= records[i].first;
+        moves.back().emplace_back(records[i].second, records[i].first);
+      }
+    }
+
+    //the kind of the slot a TID refers to
+    auto kindOf = [&](uint64_t opaqueTid) -> int {
+      TupleIdentifierV1 tid(opaqueTid);
+      uint64_t partId = bm.getPartIdForPageId(tid.interpreted.pageId);
+      if(bm.getSegmentIdForPageId(tid.interpreted.pageId) != segmentId || partId >= kinds.size()
+          || tid.interpreted.slotNr >= kinds[partId].size()) {
+        return -1;
+      }
+      return kinds[partId][tid.interpreted.slotNr];
+    };
+    //redirections point to records. Redirections of converted pages point to moved records.
+    auto isTarget = [&](uint64_t opaqueTid) {
+      int kind = kindOf(opaqueTid);
+      return kind == recordSlot
+          || (kind == redirectionSlot && converted[bm.getPartIdForPageId(TupleIdentifierV1(opaqueTid).interpreted.pageId)]);
+    };
+    //A slot of length 0 is a redirection, if it points to a record, an empty record,
+    //if it points behind the slots, or free. Slots which might be more than one are rejected.
+    for(auto& entry : undecided) {
+      const LegacySlotDescriptor& slot = entry.second;
+      TupleIdentifierV1 tid(entry.first);
+      std::vector<uint8_t>& pageKinds = kinds[bm.getPartIdForPageId(tid.interpreted.pageId)];
+      uint32_t slotsEnd = sizeof(LegacySPHeader) + pageKinds.size() * sizeof(LegacySlotDescriptor);
+      bool unmarked = slot.inplace.redirectionMarker == 0 && slot.inplace.unused == 0;
+      bool isFree = unmarked && slot.inplace.offset == 0;
+      uint32_t offset = slot.inplace.offset;
+      bool isEmptyRecord = unmarked && offset >= slotsEnd && offset <= pageSize;
+      bool isRedirection = slot.redirectionTid != entry.first && isTarget(slot.redirectionTid);
+      if(isFree + isEmptyRecord + isRedirection != 1) {
+        throw std::runtime_error(describeSlot(entry.first) + " of the initial page format can not be classified");
+      }
+      pageKinds[tid.interpreted.slotNr] = isFree ? freeSlot : isEmptyRecord ? emptyRecordSlot : redirectionSlot;
+      if(isRedirection) {
+        redirections[entry.first] = slot.redirectionTid;
       }
     }
-    throw std::runtime_error("No page within SPSegment found");
+    std::set<uint64_t> targets;
+    for(auto& redirection : redirections) {
+      if(converted[bm.getPartIdForPageId(TupleIdentifierV1(redirection.first).interpreted.pageId)]) {
+        continue;
+      }
+      if(!isTarget(redirection.second)) {
+        throw std::runtime_error(describeSlot(redirection.first) + " of the initial page format redirects to an invalid slot");
+      }
+      if(!targets.insert(redirection.second).second) {
+        throw std::runtime_error(describeSlot(redirection.first) + " of the initial page format redirects to a record which another slot redirects to");
+      }
+    }
+
+    //The pages are converted in the order 1, ..., n-1, 0. The moved records are
+    //appended to new pages behind the segment in the same order.
+    std::map<uint64_t, uint64_t> movedTo;
+    uint64_t overflowPartId = kinds.size();
+    uint32_t overflowUsed = sizeof(SPHeaderV1);
+    uint32_t overflowSlots = 0;
+    for(uint64_t i = 1; i <= kinds.size(); i++) {
+      for(auto& move : moves[i % kinds.size()]) {
+        if(overflowUsed + sizeof(SlotDescriptorV1) + move.second > pageSize
+            || overflowSlots == std::numeric_limits<uint8_t>::max()) {
+          overflowPartId++;
+          overflowUsed = sizeof(SPHeaderV1);
+          overflowSlots = 0;
+        }
+        movedTo[move.first] = buildTid(overflowPartId, overflowSlots++);
+        overflowUsed += sizeof(SlotDescriptorV1) + move.second;
+      }
+    }
+    //Redirections point to the new location of a moved record. A conversion which
+    //was interrupted after converting the target's page left a redirection behind,
+    //which is skipped. (It only occupies its slot.)
+    auto finalTarget = [&](uint64_t target) {
+      while(true) {
+        auto moved = movedTo.find(target);
+        if(moved != movedTo.end()) {
+          return moved->second;
+        }
+        if(kindOf(target) != redirectionSlot) {
+          return target;
+        }
+        target = redirections[target];
+      }
+    };
+
+    std::unique_ptr<uint8_t[]> legacyPage(new uint8_t[pageSize]);
+    uint64_t lsn = 0;
+    for(uint64_t i = 1; i <= kinds.size(); i++) {
+      uint64_t partId = i % kinds.size();
+      if(converted[partId]) {
+        continue;
+      }
+      PageGuard page = bm.fixPageGuarded(bm.buildPageId(segmentId, partId), true);
+      std::memcpy(legacyPage.get(), page.getData(), pageSize);
+      //the page is rebuilt, its records are compacted at the end of the page
+      LegacySPHeader legacyHeader;
+      std::memcpy(&legacyHeader, legacyPage.get(), sizeof(LegacySPHeader));
+      SPHeaderV1* header = reinterpret_cast<SPHeaderV1*>(page.getData());
+      *header = SPHeaderV1(pageSize);
+      header->nrAllocatedSlots = legacyHeader.nrAllocatedSlots;
+      header->firstFreeSlot = legacyHeader.firstFreeSlot;
+      header->freeSpace -= header->nrAllocatedSlots * sizeof(SlotDescriptorV1);
+      SlotDescriptorV1* slots = reinterpret_cast<SlotDescriptorV1*> (header + 1);
+      for(uint32_t slotNr = 0; slotNr < header->nrAllocatedSlots; slotNr++) {
+        LegacySlotDescriptor slot;
+        std::memcpy(&slot, legacyPage.get() + sizeof(LegacySPHeader) + slotNr * sizeof(LegacySlotDescriptor), sizeof(slot));
+        uint64_t tid = buildTid(partId, slotNr);
+        uint8_t kind = kinds[partId][slotNr];
+        if(kind == freeSlot) {
+          slots[slotNr].inplace = SlotDescriptorV1::InplaceDescriptor(0, 0);
+        } else if(kind == emptyRecordSlot) {
+          slots[slotNr].inplace = SlotDescriptorV1::InplaceDescriptor(header->dataStart, 0);
+        } else if(kind == redirectionSlot) {
+          slots[slotNr].redirection = SlotDescriptorV1::RedirectionDescriptor(finalTarget(redirections[tid]));
+        } else if(!movedTo.count(tid)) {
+          uint32_t len = slot.inplace.len;
+          header->dataStart -= len;
+          header->freeSpace -= len;
+          std::memcpy(page.getData() + header->dataStart, legacyPage.get() + slot.inplace.offset, len);
+          slots[slotNr].inplace = SlotDescriptorV1::InplaceDescriptor(header->dataStart, len);
+        } else {
+          //append the record to its new page
+          TupleIdentifierV1 movedTid(movedTo[tid]);
+          uint32_t len = slot.inplace.len;
+          PageGuard overflowPage = bm.fixPageGuarded(movedTid.interpreted.pageId, true);
+          SPHeaderV1* overflowHeader = reinterpret_cast<SPHeaderV1*>(overflowPage.getData());
+          if(!overflowHeader->isInitialized()) {
+            *overflowHeader = SPHeaderV1(pageSize);
+          }
+          SlotDescriptorV1* overflowSlots = reinterpret_cast<SlotDescriptorV1*> (overflowHeader + 1);
+          overflowHeader->dataStart -= len;
+          overflowHeader->freeSpace -= len + sizeof(SlotDescriptorV1);
+          std::memcpy(overflowPage.getData() + overflowHeader->dataStart, legacyPage.get() + slot.inplace.offset, len);
+          overflowSlots[movedTid.interpreted.slotNr].inplace = SlotDescriptorV1::InplaceDescriptor(overflowHeader->dataStart, len);
+          overflowHeader->nrAllocatedSlots = movedTid.interpreted.slotNr + 1;
+          overflowHeader->firstFreeSlot = overflowHeader->nrAllocatedSlots;
+          bm.logUpdate(*overflowPage, overflowHeader->dataStart, len);
+          lsn = std::max(lsn, bm.logUpdate(*overflowPage, 0,
+              sizeof(SPHeaderV1) + overflowHeader->nrAllocatedSlots * sizeof(SlotDescriptorV1)));
+          overflowPage.markDirty();
+          overflowPage.release();
+          //the redirection to this record now points to the new page directly
+          if(targets.count(tid)) {
+            slots[slotNr].inplace = SlotDescriptorV1::InplaceDescriptor(0, 0);
+            header->firstFreeSlot = std::min<uint8_t>(header->firstFreeSlot, slotNr);
+          } else {
+            slots[slotNr].redirection = SlotDescriptorV1::RedirectionDescriptor(movedTid.opaque);
+          }
+        }
+      }
+      //all records were moved, so the whole page is logged
+      lsn = std::max(lsn, bm.logUpdate(*page, 0, pageSize));
+      page.markDirty();
+      page.release();
+    }
+    bm.commit(lsn);
   }
 
 
-  void SPSegment::emplaceContents(BufferFrame& frame, uint8_t slotNr, const Record& r) {
+  void SPSegment::widenSlotNumbers() {
+    uint64_t lsn = 0;
+    auto widen = [this, &lsn](PageGuard& page) {
+      SPHeaderV1 narrowHeader = *reinterpret_cast<SPHeaderV1*>(page.getData());
+      //pages converted before a crash are skipped
+      if(narrowHeader.format != pageFormatV1) {
+        return;
+      }
+      SPHeader* header = reinterpret_cast<SPHeader*>(page.getData());
+      *header = SPHeader(page->getSize());
+      header->nrAllocatedSlots = narrowHeader.nrAllocatedSlots;
+      header->firstFreeSlot = narrowHeader.firstFreeSlot;
+      header->dataStart = narrowHeader.dataStart;
+      //the slots shrink, which frees space in front of the data
+      header->freeSpace = narrowHeader.freeSpace
+          + narrowHeader.nrAllocatedSlots * (sizeof(SlotDescriptorV1) - sizeof(SlotDescriptor));
+      SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
+      SlotDescriptorV1* narrowSlots = reinterpret_cast<SlotDescriptorV1*> (header + 1);
+      //a slot is read before it is overwritten and only overlaps narrow slots up to its own
+      for(uint16_t slotNr = 0; slotNr < header->nrAllocatedSlots; slotNr++) {
+        SlotDescriptorV1 slot = narrowSlots[slotNr];
+        if(slot.isRedirection()) {
+          //redirections stay within the segment
+          TupleIdentifierV1 target(slot.redirection.tid);
+          slots[slotNr].redirection = SlotDescriptor::RedirectionDescriptor(
+              bm.getPartIdForPageId(target.interpreted.pageId), target.interpreted.slotNr);
+        } else {
+          slots[slotNr].inplace = SlotDescriptor::InplaceDescriptor(slot.inplace.offset, slot.inplace.len);
+        }
+      }
+      //the log record covers the former slots as well
+      lsn = std::max(lsn, bm.logUpdate(*page, 0,
+          sizeof(SPHeaderV1) + narrowHeader.nrAllocatedSlots * sizeof(SlotDescriptorV1)));
+      page.markDirty();
+    };
+    bm.prefetch(bm.buildPageId(segmentId, 1), 2 * readAheadPages);
+    for(uint64_t partId = 1; ; partId++) {
+      uint64_t pageId = bm.buildPageId(segmentId, partId);
+      if(partId % readAheadPages == 0) {
+        bm.prefetch(pageId + readAheadPages, readAheadPages);
+      }
+      PageGuard page = bm.fixPageGuarded(pageId, true);
+      //the last page is followed by an uninitialized one
+      if(!reinterpret_cast<SPHeader*>(page.getData())->isInitialized()) {
+        break;
+      }
+      widen(page);
+    }
+    PageGuard firstPage = bm.fixPageGuarded(bm.buildPageId(segmentId, 0), true);
+    widen(firstPage);
+    firstPage.release();
+    bm.commit(lsn);
+  }
+
+
+  uint64_t SPSegment::emplaceContents(BufferFrame& frame, uint16_t slotNr, const Record& r) {
     SPHeader* header = reinterpret_cast<SPHeader*>(frame.getData());
     SlotDescriptor* slots = reinterpret_cast<SlotDescriptor*> (header + 1);
     //if neccessary: compacitify
+    bool compactified = false;
     if(header->dataStart - sizeof(SPHeader) - header->nrAllocatedSlots * sizeof(SlotDescriptor) < r.getLen()) {
       compactify(frame);
+      compactified = true;
     }
     //update header and write slotDescriptor
     header->dataStart -= r.getLen();
@@ -453,6 +1187,18 @@ namespace dbImpl {
     slots[slotNr].inplace = SlotDescriptor::InplaceDescriptor(header->dataStart, r.getLen());
     //write data
     memcpy(frame.getData() + slots[slotNr].inplace.offset, r.getData(), r.getLen());
+    if(compactified) {
+      //all records were moved, so the whole page is logged
+      return bm.logUpdate(frame, 0, frame.getSize());
+    }
+    bm.logUpdate(frame, slots[slotNr].inplace.offset, r.getLen());
+    return logSlots(frame);
+  }
+
+
+  uint64_t SPSegment::logSlots(BufferFrame& frame) {
+    SPHeader* header = reinterpret_cast<SPHeader*>(frame.getData());
+    return bm.logUpdate(frame, 0, sizeof(SPHeader) + header->nrAllocatedSlots * sizeof(SlotDescriptor));
   }
 
 }
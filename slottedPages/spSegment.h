@@ -1,10 +1,19 @@
 #ifndef _SP_SEGMENT_HPP_
 #define _SP_SEGMENT_HPP_
 
+#include <atomic>
 #include <cstdint>
 #include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <functional>
 
 #include "slottedPages/record.h"
+#include "slottedPages/recordView.h"
+#include "slottedPages/freeSpaceInventory.h"
+#include "buffer/pageGuard.h"
 
 namespace dbImpl {
 
@@ -19,6 +28,10 @@ namespace dbImpl {
    * Note, that each TID is only unique within a given segment.
    *
    * Do NOT try to use multiple SPSegment instances in order to access the same segment.
+   *
+   * A TID stores the page id in its lower 48 bits and the slot number in the upper 16 bits,
+   * so slotted segments must have ids below 65536. Segments written with 8 bit slot numbers
+   * are converted when they are opened, see convertLegacyTid().
    */
   class SPSegment {
     public:
@@ -31,10 +44,22 @@ namespace dbImpl {
        * parameters:
        *  * bm: the buffer manager to be used
        *  * segmentId: which segment should be accessed using this SPSegment instance
+       * If the segment still uses an older page format with 8 bit slot numbers,
+       * all of its pages are converted.
        */
       SPSegment(BufferManager& bm, uint32_t segmentId);
 
-      // inserts a new record and returns the tuple identifier of the stored data
+      /*
+       * converts a TID of the formats with 8 bit slot numbers, which stored the slot
+       * number in the upper 8 bits, e.g. one stored in an index built before the
+       * segment was converted. The record's page and slot number stay the same.
+       */
+      static uint64_t convertLegacyTid(uint64_t legacyTid);
+
+      /*
+       * inserts a new record and returns the tuple identifier of the stored data.
+       * Like remove and update, the insert is logged but not committed, see commit().
+       */
       uint64_t insert(const Record& r);
 
       /*
@@ -49,6 +74,27 @@ namespace dbImpl {
        */
       Record lookup(uint64_t tid);
 
+      /*
+       * like lookup, but the record is not copied. The returned
+       * view keeps the record's page fixed and latched, so this segment
+       * must not be modified by the same thread while the view exists.
+       * insert, update and remove throw a std::logic_error meanwhile.
+       */
+      RecordView lookupView(uint64_t tid);
+
+      /*
+       * looks up many records at once, e.g. the TIDs found by an index.
+       * The TIDs are grouped by page, so that every page is fixed only once,
+       * and the following pages are prefetched. Redirected records are looked
+       * up in a second pass.
+       * consume is called with the index of each TID in tids and a view of its
+       * record, in the order of the pages. The view is only valid during the call
+       * and consume must not modify this segment (modifications throw).
+       * throws if a TID is not in use.
+       */
+      void lookupBatch(const std::vector<uint64_t>& tids,
+          const std::function<void(size_t index, const RecordView& record)>& consume);
+
       /*
        * updates the contents stored under the given TID.
        * If the TID is currently not in use, it will not be created but
@@ -56,12 +102,82 @@ namespace dbImpl {
        */
       void update(uint64_t tid, const Record& r);
 
+      /*
+       * waits until the modifications made by insert, remove and update so far
+       * are durable in the buffer manager's write-ahead log. Callers commit once
+       * after several modifications, e.g. at the end of a transaction, instead of
+       * waiting for the log after every record.
+       */
+      void commit();
+
+      /*
+       * the records stored on one page by an Appender.
+       * They occupy the slots [0, count) of the page.
+       */
+      struct TidRange {
+        uint64_t pageId;
+        uint16_t count;
+        //returns the TID of the i-th record of this range
+        uint64_t getTid(uint16_t i) const;
+      };
+
+      //Appender must be predeclared
+      class Appender;
+
+      /*
+       * returns an Appender, which loads records into new pages
+       * at the end of this segment
+       */
+      Appender appender();
+
+      /*
+       * Bulk loads records. Each new page is fixed once and filled sequentially,
+       * without searching for free space and free slots for every record.
+       * Filled pages are logged as a whole and written in batches of consecutive pages.
+       *
+       * An Appender must only be used by a single thread. Other threads may
+       * still modify the segment meanwhile.
+       */
+      class Appender {
+        public:
+          Appender(Appender&& other) = default;
+          //unfixes the current page. The records are stored but not committed.
+          ~Appender();
+          //appends a record of len bytes. Its TID is returned by finish().
+          void append(const uint8_t* data, uint32_t len);
+          void append(const Record& r) {append(r.getData(), r.getLen());}
+          /*
+           * writes the filled pages and commits the records appended so far.
+           * Returns their TIDs, page by page in the order of the records.
+           */
+          std::vector<TidRange> finish();
+        private:
+          friend Appender SPSegment::appender();
+          Appender(SPSegment& segment);
+          //takes a new page at the end of the segment
+          void startPage();
+          //logs the current page, updates the inventory and unfixes the page
+          void completePage();
+          SPSegment* segment;
+          PageGuard page;
+          std::vector<TidRange> ranges;
+          //the filled pages which were not written so far: [batchStart, batchEnd)
+          uint64_t batchStart;
+          uint64_t batchEnd;
+          //the LSN of the last log record
+          uint64_t lsn;
+      };
+
       //SlotIterator must be predeclared
       class SlotIterator;
 
       /*
        * returns an iterator pointing to the first slot.
        * The returned iterator iterates over all slots stored in this segment.
+       * It keeps its current page latched in shared mode, like the views it
+       * returns, so this segment must not be modified by the same thread during
+       * the scan; modifications throw a std::logic_error. Collect the TIDs to
+       * update or remove and modify them afterwards.
        */
       SlotIterator begin();
 
@@ -71,37 +187,33 @@ namespace dbImpl {
       SlotIterator end();
 
 
-      class SlotIterator : public std::iterator<std::input_iterator_tag, Record> {
+      class SlotIterator : public std::iterator<std::input_iterator_tag, RecordView> {
         private:
           friend SlotIterator SPSegment::begin();
           friend SlotIterator SPSegment::end();
-          SlotIterator(BufferFrame* frame, uint8_t slotNr, BufferManager* bm)
-            : bm(bm), currentFrame(frame), slotNr(slotNr) {}
+          SlotIterator(PageGuard&& page, uint16_t slotNr, BufferManager* bm);
         public: 
-          //desctructor, copy constructor, move constructor and assignment operators must
-          //be provided for proper buffer managment
-          ~SlotIterator();
-          SlotIterator(const SlotIterator& other);
-          SlotIterator(SlotIterator&& other);
-          SlotIterator& operator=(const SlotIterator& other);
-          SlotIterator& operator=(SlotIterator&& other);
           //comparision operators
           bool operator==(const SlotIterator& rhs) const;
           bool operator!=(const SlotIterator& rhs) const {return !operator==(rhs);}
           //post- and pre-increment
           SlotIterator& operator++();
           SlotIterator operator++(int) {SlotIterator tmp(*this); operator++(); return tmp;}
-          //dereference
-          Record operator*();
+          //dereference. The view shares the iterator's fix and shared latch of
+          //the page, so it stays valid after the iterator moved on. As long as
+          //either exists, modifications of this segment by the same thread throw.
+          RecordView operator*();
         private:
           BufferManager* bm;
-          BufferFrame* currentFrame;
+          //the current page. Copies of an iterator share the page's fix.
+          //Empty if the iterator reached the end.
+          std::shared_ptr<ViewedPage> currentPage;
           //must be bigger than the type of the slotNr used in order
           //to handle overflows approriately
-          uint16_t slotNr;
+          uint32_t slotNr;
           /*
            * increments the slotNr and goes to the next page if necessary.
-           * Might set currentFrame to nullptr, if there is no next page.
+           * Might reset currentPage, if there is no next page.
            */
           void incrementSlotNr();
           /*
@@ -113,17 +225,54 @@ namespace dbImpl {
       };
 
     protected:
+      /**
+       * looks up the records of the given (TID, index) pairs for lookupBatch.
+       * The pairs are sorted by their pages.
+       */
+      void lookupGrouped(std::vector<std::pair<uint64_t, size_t>>& requests,
+          const std::function<void(size_t index, const RecordView& record)>& consume);
+
       /**
        * compactifies the page
        */
       void compactify(BufferFrame& frame);
 
       /**
-       * returns the first page which is able to store the required amount of data.
-       * The returned BufferFrame is already locked exclusively.
-       * If no such page exists currently, a new page will be allocated.
+       * returns a page which is able to store the required amount of data.
+       * The page is found using the free space inventory. It is already
+       * locked exclusively. If no such page exists currently, a new page
+       * will be allocated.
+       */
+      PageGuard getPageForSize(uint64_t size);
+
+      /**
+       * builds the free space inventory by reading all pages of the segment.
+       * Called once before the first modification, so that the pages are not
+       * read if the segment is only read.
+       */
+      void loadInventory();
+
+      /**
+       * stores the free space of the exclusively locked page in the inventory
        */
-      BufferFrame& getFrameForSize(uint64_t size);
+      void updateInventory(BufferFrame& frame);
+
+      /**
+       * converts the pages of a segment which were written using the initial
+       * page format into the format with 8 bit slot numbers. Records which do
+       * not fit anymore are moved to new pages at the end of the segment, their
+       * slots become redirections.
+       * Throws if a slot can not be classified unambiguously.
+       */
+      void convertLegacyPages();
+
+      /**
+       * converts the pages of a segment which were written with 8 bit slot
+       * numbers and 16 byte slots. The records stay in place. The first page
+       * is converted last, so that a conversion interrupted by a crash is
+       * resumed the next time the segment is opened.
+       */
+      void widenSlotNumbers();
 
       /**
        * Helper function used by insert and update.
@@ -131,11 +280,27 @@ namespace dbImpl {
        * If neccessary the page is compactified first.
        * The Record MUST fit onto the page. There are no additional checks for its size!
        * The BufferFrame must be locked exclusively. This function does not unlock the page.
+       * The modifications are logged, the LSN of the last log record is returned.
+       */
+      uint64_t emplaceContents(BufferFrame& frame, uint16_t slotNr, const Record& r);
+
+      /**
+       * Logs the header and the slot descriptors of the exclusively locked page
+       * in the buffer manager's write-ahead log. Returns the record's LSN.
+       */
+      uint64_t logSlots(BufferFrame& frame);
+
+      /**
+       * remembers the LSN of a modification, so that it is covered by the next commit()
        */
-      void emplaceContents(BufferFrame& frame, uint8_t slotNr, const Record& r);
+      void logged(uint64_t lsn);
 
       BufferManager& bm;
       uint32_t segmentId;
+      FreeSpaceInventory inventory;
+      std::once_flag inventoryLoaded;
+      //the highest LSN of the modifications made so far
+      std::atomic<uint64_t> lastLsn;
   };
 
 }
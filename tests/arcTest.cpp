@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "buffer/arc.h"
+
+using namespace dbImpl;
+
+TEST(ArcTest, behavesLikeAFifo) {
+  Arc<int> arc(3);
+
+  EXPECT_TRUE(arc.empty());
+
+  arc.access(1);
+  arc.access(2);
+  arc.access(3);
+
+  EXPECT_EQ(1, arc.evict());
+  EXPECT_EQ(2, arc.evict());
+  EXPECT_EQ(3, arc.evict());
+
+  EXPECT_TRUE(arc.empty());
+  EXPECT_ANY_THROW(arc.evict());
+}
+
+TEST(ArcTest, keepsFrequentPages) {
+  Arc<int> arc(3);
+
+  arc.access(1);
+  arc.access(1);
+  arc.access(2);
+  arc.access(3);
+
+  std::vector<int> victims;
+  arc.peekVictims(3, victims);
+  EXPECT_EQ(std::vector<int>({2, 3, 1}), victims);
+
+  EXPECT_EQ(2, arc.evict());
+  arc.access(4);
+  EXPECT_EQ(3, arc.evict());
+  arc.access(5);
+  EXPECT_EQ(4, arc.evict());
+}
+
+TEST(ArcTest, adaptsToGhostHits) {
+  Arc<int> arc(2);
+
+  arc.access(1);
+  arc.access(1);
+  arc.access(2);
+  // 2 is evicted from T1 and remembered as ghost
+  EXPECT_EQ(2, arc.evict());
+  // the ghost hit increases the target size of T1, so 3 stays in T1
+  // while the pages in T2 are evicted instead
+  arc.access(2);
+  arc.access(3);
+  EXPECT_EQ(1, arc.evict());
+  EXPECT_EQ(2, arc.evict());
+  EXPECT_EQ(3, arc.evict());
+}
+
+TEST(ArcTest, erasingResidentPagesKeepsTheGhosts) {
+  Arc<int> arc(4);
+
+  arc.access(1);
+  EXPECT_EQ(1, arc.evictIf([](int) { return true; }));
+  arc.eraseResident(1);
+  // the ghost hit moves 1 into T2 and grows the target size of T1 to 1
+  arc.access(1);
+  arc.access(2);
+  arc.access(3);
+
+  EXPECT_EQ(2, arc.evict());
+  EXPECT_EQ(1, arc.evict());
+  EXPECT_EQ(3, arc.evict());
+}
+
+TEST(ArcTest, skipsRejectedPages) {
+  Arc<int> arc(3);
+
+  arc.access(1);
+  arc.access(2);
+  arc.access(3);
+  EXPECT_EQ(2, arc.evictIf([](int pageId) { return pageId != 1; }));
+  EXPECT_ANY_THROW(arc.evictIf([](int) { return false; }));
+  // 1 was moved to the front of T1 instead of becoming a ghost
+  EXPECT_EQ(3, arc.evict());
+  EXPECT_EQ(1, arc.evict());
+}
@@ -7,6 +7,9 @@
 #include <sstream>
 #include <stdlib.h>
 #include <string.h>
+#include <thread>
+#include <atomic>
+#include <functional>
 
 #include "bTree/bTree.h"
 #include "buffer/bufferManager.h"
@@ -159,3 +162,39 @@ TEST(BTreeTest, CompoundKey) {
 }
 
 
+
+TEST(BTreeTest, concurrentLookupsDuringInserts) {
+  BufferManager bm(100);
+  // small nodes, so that the inserts split inner nodes as well
+  BTree<uint64_t> bTree(bm, std::less<uint64_t>(), 8);
+  uint64_t n = 2000;
+  for (uint64_t i = 0; i < n; i += 2) {
+    bTree.insert(i, i);
+  }
+  // one writer inserts the odd keys while readers look up the even ones
+  std::thread writer([&bTree, n]() {
+    for (uint64_t i = 1; i < n; i += 2) {
+      bTree.insert(i, i);
+    }
+  });
+  std::vector<std::thread> readers;
+  std::atomic<uint64_t> misses(0);
+  for (unsigned t = 0; t < 3; t++) {
+    readers.emplace_back([&bTree, &misses, n]() {
+      for (uint64_t i = 0; i < n; i += 2) {
+        boost::optional<uint64_t> tid = bTree.lookup(i);
+        if (!tid || *tid != i) {
+          misses++;
+        }
+      }
+    });
+  }
+  writer.join();
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0u, misses.load());
+  for (uint64_t i = 0; i < n; i++) {
+    ASSERT_EQ(i, bTree.lookup(i).get());
+  }
+}
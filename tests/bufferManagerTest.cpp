@@ -0,0 +1,686 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <future>
+#include <stdexcept>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "buffer/bufferManager.h"
+
+using namespace dbImpl;
+
+//writes the pageId into the first bytes of every page of the given segment
+static void writePages(uint64_t segmentId, uint64_t pageCount) {
+  BufferManager bm(10);
+  for(uint64_t i = 0; i < pageCount; i++) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(segmentId, i), true);
+    *reinterpret_cast<uint64_t*>(frame.getData()) = frame.pageId;
+    bm.unfixPage(frame, true);
+  }
+}
+
+TEST(BufferManagerTest, keepsPagesWhenEvicting) {
+  writePages(10, 50);
+  BufferManager bm(10);
+  for(uint64_t i = 0; i < 50; i++) {
+    uint64_t pageId = BufferManager::buildPageId(10, i);
+    BufferFrame& frame = bm.fixPage(pageId, false);
+    EXPECT_EQ(pageId, *reinterpret_cast<uint64_t*>(frame.getData()));
+    bm.unfixPage(frame, false);
+  }
+}
+
+TEST(BufferManagerTest, supportsAllReplacementStrategies) {
+  writePages(16, 50);
+  for(ReplacementStrategy strategy : {ReplacementStrategy::TwoQ, ReplacementStrategy::Clock,
+        ReplacementStrategy::LruK, ReplacementStrategy::Arc}) {
+    BufferOptions options;
+    options.replacementStrategy = strategy;
+    BufferManager bm(10, options);
+    for(uint64_t round = 0; round < 3; round++) {
+      for(uint64_t i = 0; i < 50; i++) {
+        uint64_t pageId = BufferManager::buildPageId(16, i % 5 == 0 ? 0 : i);
+        BufferFrame& frame = bm.fixPage(pageId, false);
+        EXPECT_EQ(pageId, *reinterpret_cast<uint64_t*>(frame.getData()));
+        bm.unfixPage(frame, false);
+      }
+    }
+  }
+}
+
+TEST(BufferManagerTest, prefetchesPages) {
+  writePages(11, 40);
+  BufferManager bm(40);
+  //the prefetch is skipped until the segment was opened by a fix
+  bm.prefetch(BufferManager::buildPageId(11, 0), 40);
+  EXPECT_EQ(0u, bm.getStats().prefetchedPages);
+  BufferFrame& first = bm.fixPage(BufferManager::buildPageId(11, 0), false);
+  bm.unfixPage(first, false);
+  bm.prefetch(BufferManager::buildPageId(11, 1), 39);
+  EXPECT_LT(0u, bm.getStats().prefetchedPages);
+  for(uint64_t i = 0; i < 40; i++) {
+    uint64_t pageId = BufferManager::buildPageId(11, i);
+    BufferFrame& frame = bm.fixPage(pageId, i % 2 == 0);
+    EXPECT_EQ(pageId, *reinterpret_cast<uint64_t*>(frame.getData()));
+    bm.unfixPage(frame, false);
+  }
+}
+
+TEST(BufferManagerTest, prefetchDoesNotCreateSegments) {
+  unlink("segments/38");
+  BufferManager bm(10);
+  bm.prefetch(BufferManager::buildPageId(38, 0), 10);
+  struct stat segmentStat;
+  EXPECT_NE(0, stat("segments/38", &segmentStat));
+  EXPECT_EQ(0u, bm.getStats().prefetchedPages);
+}
+
+TEST(BufferManagerTest, prefetchIgnoresMissingPages) {
+  writePages(12, 5);
+  BufferManager bm(10);
+  bm.prefetch(BufferManager::buildPageId(12, 3), 100);
+  BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(12, 7), false);
+  EXPECT_EQ(0u, *reinterpret_cast<uint64_t*>(frame.getData()));
+  bm.unfixPage(frame, false);
+}
+
+TEST(BufferManagerTest, writesDirtyPagesInTheBackground) {
+  BufferOptions options;
+  options.writerLowWatermark = 1.0;
+  options.writerHighWatermark = 1.0;
+  options.writerIntervalMs = 1;
+  {
+    BufferManager bm(10, options);
+    for(uint64_t i = 0; i < 10; i++) {
+      BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(13, i), true);
+      *reinterpret_cast<uint64_t*>(frame.getData()) = frame.pageId;
+      bm.unfixPage(frame, true);
+    }
+    //wait (at most 10 seconds) until the writer flushed all pages
+    for(unsigned i = 0; i < 1000 && bm.getStats().backgroundWrites < 10; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BufferStats stats = bm.getStats();
+    EXPECT_EQ(10u, stats.backgroundWrites);
+    //adjacent pages are written together
+    EXPECT_GT(10u, stats.backgroundWriteCalls);
+    //evictions find clean victims now
+    for(uint64_t i = 10; i < 20; i++) {
+      BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(13, i), false);
+      bm.unfixPage(frame, false);
+    }
+    EXPECT_EQ(10u, bm.getStats().evictions);
+    EXPECT_EQ(0u, bm.getStats().foregroundWrites);
+  }
+  BufferManager bm(10);
+  for(uint64_t i = 0; i < 10; i++) {
+    uint64_t pageId = BufferManager::buildPageId(13, i);
+    BufferFrame& frame = bm.fixPage(pageId, false);
+    EXPECT_EQ(pageId, *reinterpret_cast<uint64_t*>(frame.getData()));
+    bm.unfixPage(frame, false);
+  }
+}
+
+TEST(BufferManagerTest, countsForegroundWrites) {
+  BufferOptions options;
+  options.backgroundWriter = false;
+  BufferManager bm(10, options);
+  for(uint64_t i = 0; i < 20; i++) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(14, i), true);
+    bm.unfixPage(frame, true);
+  }
+  BufferStats stats = bm.getStats();
+  EXPECT_EQ(10u, stats.evictions);
+  EXPECT_EQ(10u, stats.foregroundWrites);
+  EXPECT_EQ(0u, stats.backgroundWrites);
+}
+
+TEST(BufferManagerTest, remembersDirtyPagesAfterEvictingThem) {
+  unlink("segments/33");
+  BufferOptions options;
+  options.backgroundWriter = false;
+  // the FIFO queue of the 2Q holds 1 page, its ghost queue 2 pages
+  BufferManager bm(4, options);
+  BufferFrame& dirty = bm.fixPage(BufferManager::buildPageId(33, 0), true);
+  bm.unfixPage(dirty, true);
+  // evicts and writes page 0 in the foreground, then page 1
+  for(uint64_t i : {1, 2, 3, 4, 0}) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(33, i), false);
+    bm.unfixPage(frame, false);
+  }
+  EXPECT_EQ(1u, bm.getStats().foregroundWrites);
+  // page 0 was found in the ghost queue and promoted, so it survives a scan
+  for(uint64_t i = 5; i < 11; i++) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(33, i), false);
+    bm.unfixPage(frame, false);
+  }
+  BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(33, 0), false);
+  bm.unfixPage(frame, false);
+  EXPECT_EQ(1u, bm.getStats().hits);
+}
+
+TEST(BufferManagerTest, growsSegmentsOnlyUpToTheLastWrittenPage) {
+  {
+    BufferManager bm(10);
+    for(uint64_t partId : {0u, 1000u}) {
+      BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(15, partId), true);
+      *reinterpret_cast<uint64_t*>(frame.getData()) = frame.pageId;
+      bm.unfixPage(frame, true);
+    }
+  }
+  //disk space is preallocated in extents, but the file size is the high-water mark
+  struct stat segmentStat;
+  ASSERT_EQ(0, stat("segments/15", &segmentStat));
+  EXPECT_EQ(1001u * BufferOptions().pageSize, static_cast<uint64_t>(segmentStat.st_size));
+
+  BufferManager bm(10);
+  for(uint64_t partId : {0u, 500u, 1000u, 2000u}) {
+    uint64_t pageId = BufferManager::buildPageId(15, partId);
+    BufferFrame& frame = bm.fixPage(pageId, false);
+    uint64_t expected = (partId == 0 || partId == 1000) ? pageId : 0;
+    EXPECT_EQ(expected, *reinterpret_cast<uint64_t*>(frame.getData()));
+    bm.unfixPage(frame, false);
+  }
+}
+
+TEST(BufferManagerTest, loadsPagesInSharedMode) {
+  writePages(17, 1);
+  BufferManager bm(10);
+  uint64_t pageId = BufferManager::buildPageId(17, 0);
+  //the page is loaded from disk, but we only requested a shared latch
+  BufferFrame& frame = bm.fixPage(pageId, false);
+  //so another reader must not be blocked
+  auto reader = std::async(std::launch::async, [&bm, pageId]() {
+    BufferFrame& otherFrame = bm.fixPage(pageId, false);
+    uint64_t value = *reinterpret_cast<uint64_t*>(otherFrame.getData());
+    bm.unfixPage(otherFrame, false);
+    return value;
+  });
+  ASSERT_EQ(std::future_status::ready, reader.wait_for(std::chrono::seconds(10)));
+  EXPECT_EQ(pageId, reader.get());
+  bm.unfixPage(frame, false);
+}
+
+TEST(BufferManagerTest, countsHitsAndMisses) {
+  BufferOptions options;
+  options.backgroundWriter = false;
+  BufferManager bm(5, options);
+  for(uint64_t round = 0; round < 2; round++) {
+    for(uint64_t i = 0; i < 5; i++) {
+      BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(18, i), round == 0);
+      bm.unfixPage(frame, round == 0);
+    }
+  }
+  BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(18, 5), false);
+  bm.unfixPage(frame, false);
+
+  BufferStats stats = bm.getStats();
+  EXPECT_EQ(5u, stats.hits);
+  EXPECT_EQ(6u, stats.misses);
+  EXPECT_EQ(1u, stats.evictions);
+  EXPECT_EQ(1u, stats.foregroundWrites);
+  EXPECT_EQ(0u, stats.evictionRetries);
+}
+
+TEST(BufferManagerTest, skipsPinnedFramesCheaply) {
+  BufferOptions options;
+  options.backgroundWriter = false;
+  BufferManager bm(50, options);
+  std::vector<BufferFrame*> pinned;
+  for(uint64_t i = 0; i < 45; i++) {
+    pinned.push_back(&bm.fixPage(BufferManager::buildPageId(30, i), false));
+  }
+  // while the pinned frames stay pinned, the unpinned ones are used over and over again
+  for(uint64_t i = 50; i < 1050; i++) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(30, i), false);
+    bm.unfixPage(frame, false);
+  }
+  // A pinned page is passed about once every 5 evictions,
+  // so every eviction checks about 9 of them instead of all 45.
+  BufferStats stats = bm.getStats();
+  EXPECT_GE(stats.evictions, 995u);
+  EXPECT_LE(stats.evictionRetries, 10 * stats.evictions);
+
+  // the same under concurrent misses
+  std::vector<std::future<void>> threads;
+  for(uint64_t t = 0; t < 4; t++) {
+    threads.push_back(std::async(std::launch::async, [&bm, t] {
+      for(uint64_t i = 0; i < 250; i++) {
+        BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(30, 1050 + t * 250 + i), false);
+        bm.unfixPage(frame, false);
+      }
+    }));
+  }
+  for(auto& thread : threads) {
+    thread.get();
+  }
+  for(BufferFrame* frame : pinned) {
+    EXPECT_EQ(0u, *reinterpret_cast<uint64_t*>(frame->getData()));
+    bm.unfixPage(*frame, false);
+  }
+}
+
+TEST(BufferManagerTest, supportsPageClasses) {
+  BufferOptions options;
+  options.pageSize = 4 * 1024;
+  options.pageClasses.push_back(PageClassOptions{64 * 1024, 2, {19}});
+  {
+    BufferManager bm(2, options);
+    EXPECT_EQ(4u * 1024, bm.getPageSize(20));
+    EXPECT_EQ(64u * 1024, bm.getPageSize(19));
+    //both page classes evict their own pages only
+    for(uint64_t i = 0; i < 5; i++) {
+      for(uint64_t segmentId : {19u, 20u}) {
+        BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(segmentId, i), true);
+        EXPECT_EQ(bm.getPageSize(segmentId), frame.getSize());
+        //mark the first and the last word of the page
+        uint64_t* words = reinterpret_cast<uint64_t*>(frame.getData());
+        words[0] = frame.pageId;
+        words[frame.getSize() / sizeof(uint64_t) - 1] = frame.pageId;
+        bm.unfixPage(frame, true);
+      }
+    }
+  }
+  struct stat segmentStat;
+  ASSERT_EQ(0, stat("segments/19", &segmentStat));
+  EXPECT_EQ(5u * 64 * 1024, static_cast<uint64_t>(segmentStat.st_size));
+  ASSERT_EQ(0, stat("segments/20", &segmentStat));
+  EXPECT_EQ(5u * 4 * 1024, static_cast<uint64_t>(segmentStat.st_size));
+
+  BufferManager bm(2, options);
+  for(uint64_t i = 0; i < 5; i++) {
+    for(uint64_t segmentId : {19u, 20u}) {
+      uint64_t pageId = BufferManager::buildPageId(segmentId, i);
+      BufferFrame& frame = bm.fixPage(pageId, false);
+      uint64_t* words = reinterpret_cast<uint64_t*>(frame.getData());
+      EXPECT_EQ(pageId, words[0]);
+      EXPECT_EQ(pageId, words[frame.getSize() / sizeof(uint64_t) - 1]);
+      bm.unfixPage(frame, false);
+    }
+  }
+}
+
+TEST(BufferManagerTest, rejectsInvalidPageSizes) {
+  BufferOptions options;
+  options.pageSize = 1000;
+  EXPECT_THROW(BufferManager(10, options), std::invalid_argument);
+}
+
+TEST(BufferManagerTest, mapsReadOnlySegments) {
+  writePages(21, 10);
+  BufferOptions options;
+  options.mappedSegments[21] = AccessPattern::Random;
+  BufferManager bm(2, options);
+  //prefetch skips segments which were not opened by a fix so far
+  BufferFrame& first = bm.fixPage(BufferManager::buildPageId(21, 0), false);
+  bm.unfixPage(first, false);
+  bm.prefetch(BufferManager::buildPageId(21, 0), 10);
+  for(uint64_t round = 0; round < 2; round++) {
+    for(uint64_t i = 0; i < 10; i++) {
+      uint64_t pageId = BufferManager::buildPageId(21, i);
+      BufferFrame& frame = bm.fixPage(pageId, false);
+      EXPECT_EQ(pageId, *reinterpret_cast<uint64_t*>(frame.getData()));
+      bm.unfixPage(frame, false);
+    }
+  }
+  //frames which were used for mapped pages can be used for other pages again
+  writePages(22, 1);
+  BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(22, 0), true);
+  EXPECT_EQ(BufferManager::buildPageId(22, 0), *reinterpret_cast<uint64_t*>(frame.getData()));
+  bm.unfixPage(frame, false);
+
+  EXPECT_THROW(bm.fixPage(BufferManager::buildPageId(21, 0), true), std::logic_error);
+  EXPECT_THROW(bm.fixPage(BufferManager::buildPageId(21, 10), false), std::out_of_range);
+}
+
+TEST(BufferManagerTest, supportsDirectIO) {
+  BufferOptions options;
+  options.directIO = true;
+  {
+    BufferManager bm(2, options);
+    for(uint64_t i = 0; i < 10; i++) {
+      BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(23, i), true);
+      *reinterpret_cast<uint64_t*>(frame.getData()) = frame.pageId;
+      bm.unfixPage(frame, true);
+    }
+  }
+  BufferManager bm(4, options);
+  BufferFrame& first = bm.fixPage(BufferManager::buildPageId(23, 0), false);
+  bm.unfixPage(first, false);
+  bm.prefetch(BufferManager::buildPageId(23, 1), 4);
+  for(uint64_t i = 0; i < 10; i++) {
+    uint64_t pageId = BufferManager::buildPageId(23, i);
+    BufferFrame& frame = bm.fixPage(pageId, false);
+    EXPECT_EQ(pageId, *reinterpret_cast<uint64_t*>(frame.getData()));
+    bm.unfixPage(frame, false);
+  }
+}
+
+TEST(BufferManagerTest, recoversFromTheWriteAheadLog) {
+  const char* logFile = "bufferManagerTest.log";
+  unlink(logFile);
+  writePages(24, 4);
+  {
+    //a crash after these changes were committed, but before the pages were written
+    WriteAheadLog log(logFile);
+    uint64_t value = 42;
+    log.append(BufferManager::buildPageId(24, 1), 8, reinterpret_cast<uint8_t*>(&value), sizeof(value));
+    log.flush(log.append(BufferManager::buildPageId(24, 5), 0, reinterpret_cast<uint8_t*>(&value), sizeof(value)));
+  }
+  BufferOptions options;
+  options.logFile = logFile;
+  {
+    BufferManager bm(2, options);
+    for(uint64_t i : {1u, 5u}) {
+      BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(24, i), false);
+      EXPECT_EQ(42u, reinterpret_cast<uint64_t*>(frame.getData())[i == 1 ? 1 : 0]);
+      bm.unfixPage(frame, false);
+    }
+    //changes logged using the BufferManager survive as well
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(24, 2), true);
+    reinterpret_cast<uint64_t*>(frame.getData())[1] = 43;
+    uint64_t lsn = bm.logUpdate(frame, 8, sizeof(uint64_t));
+    bm.unfixPage(frame, true);
+    bm.commit(lsn);
+    bm.checkpoint();
+    EXPECT_EQ(1u, bm.getStats().commits);
+  }
+  //the recovered pages were written, so the log is empty
+  {
+    WriteAheadLog log(logFile);
+    unsigned records = 0;
+    log.replay([&records](uint64_t, uint32_t, const uint8_t*, uint32_t) { records++; });
+    EXPECT_EQ(0u, records);
+  }
+  BufferManager bm(2);
+  BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(24, 1), false);
+  EXPECT_EQ(BufferManager::buildPageId(24, 1), reinterpret_cast<uint64_t*>(frame.getData())[0]);
+  EXPECT_EQ(42u, reinterpret_cast<uint64_t*>(frame.getData())[1]);
+  bm.unfixPage(frame, false);
+  BufferFrame& otherFrame = bm.fixPage(BufferManager::buildPageId(24, 2), false);
+  EXPECT_EQ(43u, reinterpret_cast<uint64_t*>(otherFrame.getData())[1]);
+  bm.unfixPage(otherFrame, false);
+}
+
+TEST(BufferManagerTest, checkpointsWhenTheLogExceedsItsSize) {
+  const char* logFile = "bufferManagerTest.log";
+  unlink(logFile);
+  unlink("segments/36");
+  BufferOptions options;
+  options.logFile = logFile;
+  options.checkpointLogSize = 128 * 1024;
+  options.writerIntervalMs = 1;
+  BufferManager bm(10, options);
+  //recovery ends with a checkpoint
+  uint64_t checkpoints = bm.getStats().checkpoints;
+  //the first update of each page behind a checkpoint logs the whole page,
+  //so the log exceeds its size after a few updates
+  for(unsigned i = 0; i < 1000 && bm.getStats().checkpoints == checkpoints; i++) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(36, i % 10), true);
+    reinterpret_cast<uint64_t*>(frame.getData())[1] = i;
+    uint64_t lsn = bm.logUpdate(frame, 8, sizeof(uint64_t));
+    bm.unfixPage(frame, true);
+    bm.commit(lsn);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_LT(checkpoints, bm.getStats().checkpoints);
+}
+
+TEST(BufferManagerTest, warmsUpUsingASnapshot) {
+  const char* warmUpFile = "bufferManagerTest.warmup";
+  unlink(warmUpFile);
+  writePages(25, 20);
+  BufferOptions options;
+  options.warmUpFile = warmUpFile;
+  {
+    BufferManager bm(8, options);
+    for(uint64_t i : {0, 1, 2, 3, 4, 5, 6, 7, 8, 0}) {
+      BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(25, i), false);
+      bm.unfixPage(frame, false);
+    }
+  }
+  BufferManager bm(8, options);
+  EXPECT_EQ(8u, bm.getStats().prefetchedPages);
+  for(uint64_t i : {0, 2, 3, 4, 5, 6, 7, 8}) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(25, i), false);
+    EXPECT_EQ(BufferManager::buildPageId(25, i), reinterpret_cast<uint64_t*>(frame.getData())[0]);
+    bm.unfixPage(frame, false);
+  }
+  EXPECT_EQ(0u, bm.getStats().misses);
+  // page 0 was used frequently, so it survives a scan
+  for(uint64_t i = 10; i < 17; i++) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(25, i), false);
+    bm.unfixPage(frame, false);
+  }
+  BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(25, 0), false);
+  bm.unfixPage(frame, false);
+  BufferStats stats = bm.getStats();
+  EXPECT_EQ(9u, stats.hits);
+  EXPECT_EQ(7u, stats.misses);
+}
+
+TEST(BufferManagerTest, splitsTheFramesBetweenNumaNodes) {
+  writePages(26, 8);
+  BufferOptions options;
+  // more nodes than the machine might have. The placement is only a hint.
+  options.numaNodes = 2;
+  BufferManager bm(4, options);
+  // the frames of the thread's node are used first, then the other node's
+  for(uint64_t i = 0; i < 4; i++) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(26, i), false);
+    EXPECT_EQ(BufferManager::buildPageId(26, i), reinterpret_cast<uint64_t*>(frame.getData())[0]);
+    bm.unfixPage(frame, false);
+  }
+  EXPECT_EQ(2u, bm.getStats().remoteFixes);
+  for(uint64_t i = 4; i < 8; i++) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(26, i), false);
+    EXPECT_EQ(BufferManager::buildPageId(26, i), reinterpret_cast<uint64_t*>(frame.getData())[0]);
+    bm.unfixPage(frame, false);
+  }
+}
+
+TEST(BufferManagerTest, compressesSegments) {
+  unlink("segments/27");
+  unlink("segments/27.map");
+  BufferOptions options;
+  options.compressedSegments.insert(27);
+  unsigned seed = 27;
+  // even pages compress well, odd pages contain random data.
+  // Pages are written twice, so that they change their size.
+  auto fill = [&seed](BufferFrame& frame, bool compressible) {
+    uint64_t* words = reinterpret_cast<uint64_t*>(frame.getData());
+    for (uint64_t i = 1; i < frame.getSize() / sizeof(uint64_t); i++) {
+      words[i] = compressible ? i % 16 : (static_cast<uint64_t>(rand_r(&seed)) << 32) | rand_r(&seed);
+    }
+    words[0] = frame.pageId;
+  };
+  std::vector<uint64_t> checksums(40);
+  for (unsigned round = 0; round < 2; round++) {
+    {
+      BufferManager bm(8, options);
+      for (uint64_t i = 0; i < 40; i++) {
+        BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(27, i), true);
+        fill(frame, (i + round) % 2 == 0);
+        checksums[i] = 0;
+        for (uint32_t w = 0; w < frame.getSize() / sizeof(uint64_t); w++) {
+          checksums[i] += reinterpret_cast<uint64_t*>(frame.getData())[w];
+        }
+        bm.unfixPage(frame, true);
+      }
+    }
+    if (round == 0) {
+      // the compressible pages take a single sector each
+      struct stat segmentStat;
+      ASSERT_EQ(0, stat("segments/27", &segmentStat));
+      EXPECT_EQ(20 * BufferOptions().pageSize + 20 * 4096u, static_cast<uint64_t>(segmentStat.st_size));
+    }
+  }
+  BufferManager bm(8, options);
+  bm.prefetch(BufferManager::buildPageId(27, 0), 4);
+  for (uint64_t i = 0; i < 41; i++) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(27, i), false);
+    uint64_t checksum = 0;
+    for (uint32_t w = 0; w < frame.getSize() / sizeof(uint64_t); w++) {
+      checksum += reinterpret_cast<uint64_t*>(frame.getData())[w];
+    }
+    // pages which were never written are zeroed
+    EXPECT_EQ(i < 40 ? checksums[i] : 0, checksum);
+    bm.unfixPage(frame, false);
+  }
+}
+
+TEST(BufferManagerTest, reusesExtentsOfMovedPagesAfterACheckpoint) {
+  unlink("segments/34");
+  unlink("segments/34.map");
+  BufferOptions options;
+  options.compressedSegments.insert(34);
+  options.backgroundWriter = false;
+  unsigned seed = 34;
+  // every fix evicts the previously fixed page
+  BufferManager bm(1, options);
+  auto write = [&](uint64_t page, bool compressible) {
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(34, page), true);
+    uint64_t* words = reinterpret_cast<uint64_t*>(frame.getData());
+    for (uint64_t i = 0; i < frame.getSize() / sizeof(uint64_t); i++) {
+      words[i] = compressible ? i % 16 : (static_cast<uint64_t>(rand_r(&seed)) << 32) | rand_r(&seed);
+    }
+    bm.unfixPage(frame, true);
+  };
+  auto offset = [](uint64_t page) {
+    int mapFd = open("segments/34.map", O_RDONLY);
+    uint64_t offset = 0;
+    // the offset is the first member of a page map entry of 16 bytes
+    EXPECT_EQ(8, pread(mapFd, &offset, sizeof(offset), page * 16));
+    close(mapFd);
+    return offset;
+  };
+  write(0, true);
+  write(1, true);
+  // page 0 outgrows its sector at offset 0 and is moved behind page 1
+  write(0, false);
+  write(2, true);
+  write(3, true);
+  EXPECT_EQ(2 * 4096u, offset(0));
+  EXPECT_EQ(2 * 4096u + BufferOptions().pageSize, offset(2));
+  bm.checkpoint();
+  write(4, true);
+  write(5, true);
+  EXPECT_EQ(0u, offset(4));
+}
+
+TEST(BufferManagerTest, detectsCorruptPages) {
+  BufferOptions options;
+  options.pageChecksums = PageChecksums::Always;
+  {
+    BufferManager bm(10, options);
+    EXPECT_EQ(BufferOptions().pageSize - 8, bm.getPageSize(28));
+    for(uint64_t i = 0; i < 4; i++) {
+      BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(28, i), true);
+      EXPECT_EQ(bm.getPageSize(28), frame.getSize());
+      std::memset(frame.getData(), i + 1, frame.getSize());
+      bm.unfixPage(frame, true);
+    }
+  }
+  // a torn write of page 2
+  int segmentFd = open("segments/28", O_WRONLY);
+  ASSERT_NE(-1, segmentFd);
+  std::vector<uint8_t> garbage(512, 0xff);
+  ASSERT_EQ(512, pwrite(segmentFd, garbage.data(), garbage.size(), 2 * BufferOptions().pageSize + 4096));
+  close(segmentFd);
+
+  BufferManager bm(2, options);
+  EXPECT_THROW(bm.fixPage(BufferManager::buildPageId(28, 2), false), CorruptPageError);
+  BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(28, 3), false);
+  EXPECT_EQ(4, frame.getData()[0]);
+  bm.unfixPage(frame, false);
+  // pages which were loaded asynchronously are verified as well
+  bm.prefetch(BufferManager::buildPageId(28, 2), 1);
+  EXPECT_THROW(bm.fixPage(BufferManager::buildPageId(28, 2), false), CorruptPageError);
+
+  // without checksums, the trailer is part of the page
+  BufferManager unchecked(2);
+  BufferFrame& corrupt = unchecked.fixPage(BufferManager::buildPageId(28, 2), false);
+  EXPECT_EQ(0xff, corrupt.getData()[4096]);
+  unchecked.unfixPage(corrupt, false);
+}
+
+TEST(BufferManagerTest, repairsTornPagesUsingTheWriteAheadLog) {
+  const char* logFile = "bufferManagerTest.log";
+  unlink(logFile);
+  unlink("segments/35");
+  BufferOptions options;
+  options.pageChecksums = PageChecksums::Always;
+  uint32_t pageSize = BufferOptions().pageSize - 8;
+  {
+    BufferManager bm(10, options);
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(35, 0), true);
+    std::memset(frame.getData(), 1, frame.getSize());
+    bm.unfixPage(frame, true);
+  }
+  {
+    // the page was logged as a whole, then a crash tore its write
+    WriteAheadLog log(logFile);
+    std::vector<uint8_t> image(pageSize, 2);
+    log.flush(log.append(BufferManager::buildPageId(35, 0), 0, image.data(), image.size()));
+  }
+  int segmentFd = open("segments/35", O_WRONLY);
+  ASSERT_NE(-1, segmentFd);
+  std::vector<uint8_t> garbage(512, 0xff);
+  ASSERT_EQ(512, pwrite(segmentFd, garbage.data(), garbage.size(), 4096));
+  close(segmentFd);
+
+  options.logFile = logFile;
+  {
+    BufferManager bm(10, options);
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(35, 0), false);
+    EXPECT_EQ(2, frame.getData()[0]);
+    EXPECT_EQ(2, frame.getData()[4096]);
+    bm.unfixPage(frame, false);
+  }
+  // the repaired page was written with a valid checksum
+  options.logFile.clear();
+  BufferManager bm(10, options);
+  BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(35, 0), false);
+  EXPECT_EQ(2, frame.getData()[4096]);
+  bm.unfixPage(frame, false);
+}
+
+TEST(BufferManagerTest, trustsReloadedPagesAfterTheFirstLoad) {
+  unlink("segments/29");
+  // page 1 is written without a checksum, page 0 with one
+  {
+    BufferManager bm(2);
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(29, 1), true);
+    frame.getData()[0] = 1;
+    bm.unfixPage(frame, true);
+  }
+  BufferOptions options;
+  options.pageChecksums = PageChecksums::FirstLoad;
+  {
+    BufferManager bm(2, options);
+    // page 0 was never written, so it is zeroed
+    BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(29, 0), true);
+    frame.getData()[0] = 1;
+    bm.unfixPage(frame, true);
+  }
+  BufferManager bm(1, options);
+  BufferFrame& frame = bm.fixPage(BufferManager::buildPageId(29, 0), false);
+  bm.unfixPage(frame, false);
+  // corrupt the verified page behind the BufferManager's back
+  int segmentFd = open("segments/29", O_WRONLY);
+  ASSERT_NE(-1, segmentFd);
+  uint64_t garbage = 42;
+  ASSERT_EQ(8, pwrite(segmentFd, &garbage, sizeof(garbage), 0));
+  close(segmentFd);
+  // evicts page 0. Page 1 has no checksum, so its first load fails.
+  EXPECT_THROW(bm.fixPage(BufferManager::buildPageId(29, 1), false), CorruptPageError);
+  // the reload is not verified again
+  BufferFrame& reloaded = bm.fixPage(BufferManager::buildPageId(29, 0), false);
+  EXPECT_EQ(42u, reinterpret_cast<uint64_t*>(reloaded.getData())[0]);
+  bm.unfixPage(reloaded, false);
+}
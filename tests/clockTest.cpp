@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "buffer/clock.h"
+
+using namespace dbImpl;
+
+TEST(ClockTest, behavesLikeAFifo) {
+  Clock<int> clock(3);
+
+  EXPECT_TRUE(clock.empty());
+
+  clock.access(1);
+  clock.access(2);
+  clock.access(3);
+
+  EXPECT_EQ(1, clock.evict());
+  EXPECT_EQ(2, clock.evict());
+  EXPECT_EQ(3, clock.evict());
+
+  EXPECT_TRUE(clock.empty());
+  EXPECT_ANY_THROW(clock.evict());
+}
+
+TEST(ClockTest, givesReferencedPagesASecondChance) {
+  Clock<int> clock(4);
+
+  clock.access(1);
+  clock.access(2);
+  clock.access(3);
+  clock.access(1);
+
+  std::vector<int> victims;
+  clock.peekVictims(3, victims);
+  EXPECT_EQ(std::vector<int>({2, 3, 1}), victims);
+
+  EXPECT_EQ(2, clock.evict());
+  clock.access(4);
+  EXPECT_EQ(3, clock.evict());
+  EXPECT_EQ(1, clock.evict());
+  EXPECT_EQ(4, clock.evict());
+}
+
+TEST(ClockTest, reusesSlots) {
+  Clock<int> clock(2);
+
+  clock.access(1);
+  clock.access(2);
+  EXPECT_ANY_THROW(clock.access(3));
+
+  clock.erase(1);
+  clock.erase(1);
+  clock.access(3);
+  // 3 reuses the slot of 1, which is the next one to be visited by the hand
+  EXPECT_EQ(3, clock.evict());
+  clock.access(4);
+  EXPECT_EQ(2, clock.evict());
+  EXPECT_EQ(4, clock.evict());
+}
+
+TEST(ClockTest, tracksManyPages) {
+  Clock<int> clock(1000);
+
+  for (int i = 0; i < 1000; i++) {
+    clock.access(i);
+  }
+  for (int i = 0; i < 1000; i += 2) {
+    clock.erase(i);
+  }
+  for (int i = 1; i < 1000; i += 2) {
+    EXPECT_EQ(i, clock.evict());
+  }
+  EXPECT_TRUE(clock.empty());
+}
+
+TEST(ClockTest, passesRejectedPages) {
+  Clock<int> clock(3);
+
+  clock.access(1);
+  clock.access(2);
+  clock.access(3);
+  EXPECT_EQ(2, clock.evictIf([](int pageId) { return pageId != 1; }));
+  EXPECT_ANY_THROW(clock.evictIf([](int) { return false; }));
+  EXPECT_EQ(3, clock.evict());
+  EXPECT_EQ(1, clock.evict());
+}
@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "utils/crc32c.h"
+
+using namespace dbImpl;
+
+TEST(Crc32cTest, matchesTheReferenceValues) {
+  const char* digits = "123456789";
+  EXPECT_EQ(0xe3069283u, crc32c(digits, std::strlen(digits)));
+  EXPECT_EQ(0u, crc32c(digits, 0));
+  std::vector<uint8_t> zeros(32, 0);
+  EXPECT_EQ(0x8a9136aau, crc32c(zeros.data(), zeros.size()));
+}
+
+TEST(Crc32cTest, canBeComputedInPieces) {
+  std::vector<uint8_t> data(1000);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = i * 7;
+  }
+  uint32_t whole = crc32c(data.data(), data.size());
+  for (size_t split : {1, 3, 8, 500, 999}) {
+    EXPECT_EQ(whole, crc32c(data.data() + split, data.size() - split, crc32c(data.data(), split)));
+  }
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include "slottedPages/freeSpaceInventory.h"
+
+using namespace dbImpl;
+
+static const uint32_t pageSize = 16 * 1024;
+
+//this class makes some private functions
+//public and therefore allows whitebox testing
+class WhiteboxFreeSpaceInventory : public FreeSpaceInventory {
+  public:
+    using FreeSpaceInventory::FreeSpaceInventory; //inherit constructor
+    using FreeSpaceInventory::compressSpaceIndicator; //expose compressSpaceIndicator
+};
+
+TEST(FreeSpaceInventory, spaceIndicatorIsMonotonic) {
+  WhiteboxFreeSpaceInventory fsi(pageSize);
+  uint8_t lastResult = 0;
+  for(uint32_t i = 0; i <= pageSize; i++) {
+    EXPECT_GE(fsi.compressSpaceIndicator(i), lastResult);
+    lastResult = fsi.compressSpaceIndicator(i);
+  }
+}
+
+TEST(FreeSpaceInventory, spaceIndicatorUsesOnly4Bits) {
+  WhiteboxFreeSpaceInventory fsi(pageSize);
+  for(uint32_t i = 0; i <= pageSize; i++) {
+    EXPECT_EQ(0, fsi.compressSpaceIndicator(i) & 0xf0);
+  }
+}
+
+TEST(FreeSpaceInventory, spaceIndicatorUsesCompleteRange) {
+  WhiteboxFreeSpaceInventory fsi(pageSize);
+  EXPECT_EQ(0, fsi.compressSpaceIndicator(0));
+  uint8_t lastResult = 0;
+  for(uint32_t i = 0; i <= pageSize; i++) {
+    EXPECT_LE(fsi.compressSpaceIndicator(i) - lastResult, 1);
+    lastResult = fsi.compressSpaceIndicator(i);
+  }
+  EXPECT_EQ(0x0f, fsi.compressSpaceIndicator(pageSize));
+}
+
+TEST(FreeSpaceInventory, initiallyReturnsTheFirstPage) {
+  FreeSpaceInventory fsi(pageSize);
+  EXPECT_EQ(0, fsi.findFreeSpace(16));
+  EXPECT_EQ(0, fsi.getPageCount());
+}
+
+TEST(FreeSpaceInventory, managesTheAmountOfFreeSpace) {
+  FreeSpaceInventory fsi(pageSize);
+
+  uint64_t firstPage = fsi.findFreeSpace(16);
+  fsi.updateFreeSpace(firstPage, pageSize/4);
+  EXPECT_EQ(firstPage, fsi.findFreeSpace(pageSize/8));
+  EXPECT_NE(firstPage, fsi.findFreeSpace(pageSize/2));
+
+  uint64_t secondPage = fsi.findFreeSpace(pageSize/2);
+  fsi.updateFreeSpace(secondPage, pageSize/4);
+  EXPECT_NE(secondPage, fsi.findFreeSpace(pageSize/2));
+  EXPECT_EQ(firstPage, fsi.findFreeSpace(pageSize/8));
+
+  fsi.updateFreeSpace(firstPage, pageSize);
+  EXPECT_EQ(firstPage, fsi.findFreeSpace(pageSize/2));
+}
+
+TEST(FreeSpaceInventory, neverReturnsPagesWithTooLittleSpace) {
+  FreeSpaceInventory fsi(pageSize);
+  for(uint32_t freeBytes = 0; freeBytes < pageSize; freeBytes += 97) {
+    fsi.updateFreeSpace(0, freeBytes);
+    for(uint32_t required = 1; required < pageSize; required += 89) {
+      if(fsi.findFreeSpace(required) == 0) {
+        EXPECT_GE(freeBytes, required);
+      }
+    }
+  }
+}
+
+TEST(FreeSpaceInventory, findsPagesWhichGotSpaceAgain) {
+  FreeSpaceInventory fsi(pageSize);
+  //fill 1000 pages, as a bulk load would
+  for(uint64_t partId = 0; partId < 1000; partId++) {
+    EXPECT_EQ(partId, fsi.findFreeSpace(100));
+    fsi.updateFreeSpace(partId, 50);
+  }
+  EXPECT_EQ(1000, fsi.findFreeSpace(100));
+  fsi.updateFreeSpace(500, pageSize/2);
+  EXPECT_EQ(500, fsi.findFreeSpace(100));
+  EXPECT_EQ(1000, fsi.findFreeSpace(pageSize/2));
+}
+
+TEST(FreeSpaceInventory, treatsSkippedPagesAsEmpty) {
+  FreeSpaceInventory fsi(pageSize);
+  fsi.updateFreeSpace(0, 0);
+  fsi.updateFreeSpace(5, 0);
+  EXPECT_EQ(6, fsi.getPageCount());
+  EXPECT_EQ(1, fsi.findFreeSpace(pageSize/2));
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "buffer/lruK.h"
+
+using namespace dbImpl;
+
+TEST(LruKTest, evictsPagesWithoutKAccessesFirst) {
+  LruK<int> lruK(2);
+
+  EXPECT_TRUE(lruK.empty());
+
+  lruK.access(1);
+  lruK.access(1);
+  lruK.access(2);
+  lruK.access(3);
+
+  EXPECT_EQ(2, lruK.evict());
+  EXPECT_EQ(3, lruK.evict());
+  EXPECT_EQ(1, lruK.evict());
+  EXPECT_TRUE(lruK.empty());
+  EXPECT_ANY_THROW(lruK.evict());
+}
+
+TEST(LruKTest, ordersByKthAccess) {
+  LruK<int> lruK(2);
+
+  lruK.access(1); // t=1
+  lruK.access(2); // t=2
+  lruK.access(2); // t=3
+  lruK.access(1); // t=4
+  lruK.access(2); // t=5
+
+  // the second most recent access of 1 happened at t=1, of 2 at t=3
+  std::vector<int> victims;
+  lruK.peekVictims(5, victims);
+  EXPECT_EQ(std::vector<int>({1, 2}), victims);
+
+  lruK.erase(1);
+  EXPECT_EQ(2, lruK.evict());
+  EXPECT_TRUE(lruK.empty());
+}
+
+TEST(LruKTest, keepsRejectedPages) {
+  LruK<int> lruK(2);
+
+  lruK.access(1);
+  lruK.access(2);
+  lruK.access(3);
+  EXPECT_EQ(2, lruK.evictIf([](int pageId) { return pageId != 1; }));
+  EXPECT_ANY_THROW(lruK.evictIf([](int) { return false; }));
+  EXPECT_EQ(1, lruK.evict());
+  EXPECT_EQ(3, lruK.evict());
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+#include <stdexcept>
+#include <stdlib.h>
+
+#include "utils/lz4.h"
+
+using namespace dbImpl;
+
+static void expectRoundTrip(const std::vector<uint8_t>& data, size_t maxCompressedSize) {
+  std::vector<uint8_t> compressed(data.size() + data.size() / 255 + 16);
+  size_t length = lz4Compress(data.data(), data.size(), compressed.data(), compressed.size());
+  ASSERT_GT(length, 0u);
+  EXPECT_LE(length, maxCompressedSize);
+  std::vector<uint8_t> decompressed(data.size());
+  lz4Decompress(compressed.data(), length, decompressed.data(), decompressed.size());
+  EXPECT_EQ(data, decompressed);
+}
+
+TEST(Lz4Test, compressesRepeatedData) {
+  std::vector<uint8_t> data(16 * 1024);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = "abcdefgh"[i % 8];
+  }
+  expectRoundTrip(data, 256);
+  expectRoundTrip(std::vector<uint8_t>(), 1);
+  expectRoundTrip(std::vector<uint8_t>(7, 'x'), 8);
+}
+
+TEST(Lz4Test, storesRandomDataAsLiterals) {
+  unsigned seed = 42;
+  std::vector<uint8_t> data(16 * 1024);
+  for (uint8_t& byte : data) {
+    byte = rand_r(&seed);
+  }
+  expectRoundTrip(data, data.size() + data.size() / 255 + 16);
+  // the compressed data does not fit, so compression gives up
+  std::vector<uint8_t> compressed(data.size() / 2);
+  EXPECT_EQ(0u, lz4Compress(data.data(), data.size(), compressed.data(), compressed.size()));
+}
+
+TEST(Lz4Test, detectsCorruptBlocks) {
+  std::vector<uint8_t> data(1024, 'a');
+  std::vector<uint8_t> compressed(data.size());
+  size_t length = lz4Compress(data.data(), data.size(), compressed.data(), compressed.size());
+  std::vector<uint8_t> decompressed(data.size());
+  // truncated
+  EXPECT_THROW(lz4Decompress(compressed.data(), length - 1, decompressed.data(), decompressed.size()),
+      std::runtime_error);
+  // expands to a different size
+  EXPECT_THROW(lz4Decompress(compressed.data(), length, decompressed.data(), decompressed.size() - 1),
+      std::runtime_error);
+}
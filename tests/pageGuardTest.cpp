@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include "buffer/bufferManager.h"
+#include "buffer/pageGuard.h"
+
+using namespace dbImpl;
+
+TEST(PageGuardTest, unfixesThePageWhenDestroyed) {
+  BufferManager bm(1);
+  {
+    PageGuard page = bm.fixPageGuarded(BufferManager::buildPageId(32, 0), false);
+    EXPECT_TRUE(page->isUsed());
+    // the only frame is pinned by the guard
+    EXPECT_THROW(bm.fixPage(BufferManager::buildPageId(32, 1), false), std::runtime_error);
+  }
+  PageGuard page = bm.fixPageGuarded(BufferManager::buildPageId(32, 1), false);
+  EXPECT_EQ(BufferManager::buildPageId(32, 1), page->pageId);
+  page.release();
+  EXPECT_FALSE(page);
+}
+
+TEST(PageGuardTest, movesTheFixWithoutRefixing) {
+  BufferManager bm(2);
+  PageGuard page = bm.fixPageGuarded(BufferManager::buildPageId(32, 0), true);
+  BufferFrame* frame = page.getFrame();
+  PageGuard moved(std::move(page));
+  EXPECT_FALSE(page);
+  EXPECT_EQ(frame, moved.getFrame());
+  EXPECT_TRUE(moved.isExclusive());
+
+  // assigning another page releases the previous one
+  moved = bm.fixPageGuarded(BufferManager::buildPageId(32, 1), false);
+  EXPECT_FALSE(frame->isUsed());
+  EXPECT_EQ(BufferManager::buildPageId(32, 1), moved->pageId);
+  EXPECT_EQ(2u, bm.getStats().misses);
+  EXPECT_EQ(0u, bm.getStats().hits);
+}
+
+TEST(PageGuardTest, writesDirtyPages) {
+  {
+    BufferManager bm(1);
+    PageGuard page = bm.fixPageGuarded(BufferManager::buildPageId(32, 2), true);
+    *reinterpret_cast<uint64_t*>(page.getData()) = 42;
+    page.markDirty();
+  }
+  BufferManager bm(1);
+  PageGuard page = bm.fixPageGuarded(BufferManager::buildPageId(32, 2), false);
+  EXPECT_EQ(42u, *reinterpret_cast<uint64_t*>(page.getData()));
+}
+
+TEST(PageGuardTest, upgradesAndDowngradesTheLatch) {
+  BufferManager bm(1);
+  PageGuard page = bm.fixPageGuarded(BufferManager::buildPageId(32, 3), false);
+  uint64_t version;
+  BufferFrame* frame = &bm.fixPageOptimistic(BufferManager::buildPageId(32, 3), version);
+  EXPECT_EQ(frame, page.getFrame());
+
+  page.upgrade();
+  EXPECT_TRUE(page.isExclusive());
+  // optimistic readers notice the exclusive latch
+  EXPECT_FALSE(BufferManager::validate(*frame, version));
+  *reinterpret_cast<uint64_t*>(page.getData()) = 7;
+  page.markDirty();
+
+  page.downgrade();
+  EXPECT_FALSE(page.isExclusive());
+  bm.unfixPageOptimistic(*frame);
+  frame = &bm.fixPageOptimistic(BufferManager::buildPageId(32, 3), version);
+  EXPECT_TRUE(BufferManager::validate(*frame, version));
+  EXPECT_EQ(7u, *reinterpret_cast<uint64_t*>(frame->getData()));
+  bm.unfixPageOptimistic(*frame);
+}
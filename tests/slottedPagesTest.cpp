@@ -1,5 +1,13 @@
 #include <gtest/gtest.h>
 #include <string>
+#include <cstring>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <unistd.h>
 
 #include "buffer/bufferManager.h"
 #include "slottedPages/spSegment.h"
@@ -51,7 +59,7 @@ TEST(SlottedPagesTest, iteratesOverAllStoredTuples) {
   auto iter = spSegment.begin();
 
   ASSERT_NE(spSegment.end(), iter);
-  dbImpl::Record record = *iter;
+  dbImpl::RecordView record = *iter;
   EXPECT_STREQ(helloStr.c_str(), reinterpret_cast<const char*>(record.getData()));
   iter++;
 
@@ -61,6 +69,621 @@ TEST(SlottedPagesTest, iteratesOverAllStoredTuples) {
   iter++;
 
   ASSERT_EQ(spSegment.end(), iter);
+  //the view keeps the page fixed
+  record = dbImpl::RecordView();
   spSegment.remove(tid1);
   spSegment.remove(tid2);
 }
+
+TEST(SlottedPagesTest, copiesOfIteratorsShareTheirPage) {
+  dbImpl::BufferManager bm(100);
+  dbImpl::SPSegment spSegment(bm, 5);
+  std::string helloStr("Hello");
+  dbImpl::Record helloRecord(helloStr.length() + 1, reinterpret_cast<const uint8_t*>(helloStr.c_str()));
+  uint64_t tid1 = spSegment.insert(helloRecord);
+  uint64_t tid2 = spSegment.insert(helloRecord);
+
+  auto iter = spSegment.begin();
+  uint64_t fixes = bm.getStats().hits + bm.getStats().misses;
+  auto copy = iter;
+  auto old = iter++;
+  EXPECT_EQ(copy, old);
+  EXPECT_NE(copy, iter);
+  EXPECT_EQ(fixes, bm.getStats().hits + bm.getStats().misses);
+  EXPECT_STREQ(helloStr.c_str(), reinterpret_cast<const char*>((*copy).getData()));
+
+  // the page stays fixed as long as one of the copies uses it
+  iter++;
+  EXPECT_EQ(spSegment.end(), iter);
+  EXPECT_STREQ(helloStr.c_str(), reinterpret_cast<const char*>((*copy).getData()));
+  copy = spSegment.end();
+  old = spSegment.end();
+  spSegment.remove(tid1);
+  spSegment.remove(tid2);
+}
+
+TEST(SlottedPagesTest, viewsRecordsWithoutCopying) {
+  dbImpl::BufferManager bm(100);
+  dbImpl::SPSegment spSegment(bm, 9);
+  std::string helloStr("Hello");
+  uint64_t tid = spSegment.insert(dbImpl::Record(helloStr.length() + 1, reinterpret_cast<const uint8_t*>(helloStr.c_str())));
+
+  //both views point into the page
+  dbImpl::RecordView view = spSegment.lookupView(tid);
+  dbImpl::RecordView secondView = spSegment.lookupView(tid);
+  EXPECT_EQ(view.getData(), secondView.getData());
+  EXPECT_EQ(helloStr.length() + 1, view.getLen());
+  EXPECT_STREQ(helloStr.c_str(), reinterpret_cast<const char*>(view.getData()));
+
+  //views of an iterator stay valid after the iterator moved on
+  auto iter = spSegment.begin();
+  dbImpl::RecordView iteratorView = *iter;
+  iter++;
+  EXPECT_EQ(spSegment.end(), iter);
+  EXPECT_EQ(view.getData(), iteratorView.getData());
+  EXPECT_STREQ(helloStr.c_str(), reinterpret_cast<const char*>(iteratorView.getData()));
+  view = dbImpl::RecordView();
+  secondView = dbImpl::RecordView();
+  iteratorView = dbImpl::RecordView();
+  spSegment.remove(tid);
+}
+
+TEST(SlottedPagesTest, rejectsModificationsWhileViewingTheSegment) {
+  unlink("segments/37");
+  dbImpl::BufferManager bm(100);
+  dbImpl::SPSegment spSegment(bm, 37);
+  uint64_t value = 1;
+  dbImpl::Record record(sizeof(value), reinterpret_cast<const uint8_t*>(&value));
+  std::vector<uint64_t> tids;
+  for(unsigned i = 0; i < 10; i++) {
+    tids.push_back(spSegment.insert(record));
+  }
+  //modifying the segment during a scan would wait for the scan's latch
+  unsigned scanned = 0;
+  for(auto iter = spSegment.begin(); iter != spSegment.end(); iter++, scanned++) {
+    dbImpl::RecordView view = *iter;
+    if(scanned == 0) {
+      EXPECT_THROW(spSegment.update(tids[0], record), std::logic_error);
+      EXPECT_THROW(spSegment.remove(tids[0]), std::logic_error);
+      EXPECT_THROW(spSegment.insert(record), std::logic_error);
+    }
+  }
+  EXPECT_EQ(tids.size(), scanned);
+  {
+    dbImpl::RecordView view = spSegment.lookupView(tids[0]);
+    EXPECT_THROW(spSegment.remove(tids[0]), std::logic_error);
+  }
+  //the modifications succeed once the scan is done
+  value = 2;
+  for(uint64_t tid : tids) {
+    spSegment.update(tid, dbImpl::Record(sizeof(value), reinterpret_cast<const uint8_t*>(&value)));
+  }
+  for(auto iter = spSegment.begin(); iter != spSegment.end(); iter++) {
+    EXPECT_EQ(2u, *reinterpret_cast<const uint64_t*>((*iter).getData()));
+  }
+  for(uint64_t tid : tids) {
+    spSegment.remove(tid);
+  }
+}
+
+TEST(SlottedPagesTest, looksUpBatchesOfTids) {
+  dbImpl::BufferManager bm(100);
+  dbImpl::SPSegment spSegment(bm, 10);
+  std::vector<uint64_t> tids;
+  std::set<uint64_t> pages;
+  uint8_t data[100] = {0};
+  for(uint32_t i = 0; i < 1000; i++) {
+    std::memcpy(data, &i, sizeof(i));
+    tids.push_back(spSegment.insert(dbImpl::Record(sizeof(data), data)));
+    //(the lower 48 bits of a TID store the page id)
+    pages.insert(tids.back() & 0xffffffffffffull);
+  }
+  //does not fit onto its full page anymore, so it is redirected
+  std::vector<uint8_t> largeData(2000, 0);
+  uint32_t largeValue = 4242;
+  std::memcpy(largeData.data(), &largeValue, sizeof(largeValue));
+  spSegment.update(tids[0], dbImpl::Record(largeData.size(), largeData.data()));
+  EXPECT_EQ(largeData.size(), spSegment.lookup(tids[0]).getLen());
+
+  std::vector<uint64_t> batch(tids.rbegin(), tids.rend());
+  std::vector<bool> found(batch.size(), false);
+  dbImpl::BufferStats before = bm.getStats();
+  spSegment.lookupBatch(batch, [&](size_t index, const dbImpl::RecordView& record) {
+    EXPECT_FALSE(found[index]);
+    found[index] = true;
+    uint32_t i = batch.size() - 1 - index;
+    EXPECT_EQ(i == 0 ? largeValue : i, *reinterpret_cast<const uint32_t*>(record.getData()));
+    EXPECT_EQ(i == 0 ? largeData.size() : sizeof(data), record.getLen());
+  });
+  dbImpl::BufferStats stats = bm.getStats();
+  EXPECT_EQ(std::vector<bool>(batch.size(), true), found);
+  //every page is fixed once, the page storing the redirected record twice
+  EXPECT_LE(stats.hits + stats.misses - before.hits - before.misses, pages.size() + 1);
+
+  EXPECT_ANY_THROW(spSegment.lookupBatch({dbImpl::BufferManager::buildPageId(11, 0)},
+      [](size_t, const dbImpl::RecordView&) {}));
+  for(uint64_t tid : tids) {
+    spSegment.remove(tid);
+  }
+}
+
+TEST(SlottedPagesTest, storesLargeRecordsOnLargePages) {
+  dbImpl::BufferOptions options;
+  options.pageClasses.push_back(dbImpl::PageClassOptions{64 * 1024, 10, {3}});
+  dbImpl::BufferManager bm(100, options);
+  dbImpl::SPSegment spSegment(bm, 3);
+
+  //does not fit on a page of the default size
+  std::string testStr(40 * 1024, 'x');
+  dbImpl::Record testRecord(testStr.length() + 1, reinterpret_cast<const uint8_t*>(testStr.c_str()));
+  uint64_t tid = spSegment.insert(testRecord);
+
+  dbImpl::Record readRecord = spSegment.lookup(tid);
+  EXPECT_EQ(testStr.length()+1, readRecord.getLen());
+  EXPECT_STREQ(testStr.c_str(), reinterpret_cast<const char*>(readRecord.getData()));
+
+  spSegment.remove(tid);
+}
+
+TEST(SlottedPagesTest, commitsInsertsUsingTheWriteAheadLog) {
+  unlink("slottedPagesTest.log");
+  dbImpl::BufferOptions options;
+  options.logFile = "slottedPagesTest.log";
+  dbImpl::BufferManager bm(100, options);
+  dbImpl::SPSegment spSegment(bm, 4);
+
+  //modifications are only logged, the caller commits them
+  uint64_t value = 42;
+  uint64_t tid = spSegment.insert(dbImpl::Record(sizeof(value), reinterpret_cast<const uint8_t*>(&value)));
+  spSegment.update(tid, dbImpl::Record(sizeof(value), reinterpret_cast<const uint8_t*>(&value)));
+  spSegment.remove(tid);
+  EXPECT_EQ(0u, bm.getStats().commits);
+  spSegment.commit();
+  EXPECT_EQ(1u, bm.getStats().commits);
+
+  const unsigned threadCount = 4;
+  const unsigned insertsPerThread = 25;
+  std::vector<std::vector<uint64_t>> tids(threadCount);
+  std::vector<std::thread> threads;
+  for(unsigned t = 0; t < threadCount; t++) {
+    threads.emplace_back([&spSegment, &tids, t]() {
+      for(unsigned i = 0; i < insertsPerThread; i++) {
+        uint64_t value = t * insertsPerThread + i;
+        tids[t].push_back(spSegment.insert(dbImpl::Record(sizeof(value), reinterpret_cast<const uint8_t*>(&value))));
+        spSegment.commit();
+      }
+    });
+  }
+  for(std::thread& thread : threads) {
+    thread.join();
+  }
+  dbImpl::BufferStats stats = bm.getStats();
+  EXPECT_EQ(threadCount * insertsPerThread + 1, stats.commits);
+  EXPECT_LE(stats.logSyncs, stats.commits);
+
+  for(unsigned t = 0; t < threadCount; t++) {
+    for(unsigned i = 0; i < insertsPerThread; i++) {
+      dbImpl::Record record = spSegment.lookup(tids[t][i]);
+      EXPECT_EQ(t * insertsPerThread + i, *reinterpret_cast<const uint64_t*>(record.getData()));
+      spSegment.remove(tids[t][i]);
+    }
+  }
+}
+
+TEST(SlottedPagesTest, movesRecordsBetweenPagesConcurrently) {
+  unlink("segments/43");
+  dbImpl::BufferManager bm(100);
+  dbImpl::SPSegment spSegment(bm, 43);
+  //the records of all threads share their pages
+  const unsigned threadCount = 4;
+  const uint32_t recordsPerThread = 30;
+  std::vector<std::vector<uint64_t>> tids(threadCount);
+  std::vector<uint8_t> data(1000, 0);
+  for(uint32_t i = 0; i < recordsPerThread; i++) {
+    for(unsigned t = 0; t < threadCount; t++) {
+      tids[t].push_back(spSegment.insert(dbImpl::Record(data.size(), data.data())));
+    }
+  }
+  //records of varying sizes are moved to pages used by other threads,
+  //while these threads move their records to the pages left
+  std::vector<std::future<void>> threads;
+  for(unsigned t = 0; t < threadCount; t++) {
+    threads.push_back(std::async(std::launch::async, [&spSegment, &tids, t]() {
+      unsigned seed = t;
+      for(uint32_t round = 0; round < 100; round++) {
+        for(uint32_t i = 0; i < recordsPerThread; i++) {
+          std::vector<uint8_t> record(round == 99 ? 100 : 100 + rand_r(&seed) % 6000, 0);
+          uint32_t value = round * recordsPerThread + i;
+          std::memcpy(record.data(), &value, sizeof(value));
+          spSegment.update(tids[t][i], dbImpl::Record(record.size(), record.data()));
+        }
+      }
+    }));
+  }
+  for(std::future<void>& thread : threads) {
+    ASSERT_EQ(std::future_status::ready, thread.wait_for(std::chrono::seconds(10)));
+    thread.get();
+  }
+  for(unsigned t = 0; t < threadCount; t++) {
+    for(uint32_t i = 0; i < recordsPerThread; i++) {
+      dbImpl::Record record = spSegment.lookup(tids[t][i]);
+      EXPECT_EQ(100u, record.getLen());
+      EXPECT_EQ(99 * recordsPerThread + i, *reinterpret_cast<const uint32_t*>(record.getData()));
+    }
+  }
+}
+
+TEST(SlottedPagesTest, findsPagesForInsertsWithFewFixes) {
+  dbImpl::BufferManager bm(1000);
+  dbImpl::SPSegment spSegment(bm, 6);
+  uint8_t data[100] = {0};
+  std::vector<uint64_t> tids;
+  for(unsigned i = 0; i < 20000; i++) {
+    tids.push_back(spSegment.insert(dbImpl::Record(sizeof(data), data)));
+  }
+  //the segment spans more than 100 pages, but every insert fixes a single page
+  //(the lower 48 bits of a TID store the page id)
+  EXPECT_GT(bm.getPartIdForPageId(tids.back() & 0xffffffffffffull), 100u);
+  dbImpl::BufferStats before = bm.getStats();
+  for(unsigned i = 0; i < 1000; i++) {
+    tids.push_back(spSegment.insert(dbImpl::Record(sizeof(data), data)));
+  }
+  dbImpl::BufferStats stats = bm.getStats();
+  EXPECT_EQ(1000u, stats.hits + stats.misses - before.hits - before.misses);
+
+  //space freed on the first page is used again
+  for(unsigned i = 0; i < 50; i++) {
+    spSegment.remove(tids[i]);
+  }
+  uint64_t tid = spSegment.insert(dbImpl::Record(sizeof(data), data));
+  EXPECT_EQ(tids[0] & 0xffffffffffffull, tid & 0xffffffffffffull);
+  tids.push_back(tid);
+  for(unsigned i = 50; i < tids.size(); i++) {
+    spSegment.remove(tids[i]);
+  }
+}
+
+TEST(SlottedPagesTest, storesManySmallRecords) {
+  dbImpl::BufferManager bm(100);
+  dbImpl::SPSegment spSegment(bm, 7);
+  //more records than slots on a page fit onto a single page
+  std::vector<uint64_t> tids;
+  for(uint64_t i = 0; i < 1000; i++) {
+    tids.push_back(spSegment.insert(dbImpl::Record(sizeof(i), reinterpret_cast<const uint8_t*>(&i))));
+  }
+  for(uint64_t i = 0; i < 1000; i++) {
+    dbImpl::Record record = spSegment.lookup(tids[i]);
+    EXPECT_EQ(i, *reinterpret_cast<const uint64_t*>(record.getData()));
+  }
+  for(uint64_t tid : tids) {
+    spSegment.remove(tid);
+  }
+}
+
+TEST(SlottedPagesTest, bulkLoadsRecordsIntoNewPages) {
+  dbImpl::BufferManager bm(100);
+  dbImpl::SPSegment spSegment(bm, 8);
+  std::string helloStr("Hello");
+  uint64_t insertedTid = spSegment.insert(dbImpl::Record(helloStr.length() + 1, reinterpret_cast<const uint8_t*>(helloStr.c_str())));
+
+  dbImpl::BufferStats before = bm.getStats();
+  dbImpl::SPSegment::Appender appender = spSegment.appender();
+  const uint32_t recordCount = 20000;
+  for(uint32_t i = 0; i < recordCount; i++) {
+    //records of varying sizes
+    std::vector<uint8_t> data(sizeof(i) + i % 100, 0);
+    std::memcpy(data.data(), &i, sizeof(i));
+    appender.append(data.data(), data.size());
+  }
+  std::vector<dbImpl::SPSegment::TidRange> ranges = appender.finish();
+  dbImpl::BufferStats stats = bm.getStats();
+  //one fix per page instead of one per record
+  EXPECT_EQ(ranges.size(), stats.hits + stats.misses - before.hits - before.misses);
+  EXPECT_GT(ranges.size(), 50u);
+
+  //the records are stored behind the existing pages, in the order of appending
+  uint32_t i = 0;
+  for(const dbImpl::SPSegment::TidRange& range : ranges) {
+    EXPECT_NE(insertedTid & 0xffffffffffffull, range.pageId);
+    for(uint16_t slot = 0; slot < range.count; slot++, i++) {
+      dbImpl::Record record = spSegment.lookup(range.getTid(slot));
+      EXPECT_EQ(sizeof(i) + i % 100, record.getLen());
+      EXPECT_EQ(i, *reinterpret_cast<const uint32_t*>(record.getData()));
+    }
+  }
+  EXPECT_EQ(recordCount, i);
+
+  //the records are visible to scans and inserts use the space left on the pages
+  i = 0;
+  for(auto iter = spSegment.begin(); iter != spSegment.end(); iter++) {
+    i++;
+  }
+  EXPECT_EQ(recordCount + 1, i);
+  uint64_t tid = spSegment.insert(dbImpl::Record(sizeof(i), reinterpret_cast<const uint8_t*>(&i)));
+  EXPECT_EQ(insertedTid & 0xffffffffffffull, tid & 0xffffffffffffull);
+}
+
+TEST(SlottedPagesTest, storesMoreThan255RecordsOnAPage) {
+  dbImpl::BufferManager bm(100);
+  dbImpl::SPSegment spSegment(bm, 40);
+  //narrow tuples of two ints all fit onto the first page
+  std::vector<uint64_t> tids;
+  for(uint32_t i = 0; i < 1000; i++) {
+    uint32_t tuple[2] = {i, 2 * i};
+    tids.push_back(spSegment.insert(dbImpl::Record(sizeof(tuple), reinterpret_cast<const uint8_t*>(tuple))));
+    //(the lower 48 bits of a TID store the page id, the upper 16 bits the slot number)
+    EXPECT_EQ(tids[0] & 0xffffffffffffull, tids.back() & 0xffffffffffffull);
+    EXPECT_EQ(i, tids.back() >> 48);
+  }
+  uint32_t updated[2] = {4242, 4242};
+  spSegment.update(tids[999], dbImpl::Record(sizeof(updated), reinterpret_cast<const uint8_t*>(updated)));
+  spSegment.remove(tids[500]);
+  uint32_t count = 0;
+  for(auto iter = spSegment.begin(); iter != spSegment.end(); iter++) {
+    count++;
+  }
+  EXPECT_EQ(999u, count);
+  for(uint32_t i = 0; i < 1000; i++) {
+    if(i == 500) {
+      EXPECT_ANY_THROW(spSegment.lookup(tids[i]));
+      continue;
+    }
+    dbImpl::Record record = spSegment.lookup(tids[i]);
+    const uint32_t* tuple = reinterpret_cast<const uint32_t*>(record.getData());
+    EXPECT_EQ(i == 999 ? 4242 : i, tuple[0]);
+  }
+  EXPECT_THROW(dbImpl::SPSegment(bm, 1 << 16), std::invalid_argument);
+}
+
+//the structures of the initial slotted page format
+struct BaselineSPHeader {
+  uint16_t dataStart;
+  uint16_t freeSpace;
+  uint8_t nrAllocatedSlots;
+  uint8_t firstFreeSlot;
+};
+
+union BaselineSlotDescriptor {
+  struct {
+    uint8_t redirectionMarker;
+    uint8_t unused;
+    uint32_t offset : 24;
+    uint32_t len : 24;
+  } inplace;
+  uint64_t redirectionTid;
+};
+
+static BaselineSlotDescriptor baselineSlot(uint32_t offset, uint32_t len) {
+  BaselineSlotDescriptor slot;
+  std::memset(&slot, 0, sizeof(slot));
+  slot.inplace.offset = offset;
+  slot.inplace.len = len;
+  return slot;
+}
+
+//the initial format stored the TID without setting the redirection marker
+static BaselineSlotDescriptor baselineRedirection(uint64_t tid) {
+  BaselineSlotDescriptor slot;
+  std::memset(&slot, 0, sizeof(slot));
+  slot.redirectionTid = tid;
+  return slot;
+}
+
+//TIDs of the initial format have a 56 bit page id and an 8 bit slot number
+static uint64_t baselineTid(uint32_t segmentId, uint64_t partId, uint8_t slotNr) {
+  return static_cast<uint64_t>(slotNr) << 56 | dbImpl::BufferManager::buildPageId(segmentId, partId);
+}
+
+//the TID of a record of the initial format after the conversion
+static uint64_t convertedTid(uint32_t segmentId, uint64_t partId, uint8_t slotNr) {
+  return dbImpl::SPSegment::convertLegacyTid(baselineTid(segmentId, partId, slotNr));
+}
+
+//writes a page of the initial format, the records are stored at the offsets of their slots
+static void writeBaselinePage(dbImpl::BufferManager& bm, uint64_t pageId,
+    const std::vector<BaselineSlotDescriptor>& slots, const std::vector<uint32_t>& values, uint8_t firstFreeSlot) {
+  dbImpl::BufferFrame& frame = bm.fixPage(pageId, true);
+  uint8_t* page = frame.getData();
+  BaselineSPHeader header;
+  header.dataStart = 16 * 1024;
+  header.nrAllocatedSlots = slots.size();
+  header.firstFreeSlot = firstFreeSlot;
+  for(size_t slotNr = 0; slotNr < slots.size(); slotNr++) {
+    //the slots directly followed the header
+    std::memcpy(page + sizeof(header) + slotNr * sizeof(BaselineSlotDescriptor), &slots[slotNr], sizeof(BaselineSlotDescriptor));
+    if(slots[slotNr].inplace.len != 0) {
+      header.dataStart = std::min<uint16_t>(header.dataStart, slots[slotNr].inplace.offset);
+      std::memset(page + slots[slotNr].inplace.offset, 0, slots[slotNr].inplace.len);
+      std::memcpy(page + slots[slotNr].inplace.offset, &values[slotNr], sizeof(uint32_t));
+    }
+  }
+  header.freeSpace = header.dataStart - sizeof(header) - slots.size() * sizeof(BaselineSlotDescriptor);
+  std::memcpy(page, &header, sizeof(header));
+  bm.unfixPage(frame, true);
+}
+
+TEST(SlottedPagesTest, convertsPagesOfTheInitialFormat) {
+  dbImpl::BufferManager bm(100);
+  //The first record was moved behind the records of the second page. Its slot
+  //stores the TID without a redirection marker. The second slot is free, the
+  //third one holds an empty record.
+  for(uint64_t partId = 0; partId < 2; partId++) {
+    std::vector<BaselineSlotDescriptor> slots;
+    std::vector<uint32_t> values;
+    for(uint32_t slotNr = 0; slotNr < 100; slotNr++) {
+      values.push_back(partId * 100 + slotNr);
+      if(partId == 0 && slotNr == 0) {
+        slots.push_back(baselineRedirection(baselineTid(41, 1, 100)));
+      } else if(partId == 0 && slotNr == 1) {
+        slots.push_back(baselineSlot(0, 0));
+      } else if(partId == 0 && slotNr == 2) {
+        slots.push_back(baselineSlot(16 * 1024 - 100 * 100, 0));
+      } else {
+        slots.push_back(baselineSlot(16 * 1024 - (slotNr + 1) * 100, 100));
+      }
+    }
+    if(partId == 1) {
+      slots.push_back(baselineSlot(16 * 1024 - 100 * 100 - 300, 300));
+      values.push_back(4242);
+    }
+    writeBaselinePage(bm, dbImpl::BufferManager::buildPageId(41, partId), slots, values, partId == 0 ? 1 : slots.size());
+  }
+
+  dbImpl::SPSegment spSegment(bm, 41);
+  //the TIDs stay valid
+  for(uint32_t i = 0; i < 200; i++) {
+    uint64_t tid = convertedTid(41, i / 100, i % 100);
+    if(i == 1) {
+      EXPECT_ANY_THROW(spSegment.lookup(tid));
+      continue;
+    }
+    dbImpl::Record record = spSegment.lookup(tid);
+    if(i == 2) {
+      EXPECT_EQ(0u, record.getLen());
+      continue;
+    }
+    EXPECT_EQ(i == 0 ? 300u : 100u, record.getLen());
+    EXPECT_EQ(i == 0 ? 4242 : i, *reinterpret_cast<const uint32_t*>(record.getData()));
+  }
+  //the moved record is found on the second page, its redirection is skipped
+  uint32_t count = 0;
+  for(auto iter = spSegment.begin(); iter != spSegment.end(); iter++) {
+    count++;
+  }
+  EXPECT_EQ(199u, count);
+  //the free slot is used again
+  uint8_t data[100] = {0};
+  EXPECT_EQ(convertedTid(41, 0, 1), spSegment.insert(dbImpl::Record(sizeof(data), data)));
+  for(uint32_t i = 0; i < 200; i++) {
+    spSegment.remove(convertedTid(41, i / 100, i % 100));
+  }
+}
+
+TEST(SlottedPagesTest, movesRecordsOfTheInitialFormatWhichDoNotFit) {
+  dbImpl::BufferManager bm(100);
+  //The larger header does not leave room for both records of the first and
+  //the third page. The second record of the first page was moved from the
+  //first slot of the second page.
+  writeBaselinePage(bm, dbImpl::BufferManager::buildPageId(44, 0),
+      {baselineSlot(16 * 1024 - 8170, 8170), baselineSlot(16 * 1024 - 2 * 8170, 8170)}, {1, 2}, 2);
+  writeBaselinePage(bm, dbImpl::BufferManager::buildPageId(44, 1),
+      {baselineRedirection(baselineTid(44, 0, 1)), baselineSlot(16 * 1024 - 8160, 8160), baselineSlot(16 * 1024 - 2 * 8160, 8160)},
+      {0, 5, 6}, 3);
+  writeBaselinePage(bm, dbImpl::BufferManager::buildPageId(44, 2),
+      {baselineSlot(16 * 1024 - 8170, 8170), baselineSlot(16 * 1024 - 2 * 8170, 8170)}, {3, 4}, 2);
+
+  dbImpl::SPSegment spSegment(bm, 44);
+  const uint64_t tids[] = {convertedTid(44, 0, 0), convertedTid(44, 1, 0), convertedTid(44, 1, 1),
+      convertedTid(44, 1, 2), convertedTid(44, 2, 0), convertedTid(44, 2, 1)};
+  const uint32_t values[] = {1, 2, 5, 6, 3, 4};
+  for(uint32_t i = 0; i < 6; i++) {
+    dbImpl::Record record = spSegment.lookup(tids[i]);
+    EXPECT_EQ(values[i], *reinterpret_cast<const uint32_t*>(record.getData()));
+  }
+  //the redirection points to the new page of the record, its former slot is free
+  EXPECT_ANY_THROW(spSegment.lookup(convertedTid(44, 0, 1)));
+  uint32_t count = 0;
+  for(auto iter = spSegment.begin(); iter != spSegment.end(); iter++) {
+    count++;
+  }
+  EXPECT_EQ(6u, count);
+  //the moved records were appended to new pages in the order of the conversion: 1, 2, 0
+  EXPECT_EQ(4u, *reinterpret_cast<const uint32_t*>(spSegment.lookup(convertedTid(44, 3, 0)).getData()));
+  EXPECT_EQ(2u, *reinterpret_cast<const uint32_t*>(spSegment.lookup(convertedTid(44, 4, 0)).getData()));
+  spSegment.remove(tids[1]);
+  EXPECT_ANY_THROW(spSegment.lookup(convertedTid(44, 4, 0)));
+}
+
+TEST(SlottedPagesTest, rejectsAmbiguousSlotsOfTheInitialFormat) {
+  dbImpl::BufferManager bm(100);
+  //The first slot is either an empty record stored behind the slots or a
+  //redirection to the second one: the offset overlaps the TID's segment id.
+  writeBaselinePage(bm, dbImpl::BufferManager::buildPageId(45, 0),
+      {baselineRedirection(baselineTid(45, 0, 1)), baselineSlot(16 * 1024 - 100, 100)}, {0, 1}, 2);
+  EXPECT_THROW(dbImpl::SPSegment(bm, 45), std::runtime_error);
+}
+
+TEST(SlottedPagesTest, convertsPagesOfTheInitialFormatOnlyWithTheirPageSize) {
+  dbImpl::BufferOptions options;
+  options.pageClasses.push_back(dbImpl::PageClassOptions{64 * 1024, 10, {42}});
+  dbImpl::BufferManager bm(100, options);
+  writeBaselinePage(bm, dbImpl::BufferManager::buildPageId(42, 0), {}, {}, 0);
+  EXPECT_THROW(dbImpl::SPSegment(bm, 42), std::invalid_argument);
+}
+
+//the header of the format with 8 bit slot numbers. Its slots occupied 16 bytes,
+//in-place slots had the layout of the initial format.
+struct NarrowSPHeader {
+  uint16_t format;
+  uint8_t nrAllocatedSlots;
+  uint8_t firstFreeSlot;
+  uint32_t dataStart;
+  uint32_t freeSpace;
+  uint32_t unused;
+};
+
+//redirections stored the TID behind the marker
+static BaselineSlotDescriptor narrowRedirection(uint64_t tid) {
+  BaselineSlotDescriptor slot;
+  std::memset(&slot, 0, sizeof(slot));
+  slot.inplace.redirectionMarker = 0xff;
+  std::memcpy(reinterpret_cast<uint8_t*>(&slot) + sizeof(uint64_t), &tid, sizeof(tid));
+  return slot;
+}
+
+//writes a page with 8 bit slot numbers, the records are stored at the offsets of their slots
+static void writeNarrowPage(dbImpl::BufferManager& bm, uint64_t pageId,
+    const std::vector<BaselineSlotDescriptor>& slots, const std::vector<uint32_t>& values, uint8_t firstFreeSlot) {
+  dbImpl::BufferFrame& frame = bm.fixPage(pageId, true);
+  uint8_t* page = frame.getData();
+  NarrowSPHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.format = 0xf001;
+  header.dataStart = 16 * 1024;
+  header.nrAllocatedSlots = slots.size();
+  header.firstFreeSlot = firstFreeSlot;
+  uint32_t used = 0;
+  for(size_t slotNr = 0; slotNr < slots.size(); slotNr++) {
+    std::memcpy(page + sizeof(header) + slotNr * sizeof(BaselineSlotDescriptor), &slots[slotNr], sizeof(BaselineSlotDescriptor));
+    if(slots[slotNr].inplace.redirectionMarker != 0xff && slots[slotNr].inplace.len != 0) {
+      header.dataStart = std::min<uint32_t>(header.dataStart, slots[slotNr].inplace.offset);
+      used += slots[slotNr].inplace.len;
+      std::memset(page + slots[slotNr].inplace.offset, 0, slots[slotNr].inplace.len);
+      std::memcpy(page + slots[slotNr].inplace.offset, &values[slotNr], sizeof(uint32_t));
+    }
+  }
+  header.freeSpace = 16 * 1024 - sizeof(header) - slots.size() * sizeof(BaselineSlotDescriptor) - used;
+  std::memcpy(page, &header, sizeof(header));
+  bm.unfixPage(frame, true);
+}
+
+TEST(SlottedPagesTest, widensSlotNumbersOfPagesWith8BitSlots) {
+  dbImpl::BufferManager bm(100);
+  //the second record of the first page was moved to the second page, the third slot is free
+  writeNarrowPage(bm, dbImpl::BufferManager::buildPageId(46, 0),
+      {baselineSlot(16 * 1024 - 100, 100), narrowRedirection(baselineTid(46, 1, 1)), baselineSlot(0, 0)}, {1, 0, 0}, 2);
+  writeNarrowPage(bm, dbImpl::BufferManager::buildPageId(46, 1),
+      {baselineSlot(16 * 1024 - 100, 100), baselineSlot(16 * 1024 - 400, 300)}, {3, 2}, 2);
+
+  dbImpl::SPSegment spSegment(bm, 46);
+  const uint64_t tids[] = {convertedTid(46, 0, 0), convertedTid(46, 0, 1), convertedTid(46, 1, 0)};
+  const uint32_t values[] = {1, 2, 3};
+  for(uint32_t i = 0; i < 3; i++) {
+    dbImpl::Record record = spSegment.lookup(tids[i]);
+    EXPECT_EQ(i == 1 ? 300u : 100u, record.getLen());
+    EXPECT_EQ(values[i], *reinterpret_cast<const uint32_t*>(record.getData()));
+  }
+  EXPECT_ANY_THROW(spSegment.lookup(convertedTid(46, 0, 2)));
+  uint32_t count = 0;
+  for(auto iter = spSegment.begin(); iter != spSegment.end(); iter++) {
+    count++;
+  }
+  EXPECT_EQ(3u, count);
+  //the free slot is used again, and the redirected record returns to its page
+  uint8_t data[100] = {0};
+  EXPECT_EQ(convertedTid(46, 0, 2), spSegment.insert(dbImpl::Record(sizeof(data), data)));
+  uint32_t updated = 4242;
+  spSegment.update(tids[1], dbImpl::Record(sizeof(updated), reinterpret_cast<const uint8_t*>(&updated)));
+  EXPECT_EQ(updated, *reinterpret_cast<const uint32_t*>(spSegment.lookup(tids[1]).getData()));
+  EXPECT_ANY_THROW(spSegment.lookup(convertedTid(46, 1, 1)));
+}
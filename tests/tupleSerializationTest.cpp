@@ -41,3 +41,22 @@ TEST(TupleSerialization, detectsInvalidDeserialization) {
   Record r2 = serialize({Register("Hello"), Register(1)});
   EXPECT_ANY_THROW(deserialize(r2)); //record too long
 }
+
+TEST(TupleSerialization, deserializesIntoExistingRegisters) {
+  TupleSerializer serialize;
+  TupleDeserializer deserialize({TypeTag::Integer, TypeTag::Char});
+
+  Record r = serialize({Register(42), Register("The answer to life")});
+  std::vector<Register> registers(2);
+  deserialize(RecordView(r.getData(), r.getLen(), PageGuard()), registers);
+  EXPECT_EQ(42, registers.at(0).getInteger());
+  EXPECT_EQ("The answer to life", registers.at(1).getString());
+
+  Record r2 = serialize({Register(666), Register("the universe")});
+  deserialize(RecordView(r2.getData(), r2.getLen(), PageGuard()), registers);
+  EXPECT_EQ(666, registers.at(0).getInteger());
+  EXPECT_EQ("the universe", registers.at(1).getString());
+
+  std::vector<Register> tooFewRegisters(1);
+  EXPECT_THROW(deserialize(RecordView(r.getData(), r.getLen(), PageGuard()), tooFewRegisters), std::invalid_argument);
+}
@@ -1,12 +1,13 @@
 #include <gtest/gtest.h>
 #include <exception>
+#include <vector>
 
 #include "buffer/twoQ.h"
 
 using namespace dbImpl;
 
 TEST(TwoQTest, behavesLikeAFifo) {
-  TwoQ<int> twoQ;
+  TwoQ<int> twoQ(3);
   
   EXPECT_TRUE(twoQ.empty());
   
@@ -22,14 +23,14 @@ TEST(TwoQTest, behavesLikeAFifo) {
 }
 
 TEST(TwoQTest, evictThrowsWhenEmpty) {
-  TwoQ<int> twoQ;
+  TwoQ<int> twoQ(3);
   
   EXPECT_TRUE(twoQ.empty());
   EXPECT_ANY_THROW(twoQ.evict());
 }
 
 TEST(TwoQTest, doesntDuplicatePages) {
-  TwoQ<int> twoQ;
+  TwoQ<int> twoQ(3);
   
   EXPECT_TRUE(twoQ.empty());
   
@@ -41,52 +42,116 @@ TEST(TwoQTest, doesntDuplicatePages) {
   EXPECT_TRUE(twoQ.empty());
 }
 
+TEST(TwoQTest, ignoresCorrelatedReferences) {
+  TwoQ<int> twoQ(4);
+
+  // page 1 is accessed again while it is in the FIFO. It is not promoted.
+  twoQ.access(1);
+  twoQ.access(2);
+  twoQ.access(1);
+
+  EXPECT_EQ(1, twoQ.evict());
+  EXPECT_EQ(2, twoQ.evict());
+  EXPECT_TRUE(twoQ.empty());
+}
+
 TEST(TwoQTest, movesToLRUQueues) {
-  TwoQ<int> twoQ;
+  // Kin = 1, Kout = 2
+  TwoQ<int> twoQ(4);
   
   EXPECT_TRUE(twoQ.empty());
   
   twoQ.access(1);
   twoQ.access(2);
-  twoQ.access(3);
+  EXPECT_EQ(1, twoQ.evict());
+  // 1 is remembered in the ghost queue and gets promoted
   twoQ.access(1);
+  twoQ.access(3);
+  twoQ.access(4);
   
+  // the FIFO is only flushed down to Kin
   EXPECT_EQ(2, twoQ.evict());
   EXPECT_EQ(3, twoQ.evict());
-  
-  twoQ.access(4);
-  twoQ.access(5);
-
-  EXPECT_EQ(4, twoQ.evict());
-  EXPECT_EQ(5, twoQ.evict());
   EXPECT_EQ(1, twoQ.evict());
+  EXPECT_EQ(4, twoQ.evict());
 
   EXPECT_TRUE(twoQ.empty());
 }
 
 TEST(TwoQTest, behavesLikeALRU) {
-  TwoQ<int> twoQ;
+  TwoQ<int> twoQ(4, 0.0, 1.0);
   
   EXPECT_TRUE(twoQ.empty());
   
+  // move all pages through the ghost queue into the LRU queue
   twoQ.access(1);
   twoQ.access(2);
+  twoQ.access(3);
+  EXPECT_EQ(1, twoQ.evict());
+  EXPECT_EQ(2, twoQ.evict());
+  EXPECT_EQ(3, twoQ.evict());
+  twoQ.access(1);
   twoQ.access(2);
+  twoQ.access(3);
   twoQ.access(1);
   
   EXPECT_EQ(2, twoQ.evict());
   
-  twoQ.access(2);
-  twoQ.access(2);
-  twoQ.access(1);
+  twoQ.access(3);
+  
+  EXPECT_EQ(1, twoQ.evict());
+  EXPECT_EQ(3, twoQ.evict());
+}
+
+TEST(TwoQTest, boundsTheGhostQueue) {
+  // Kin = 0, Kout = 2
+  TwoQ<int> twoQ(4, 0.0, 0.5);
+
   twoQ.access(1);
   twoQ.access(2);
-  
+  twoQ.access(3);
+  EXPECT_EQ(1, twoQ.evict());
+  EXPECT_EQ(2, twoQ.evict());
+  EXPECT_EQ(3, twoQ.evict());
+
+  // 1 was forgotten, so it is treated as a new page
+  twoQ.access(1);
+  twoQ.access(3);
+  twoQ.access(4);
   EXPECT_EQ(1, twoQ.evict());
+  EXPECT_EQ(4, twoQ.evict());
+  EXPECT_EQ(3, twoQ.evict());
+}
+
+TEST(TwoQTest, hotPagesSurviveScans) {
+  TwoQ<int> twoQ(10);
+  std::vector<int> resident;
+
+  // make the pages 0 and 1 hot
+  for (int page : {0, 1, 2, 3}) {
+    twoQ.access(page);
+  }
+  EXPECT_EQ(0, twoQ.evict());
+  EXPECT_EQ(1, twoQ.evict());
+  twoQ.access(0);
+  twoQ.access(1);
+
+  // a scan over 100 pages, using the remaining 8 frames
+  int residentCount = 4;
+  for (int page = 100; page < 200; page++) {
+    if (residentCount == 10) {
+      int evicted = twoQ.evict();
+      EXPECT_NE(0, evicted);
+      EXPECT_NE(1, evicted);
+      residentCount--;
+    }
+    twoQ.access(page);
+    residentCount++;
+  }
 }
 
 TEST(TwoQTest, elementsCanBeErasedFromFIFO) {
-  TwoQ<int> twoQ;
+  TwoQ<int> twoQ(3);
 
   EXPECT_TRUE(twoQ.empty());
 
@@ -106,21 +171,18 @@ TEST(TwoQTest, elementsCanBeErasedFromFIFO) {
 }
 
 TEST(TwoQTest, elementsCanBeErasedFromLRU) {
-  TwoQ<int> twoQ;
-
-  EXPECT_TRUE(twoQ.empty());
-
-  twoQ.access(1);
-  twoQ.access(1);
-  twoQ.erase(1);
+  TwoQ<int> twoQ(4, 0.0, 1.0);
 
   EXPECT_TRUE(twoQ.empty());
 
   twoQ.access(1);
-  twoQ.access(1);
-  twoQ.access(2);
   twoQ.access(2);
   twoQ.access(3);
+  EXPECT_EQ(1, twoQ.evict());
+  EXPECT_EQ(2, twoQ.evict());
+  EXPECT_EQ(3, twoQ.evict());
+  twoQ.access(1);
+  twoQ.access(2);
   twoQ.access(3);
   twoQ.erase(2);
 
@@ -129,9 +191,36 @@ TEST(TwoQTest, elementsCanBeErasedFromLRU) {
   EXPECT_TRUE(twoQ.empty());
 }
 
+TEST(TwoQTest, elementsCanBeErasedFromGhostQueue) {
+  TwoQ<int> twoQ(4, 0.0, 1.0);
+
+  twoQ.access(1);
+  EXPECT_EQ(1, twoQ.evict());
+  twoQ.erase(1);
+  // 1 is a new page again, so it is not promoted
+  twoQ.access(2);
+  twoQ.access(1);
+  EXPECT_EQ(2, twoQ.evict());
+  EXPECT_EQ(1, twoQ.evict());
+}
+
+TEST(TwoQTest, erasingResidentPagesKeepsTheGhostQueue) {
+  TwoQ<int> twoQ(4, 0.0, 1.0);
+
+  twoQ.access(1);
+  EXPECT_EQ(1, twoQ.evict());
+  twoQ.eraseResident(1);
+  // 1 is still remembered, so it is promoted
+  twoQ.access(1);
+  EXPECT_TRUE(twoQ.isFrequent(1));
+  twoQ.access(2);
+  EXPECT_EQ(2, twoQ.evict());
+  EXPECT_EQ(1, twoQ.evict());
+}
+
 TEST(TwoQTest, canStorePointersAsWell) {
   int a, b, c;
-  TwoQ<int*> twoQ;
+  TwoQ<int*> twoQ(3);
 
   EXPECT_TRUE(twoQ.empty());
   
@@ -145,3 +234,69 @@ TEST(TwoQTest, canStorePointersAsWell) {
 
   EXPECT_TRUE(twoQ.empty());
 }
+
+TEST(TwoQTest, peeksVictimsInEvictionOrder) {
+  // Kin = 1
+  TwoQ<int> twoQ(4);
+
+  twoQ.access(1);
+  EXPECT_EQ(1, twoQ.evict());
+  twoQ.access(1);
+  twoQ.access(2);
+  twoQ.access(3);
+
+  std::vector<int> victims;
+  twoQ.peekVictims(2, victims);
+  EXPECT_EQ(std::vector<int>({2, 1}), victims);
+
+  victims.clear();
+  twoQ.peekVictims(10, victims);
+  EXPECT_EQ(std::vector<int>({2, 1, 3}), victims);
+
+  EXPECT_EQ(2, twoQ.evict());
+  EXPECT_EQ(1, twoQ.evict());
+  EXPECT_EQ(3, twoQ.evict());
+}
+
+TEST(TwoQTest, skipsRejectedPages) {
+  TwoQ<int> twoQ(4);
+
+  twoQ.access(1);
+  twoQ.access(2);
+  twoQ.access(3);
+  EXPECT_EQ(3, twoQ.evictIf([](int pageId) { return pageId == 3; }));
+  EXPECT_ANY_THROW(twoQ.evictIf([](int) { return false; }));
+
+  // rejected pages are neither promoted nor evicted
+  EXPECT_FALSE(twoQ.isFrequent(1));
+  EXPECT_FALSE(twoQ.isFrequent(2));
+  EXPECT_EQ(1, twoQ.evict());
+  EXPECT_EQ(2, twoQ.evict());
+  EXPECT_TRUE(twoQ.empty());
+}
+
+TEST(TwoQTest, restoresFrequentPagesIntoTheLRU) {
+  // Kin = 1
+  TwoQ<int> twoQ(4);
+
+  twoQ.access(1);
+  EXPECT_EQ(1, twoQ.evict());
+  twoQ.access(1);
+  twoQ.access(2);
+  EXPECT_TRUE(twoQ.isFrequent(1));
+  EXPECT_FALSE(twoQ.isFrequent(2));
+
+  // a new instance, restored in eviction order
+  TwoQ<int> restored(4);
+  std::vector<int> victims;
+  twoQ.peekVictims(10, victims);
+  for (int page : victims) {
+    restored.restore(page, twoQ.isFrequent(page));
+  }
+  EXPECT_TRUE(restored.isFrequent(1));
+  EXPECT_FALSE(restored.isFrequent(2));
+  restored.access(3);
+  EXPECT_EQ(2, restored.evict());
+  EXPECT_EQ(1, restored.evict());
+  EXPECT_EQ(3, restored.evict());
+}
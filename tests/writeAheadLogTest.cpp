@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "buffer/writeAheadLog.h"
+
+using namespace dbImpl;
+
+namespace {
+  const char* logFile = "writeAheadLogTest.log";
+
+  struct LoggedUpdate {
+    uint64_t pageId;
+    uint32_t offset;
+    uint64_t value;
+  };
+
+  //replays the log and returns all records. Every record stores one uint64_t.
+  std::vector<LoggedUpdate> replay(WriteAheadLog& log) {
+    std::vector<LoggedUpdate> records;
+    log.replay([&records](uint64_t pageId, uint32_t offset, const uint8_t* data, uint32_t length) {
+      EXPECT_EQ(sizeof(uint64_t), length);
+      records.push_back(LoggedUpdate{pageId, offset, *reinterpret_cast<const uint64_t*>(data)});
+    });
+    return records;
+  }
+
+  uint64_t append(WriteAheadLog& log, uint64_t pageId, uint32_t offset, uint64_t value) {
+    return log.append(pageId, offset, reinterpret_cast<const uint8_t*>(&value), sizeof(value));
+  }
+}
+
+TEST(WriteAheadLogTest, replaysFlushedRecords) {
+  unlink(logFile);
+  {
+    WriteAheadLog log(logFile);
+    append(log, 1, 0, 10);
+    append(log, 2, 8, 20);
+    uint64_t lsn = append(log, 1, 16, 30);
+    log.flush(lsn);
+  }
+  WriteAheadLog log(logFile);
+  std::vector<LoggedUpdate> records = replay(log);
+  ASSERT_EQ(3u, records.size());
+  EXPECT_EQ(1u, records[0].pageId);
+  EXPECT_EQ(10u, records[0].value);
+  EXPECT_EQ(2u, records[1].pageId);
+  EXPECT_EQ(8u, records[1].offset);
+  EXPECT_EQ(20u, records[1].value);
+  EXPECT_EQ(16u, records[2].offset);
+  EXPECT_EQ(30u, records[2].value);
+}
+
+TEST(WriteAheadLogTest, ignoresTornRecords) {
+  unlink(logFile);
+  {
+    WriteAheadLog log(logFile);
+    append(log, 1, 0, 10);
+    log.flush(append(log, 1, 8, 20));
+  }
+  //the last record was only written partially
+  struct stat logStat;
+  ASSERT_EQ(0, stat(logFile, &logStat));
+  ASSERT_EQ(0, truncate(logFile, logStat.st_size - 3));
+  {
+    WriteAheadLog log(logFile);
+    ASSERT_EQ(1u, replay(log).size());
+    log.flush(append(log, 2, 0, 30));
+  }
+  WriteAheadLog log(logFile);
+  std::vector<LoggedUpdate> records = replay(log);
+  ASSERT_EQ(2u, records.size());
+  EXPECT_EQ(10u, records[0].value);
+  EXPECT_EQ(30u, records[1].value);
+}
+
+TEST(WriteAheadLogTest, discardsRecordsBeforeTheRecoveryLsn) {
+  unlink(logFile);
+  {
+    WriteAheadLog log(logFile);
+    log.discard(append(log, 1, 0, 10));
+    log.flush(append(log, 2, 0, 20));
+  }
+  WriteAheadLog log(logFile);
+  std::vector<LoggedUpdate> records = replay(log);
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(20u, records[0].value);
+}
+
+TEST(WriteAheadLogTest, logsFullPageImagesAfterACheckpoint) {
+  unlink(logFile);
+  std::vector<uint8_t> page(64, 1);
+  {
+    WriteAheadLog log(logFile);
+    //the page was not logged since the log was opened
+    uint64_t lsn = log.appendUpdate(1, page.data(), page.size(), 8, 8, 0);
+    lsn = log.appendUpdate(1, page.data(), page.size(), 16, 8, lsn);
+    log.discard(log.beginCheckpoint());
+    log.flush(log.appendUpdate(1, page.data(), page.size(), 24, 8, lsn));
+  }
+  std::vector<std::pair<uint32_t, uint32_t>> ranges;
+  WriteAheadLog log(logFile);
+  log.replay([&ranges](uint64_t, uint32_t offset, const uint8_t*, uint32_t length) {
+    ranges.emplace_back(offset, length);
+  });
+  ASSERT_EQ(1u, ranges.size());
+  EXPECT_EQ(0u, ranges[0].first);
+  EXPECT_EQ(64u, ranges[0].second);
+}
+
+TEST(WriteAheadLogTest, replaysLogsLargerThanAChunk) {
+  unlink(logFile);
+  const uint64_t recordCount = 100000;
+  {
+    WriteAheadLog log(logFile);
+    for (uint64_t i = 0; i < recordCount; i++) {
+      append(log, i, 0, i);
+    }
+    //a single record exceeding the chunk size
+    std::vector<uint8_t> page(3 * 1024 * 1024, 7);
+    log.append(recordCount, 0, page.data(), page.size());
+    log.flush(append(log, recordCount + 1, 0, recordCount + 1));
+  }
+  uint64_t replayed = 0;
+  WriteAheadLog log(logFile);
+  log.replay([&replayed](uint64_t pageId, uint32_t, const uint8_t* data, uint32_t length) {
+    EXPECT_EQ(replayed, pageId);
+    if (pageId == recordCount) {
+      EXPECT_EQ(3u * 1024 * 1024, length);
+      EXPECT_EQ(7, data[length - 1]);
+    } else {
+      EXPECT_EQ(pageId, *reinterpret_cast<const uint64_t*>(data));
+    }
+    replayed++;
+  });
+  EXPECT_EQ(recordCount + 2, replayed);
+}
+
+TEST(WriteAheadLogTest, sharesSyncsBetweenConcurrentFlushes) {
+  unlink(logFile);
+  const unsigned threadCount = 8;
+  const unsigned commitsPerThread = 50;
+  {
+    WriteAheadLog log(logFile);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; t++) {
+      threads.emplace_back([&log, t]() {
+        for (unsigned i = 0; i < commitsPerThread; i++) {
+          log.flush(append(log, t, 0, i));
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    EXPECT_LE(log.getSyncCount(), threadCount * commitsPerThread);
+  }
+  WriteAheadLog log(logFile);
+  EXPECT_EQ(threadCount * commitsPerThread, replay(log).size());
+}
@@ -55,4 +55,59 @@ void checkedPwrite(int fd, void* buf, size_t count, off_t offset) {
   }
 }
 
+
+void checkedPreadv(int fd, struct iovec* iov, int iovcnt, off_t offset) {
+  while(iovcnt > 0) {
+    ssize_t ret = preadv(fd, iov, iovcnt, offset);
+    if(ret < 0) {
+      int occurredErrno = errno;
+      errno = 0; //reset, so that later calls can succeed
+      std::ostringstream msg;
+      msg << "I/O error while reading from file descriptor " << fd;
+      throw std::system_error(std::error_code(occurredErrno, std::system_category()), msg.str());
+    }
+    if(ret == 0) {
+      throw dbImpl::UnexpectedEofError(fd);
+    }
+    offset += ret;
+    //skip the buffers which were filled completely
+    size_t bytesRead = ret;
+    while(iovcnt > 0 && bytesRead >= iov->iov_len) {
+      bytesRead -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if(iovcnt > 0) {
+      iov->iov_base = reinterpret_cast<uint8_t*>(iov->iov_base) + bytesRead;
+      iov->iov_len -= bytesRead;
+    }
+  }
+}
+
+
+void checkedPwritev(int fd, struct iovec* iov, int iovcnt, off_t offset) {
+  while(iovcnt > 0) {
+    ssize_t ret = pwritev(fd, iov, iovcnt, offset);
+    if(ret < 0) {
+      int occurredErrno = errno;
+      errno = 0; //reset, so that later calls can succeed
+      std::ostringstream msg;
+      msg << "I/O error while writing to file descriptor " << fd;
+      throw std::system_error(std::error_code(occurredErrno, std::system_category()), msg.str());
+    }
+    offset += ret;
+    //skip the buffers which were written completely
+    size_t bytesWritten = ret;
+    while(iovcnt > 0 && bytesWritten >= iov->iov_len) {
+      bytesWritten -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if(iovcnt > 0) {
+      iov->iov_base = reinterpret_cast<uint8_t*>(iov->iov_base) + bytesWritten;
+      iov->iov_len -= bytesWritten;
+    }
+  }
+}
+
 } //namespace dbImpl
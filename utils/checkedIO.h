@@ -2,6 +2,7 @@
 #define _CHECKED_IO_HPP_
 
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <system_error>
 
 namespace dbImpl {
@@ -20,6 +21,12 @@ namespace dbImpl {
   //wraps pread with error checking code.
   //if an error occurs abort() will be called.
   void checkedPwrite(int fd, void* buf, size_t count, off_t offset);
+  //wraps preadv with error checking code.
+  //Reads into all given buffers. The iovec array is modified.
+  void checkedPreadv(int fd, struct iovec* iov, int iovcnt, off_t offset);
+  //wraps pwritev with error checking code.
+  //Writes all given buffers. The iovec array is modified.
+  void checkedPwritev(int fd, struct iovec* iov, int iovcnt, off_t offset);
 
 }
 
@@ -0,0 +1,124 @@
+#include "utils/crc32c.h"
+
+#include <cstring>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace dbImpl {
+
+namespace {
+  //the reversed Castagnoli polynomial
+  const uint32_t polynomial = 0x82f63b78;
+
+  struct Crc32cTable {
+    uint32_t entries[256];
+    Crc32cTable() {
+      for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (unsigned bit = 0; bit < 8; bit++) {
+          crc = (crc >> 1) ^ (crc & 1 ? polynomial : 0);
+        }
+        entries[i] = crc;
+      }
+    }
+  };
+  const Crc32cTable table;
+
+  //both variants work on the inverted checksum
+  uint32_t crc32cTable(const uint8_t* data, size_t length, uint32_t crc) {
+    for (size_t i = 0; i < length; i++) {
+      crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+  }
+
+#if defined(__x86_64__)
+  //the crc32 instruction has a latency of several cycles, but a new one can
+  //be started every cycle. Hence, long inputs are split into three stripes
+  //whose checksums are computed at the same time and combined afterwards.
+  const size_t stripeLength = 1024;
+
+  //multiplies two polynomials modulo the CRC polynomial
+  uint32_t multiplyModulo(uint32_t a, uint32_t b) {
+    uint32_t product = 0;
+    for (uint32_t mask = 1u << 31; mask != 0; mask >>= 1) {
+      if (a & mask) {
+        product ^= b;
+      }
+      b = (b >> 1) ^ (b & 1 ? polynomial : 0);
+    }
+    return product;
+  }
+
+  //appending stripeLength zero bytes to the input multiplies the checksum by
+  //x^(8 * stripeLength). This is a linear function of the checksum's bytes,
+  //so it is tabulated for each byte.
+  struct StripeShiftTable {
+    uint32_t entries[4][256];
+    StripeShiftTable() {
+      uint32_t factor = 1u << 31; //x^0 in the bit reversed representation
+      for (size_t i = 0; i < 8 * stripeLength; i++) {
+        factor = multiplyModulo(factor, 1u << 30); //times x^1
+      }
+      for (unsigned byte = 0; byte < 4; byte++) {
+        for (uint32_t value = 0; value < 256; value++) {
+          entries[byte][value] = multiplyModulo(factor, value << (8 * byte));
+        }
+      }
+    }
+    uint32_t shift(uint32_t crc) const {
+      return entries[0][crc & 0xff] ^ entries[1][(crc >> 8) & 0xff]
+          ^ entries[2][(crc >> 16) & 0xff] ^ entries[3][crc >> 24];
+    }
+  };
+  const StripeShiftTable stripeShift;
+
+  uint64_t load64(const uint8_t* data) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+  }
+
+  //compiled for SSE4.2 without requiring it for the rest of the program.
+  //Only called if the CPU supports it.
+  __attribute__((target("sse4.2")))
+  uint32_t crc32cHardware(const uint8_t* data, size_t length, uint32_t crc) {
+    uint64_t crc64 = crc;
+    size_t i = 0;
+    for (; i + 3 * stripeLength <= length; i += 3 * stripeLength) {
+      const uint8_t* stripe = data + i;
+      uint64_t second = 0;
+      uint64_t third = 0;
+      for (size_t j = 0; j < stripeLength; j += sizeof(uint64_t)) {
+        crc64 = _mm_crc32_u64(crc64, load64(stripe + j));
+        second = _mm_crc32_u64(second, load64(stripe + stripeLength + j));
+        third = _mm_crc32_u64(third, load64(stripe + 2 * stripeLength + j));
+      }
+      crc64 = stripeShift.shift(stripeShift.shift(crc64) ^ second) ^ third;
+    }
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+      crc64 = _mm_crc32_u64(crc64, load64(data + i));
+    }
+    crc = crc64;
+    for (; i < length; i++) {
+      crc = _mm_crc32_u8(crc, data[i]);
+    }
+    return crc;
+  }
+
+  const bool hasHardwareCrc32c = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+uint32_t crc32c(const void* data, size_t length, uint32_t crc) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+#if defined(__x86_64__)
+  if (hasHardwareCrc32c) {
+    return ~crc32cHardware(bytes, length, ~crc);
+  }
+#endif
+  return ~crc32cTable(bytes, length, ~crc);
+}
+
+}
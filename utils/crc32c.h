@@ -0,0 +1,17 @@
+#ifndef _CRC32C_HPP_
+#define _CRC32C_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dbImpl {
+
+  //computes the CRC32C (Castagnoli) checksum of the given data.
+  //Longer inputs can be checksummed in pieces by passing the checksum of
+  //the previous pieces as crc. Uses the SSE4.2 crc32 instruction if the
+  //CPU supports it and a lookup table otherwise.
+  uint32_t crc32c(const void* data, size_t length, uint32_t crc = 0);
+
+}
+
+#endif
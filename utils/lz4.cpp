@@ -0,0 +1,166 @@
+#include "utils/lz4.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace dbImpl {
+
+namespace {
+  //the shortest match which is encoded
+  const size_t minMatch = 4;
+  //the format requires the last bytes to be literals and the last match to
+  //start at least this many bytes in front of the end
+  const size_t lastLiterals = 5;
+  const size_t matchLimit = 12;
+  const size_t maxOffset = 65535;
+  const unsigned hashBits = 12;
+
+  uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+  }
+
+  uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - hashBits);
+  }
+
+  //number of bytes needed for a length exceeding the 4 bits of the token
+  size_t extraLengthBytes(size_t length) {
+    return length < 15 ? 0 : (length - 15) / 255 + 1;
+  }
+
+  uint8_t* writeExtraLength(uint8_t* out, size_t length) {
+    if (length >= 15) {
+      for (length -= 15; length >= 255; length -= 255) {
+        *out++ = 255;
+      }
+      *out++ = length;
+    }
+    return out;
+  }
+
+  //reads the bytes extending a length of 15 stored in a token
+  size_t readExtraLength(const uint8_t* src, size_t srcSize, size_t& pos) {
+    size_t length = 0;
+    uint8_t byte;
+    do {
+      if (pos >= srcSize) {
+        throw std::runtime_error("corrupt LZ4 block");
+      }
+      byte = src[pos++];
+      length += byte;
+    } while (byte == 255);
+    return length;
+  }
+}
+
+size_t lz4Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity) {
+  // positions of recently seen 4 byte sequences. Collisions only cost
+  // compression ratio, candidates are verified before they are used.
+  uint32_t table[1 << hashBits] = {};
+  uint8_t* out = dst;
+  uint8_t* outEnd = dst + dstCapacity;
+  // writes a sequence: the literals in front of a match, followed by the match.
+  // The last sequence consists of literals only (matchLength == 0).
+  auto writeSequence = [&](size_t literalStart, size_t literalLength, size_t offset, size_t matchLength) {
+    size_t encodedMatch = matchLength > 0 ? matchLength - minMatch : 0;
+    size_t needed = 1 + extraLengthBytes(literalLength) + literalLength
+        + (matchLength > 0 ? 2 + extraLengthBytes(encodedMatch) : 0);
+    if (needed > static_cast<size_t>(outEnd - out)) {
+      return false;
+    }
+    *out++ = (std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(encodedMatch, 15);
+    out = writeExtraLength(out, literalLength);
+    if (literalLength > 0) {
+      std::memcpy(out, src + literalStart, literalLength);
+      out += literalLength;
+    }
+    if (matchLength > 0) {
+      *out++ = offset & 0xff;
+      *out++ = offset >> 8;
+      out = writeExtraLength(out, encodedMatch);
+    }
+    return true;
+  };
+  size_t pos = 0;
+  size_t anchor = 0;
+  while (pos + matchLimit <= srcSize) {
+    uint32_t sequence = read32(src + pos);
+    uint32_t& slot = table[hash(sequence)];
+    size_t candidate = slot;
+    slot = pos;
+    if (candidate < pos && pos - candidate <= maxOffset && read32(src + candidate) == sequence) {
+      size_t matchLength = minMatch;
+      while (pos + matchLength < srcSize - lastLiterals
+          && src[candidate + matchLength] == src[pos + matchLength]) {
+        matchLength++;
+      }
+      if (!writeSequence(anchor, pos - anchor, pos - candidate, matchLength)) {
+        return 0;
+      }
+      pos += matchLength;
+      anchor = pos;
+    } else {
+      pos++;
+    }
+  }
+  if (!writeSequence(anchor, srcSize - anchor, 0, 0)) {
+    return 0;
+  }
+  return out - dst;
+}
+
+void lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+  size_t in = 0;
+  size_t out = 0;
+  while (true) {
+    if (in >= srcSize) {
+      throw std::runtime_error("corrupt LZ4 block");
+    }
+    uint8_t token = src[in++];
+    size_t literalLength = token >> 4;
+    if (literalLength == 15) {
+      literalLength += readExtraLength(src, srcSize, in);
+    }
+    if (literalLength > srcSize - in || literalLength > dstSize - out) {
+      throw std::runtime_error("corrupt LZ4 block");
+    }
+    if (literalLength > 0) {
+      std::memcpy(dst + out, src + in, literalLength);
+    }
+    in += literalLength;
+    out += literalLength;
+    if (in == srcSize) {
+      break; //the last sequence has no match
+    }
+    if (srcSize - in < 2) {
+      throw std::runtime_error("corrupt LZ4 block");
+    }
+    size_t offset = src[in] | (src[in + 1] << 8);
+    in += 2;
+    size_t matchLength = token & 15;
+    if (matchLength == 15) {
+      matchLength += readExtraLength(src, srcSize, in);
+    }
+    matchLength += minMatch;
+    if (offset == 0 || offset > out || matchLength > dstSize - out) {
+      throw std::runtime_error("corrupt LZ4 block");
+    }
+    const uint8_t* match = dst + out - offset;
+    if (offset >= matchLength) {
+      std::memcpy(dst + out, match, matchLength);
+    } else {
+      // the match overlaps the bytes it produces, so it is copied byte by byte
+      for (size_t i = 0; i < matchLength; i++) {
+        dst[out + i] = match[i];
+      }
+    }
+    out += matchLength;
+  }
+  if (out != dstSize) {
+    throw std::runtime_error("corrupt LZ4 block");
+  }
+}
+
+}
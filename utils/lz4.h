@@ -0,0 +1,19 @@
+#ifndef _LZ4_HPP_
+#define _LZ4_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dbImpl {
+
+  //compresses srcSize bytes into the LZ4 block format.
+  //Returns the size of the compressed data, or 0 if it would not
+  //fit into dstCapacity bytes.
+  size_t lz4Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+  //decompresses an LZ4 block which must expand to exactly dstSize bytes.
+  //Throws a std::runtime_error if the block is corrupt.
+  void lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+
+}
+
+#endif
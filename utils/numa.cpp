@@ -0,0 +1,71 @@
+#include "utils/numa.h"
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <cerrno>
+#include <cstdio>
+#include <vector>
+
+namespace dbImpl {
+
+namespace {
+  //the memory policy preferring a node, see set_mempolicy(2).
+  //Defined here, since numaif.h is part of libnuma.
+  const int mpolPreferred = 1;
+  const unsigned bitsPerLong = 8 * sizeof(unsigned long);
+}
+
+unsigned numaNodeCount() {
+  //the file lists the online nodes as ranges, e.g. "0-1"
+  FILE* online = fopen("/sys/devices/system/node/online", "r");
+  if (online == nullptr) {
+    errno = 0;
+    return 1;
+  }
+  unsigned nodeCount = 1;
+  unsigned first, last;
+  while (true) {
+    int matched = fscanf(online, "%u", &first);
+    if (matched != 1) {
+      break;
+    }
+    last = first;
+    int separator = fgetc(online);
+    if (separator == '-') {
+      if (fscanf(online, "%u", &last) != 1) {
+        break;
+      }
+      separator = fgetc(online);
+    }
+    if (last + 1 > nodeCount) {
+      nodeCount = last + 1;
+    }
+    if (separator != ',') {
+      break;
+    }
+  }
+  fclose(online);
+  return nodeCount;
+}
+
+unsigned currentNumaNode() {
+  unsigned cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+    errno = 0;
+    return 0;
+  }
+  return node;
+}
+
+bool bindToNumaNode(void* memory, size_t length, unsigned node) {
+  std::vector<unsigned long> nodeMask(node / bitsPerLong + 1, 0);
+  nodeMask[node / bitsPerLong] = 1ul << (node % bitsPerLong);
+  if (syscall(SYS_mbind, memory, length, mpolPreferred, nodeMask.data(),
+      nodeMask.size() * bitsPerLong, 0) != 0) {
+    errno = 0; //only a hint, the caller may ignore the error
+    return false;
+  }
+  return true;
+}
+
+}
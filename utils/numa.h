@@ -0,0 +1,19 @@
+#ifndef _NUMA_HPP_
+#define _NUMA_HPP_
+
+#include <cstddef>
+
+namespace dbImpl {
+
+  //returns the number of NUMA nodes of this machine.
+  //Returns 1 if the kernel does not report any nodes.
+  unsigned numaNodeCount();
+  //returns the NUMA node of the CPU the calling thread is running on
+  unsigned currentNumaNode();
+  //asks the kernel to back the given memory by pages of the given node.
+  //The memory must not be touched yet. Returns false if the kernel refused.
+  bool bindToNumaNode(void* memory, size_t length, unsigned node);
+
+}
+
+#endif
@@ -0,0 +1,48 @@
+#include "utils/threadPool.h"
+
+namespace dbImpl {
+
+ThreadPool::ThreadPool(unsigned threadCount)
+: stopping(false) {
+  threads.reserve(threadCount);
+  for(unsigned i = 0; i < threadCount; i++) {
+    threads.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  taskAvailable.notify_all();
+  for(auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+  }
+  taskAvailable.notify_one();
+}
+
+void ThreadPool::work() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true) {
+    taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+    //remaining tasks are executed even if the pool is stopping
+    if(tasks.empty()) {
+      return;
+    }
+    std::function<void()> task = std::move(tasks.front());
+    tasks.pop_front();
+    lock.unlock();
+    task();
+    lock.lock();
+  }
+}
+
+} //namespace dbImpl
@@ -0,0 +1,40 @@
+#ifndef _THREAD_POOL_HPP_
+#define _THREAD_POOL_HPP_
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace dbImpl {
+
+  //executes tasks asynchronously on a fixed number of threads
+  class ThreadPool {
+    public:
+      //deleted copy constructor => non copyable
+      ThreadPool(const ThreadPool&) = delete;
+      //deleted operator= => non copyable
+      ThreadPool& operator=(const ThreadPool&) = delete;
+
+      ThreadPool(unsigned threadCount);
+      //waits until all submitted tasks were executed
+      ~ThreadPool();
+
+      //enqueues a task. Tasks must not throw.
+      void submit(std::function<void()> task);
+
+    private:
+      void work();
+
+      std::vector<std::thread> threads;
+      std::deque<std::function<void()>> tasks;
+      std::mutex mutex;
+      std::condition_variable taskAvailable;
+      bool stopping;
+  };
+
+}
+
+#endif